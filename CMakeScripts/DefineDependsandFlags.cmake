@@ -123,6 +123,9 @@ pkg_check_modules(INKSCAPE_DEP REQUIRED
 # remove this line and uncomment the doiuble-conversion above when double-conversion.pc file gets shipped on all platforms we support
 find_package(DoubleConversion REQUIRED)  # lib2geom dependency
 
+find_package(Threads REQUIRED)
+list(APPEND INKSCAPE_LIBS ${CMAKE_THREAD_LIBS_INIT})
+
 sanitize_ldflags_for_libs(INKSCAPE_DEP_LDFLAGS)
 list(APPEND INKSCAPE_LIBS ${INKSCAPE_DEP_LDFLAGS})
 list(APPEND INKSCAPE_INCS_SYS ${INKSCAPE_DEP_INCLUDE_DIRS})
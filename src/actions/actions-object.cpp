@@ -41,15 +41,15 @@ object_set_attribute(const Glib::VariantBase& value, InkscapeApplication *app)
         return;
     }
 
+    // Objects re-read the attribute once, when the batch ends, which also commits the undo step.
+    Inkscape::DocumentUndo::ScopedBatch batch(app->get_active_document(), 0, "ActionObjectSetAttribute");
+
     // Should this be a selection member function?
     auto items = selection->items();
     for (auto i = items.begin(); i != items.end(); ++i) {
         Inkscape::XML::Node *repr = (*i)->getRepr();
         repr->setAttribute(tokens[0], tokens[1]);
     }
-
-    // Needed to update repr (is this the best way?).
-    Inkscape::DocumentUndo::done(app->get_active_document(), 0, "ActionObjectSetAttribute");
 }
 
 
@@ -71,6 +71,8 @@ object_set_property(const Glib::VariantBase& value, InkscapeApplication *app)
         return;
     }
 
+    Inkscape::DocumentUndo::ScopedBatch batch(app->get_active_document(), 0, "ActionObjectSetProperty");
+
     // Should this be a selection member function?
     auto items = selection->items();
     for (auto i = items.begin(); i != items.end(); ++i) {
@@ -80,9 +82,6 @@ object_set_property(const Glib::VariantBase& value, InkscapeApplication *app)
         sp_repr_css_set(repr, css, "style");
         sp_repr_css_attr_unref(css);
     }
-
-    // Needed to update repr (is this the best way?).
-    Inkscape::DocumentUndo::done(app->get_active_document(), 0, "ActionObjectSetProperty");
 }
 
 
@@ -10,6 +10,11 @@
  *
  */
 
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
@@ -19,6 +24,7 @@
 
 #include "auto-save.h"
 #include "document.h"
+#include "document-journal.h"
 #include "inkscape-application.h"
 #include "preferences.h"
 
@@ -27,19 +33,159 @@
 #include "xml/repr.h"
 
 #ifdef _WIN32
+#include <windows.h>
 typedef int uid_t;
 #define getuid() 0
 #endif
 
 namespace Inkscape {
 
+namespace {
+
+std::string autosave_directory()
+{
+    std::string autosave_dir = Inkscape::Preferences::get()->getString("/options/autosave/path"); // Filenames should be std::string
+    if (autosave_dir.empty()) {
+        autosave_dir = Glib::build_filename(Glib::get_user_cache_dir(), "inkscape");
+    }
+    return autosave_dir;
+}
+
+std::string timestamp()
+{
+    std::time_t time = std::time(nullptr);
+    std::tm tm = *std::localtime(&time);
+    std::stringstream datetime;
+    datetime << std::put_time(&tm, "%Y_%m_%d_%H_%M_%S");
+    return datetime.str();
+}
+
+std::string journal_prefix()
+{
+    return "automatic-journal-" + std::to_string(getuid()) + "-";
+}
+
+bool process_running(int pid)
+{
+#ifdef _WIN32
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!process) {
+        return false;
+    }
+    DWORD code = 0;
+    bool running = GetExitCodeProcess(process, &code) && code == STILL_ACTIVE;
+    CloseHandle(process);
+    return running;
+#else
+    return kill(pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+bool ends_with(std::string const &str, std::string const &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+AutoSave::AutoSave() = default;
+AutoSave::~AutoSave() = default;
+
 void
 AutoSave::init(InkscapeApplication* app)
 {
     _app = app;
+    recover(autosave_directory());
     start();
 }
 
+/**
+ * Turns the journals left behind by Inkscape processes that are no longer running into
+ * recovered autosave files.
+ */
+void
+AutoSave::recover(std::string const &autosave_dir)
+{
+    if (!Glib::file_test(autosave_dir, Glib::FILE_TEST_IS_DIR)) {
+        return;
+    }
+
+    std::string prefix = journal_prefix();
+    Glib::Dir directory(autosave_dir);
+    std::vector<std::string> file_names(directory.begin(), directory.end());
+
+    for (auto &file_name : file_names) {
+        if (file_name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        bool tmp = ends_with(file_name, ".journal.tmp");
+        if (!tmp && !ends_with(file_name, ".journal")) {
+            continue;
+        }
+        int pid = std::atoi(file_name.c_str() + prefix.size());
+        if (pid == ::getpid() || process_running(pid)) {
+            continue;
+        }
+
+        // A ".journal.tmp" file is a snapshot whose write was interrupted before it replaced
+        // the journal. It may be the only copy left, so it is replayed like a journal.
+        std::string path = Glib::build_filename(autosave_dir, file_name);
+        Inkscape::XML::Document *doc = DocumentJournal::replay(path);
+        if (!doc) {
+            // Keep the file for a later look, but out of the way of the next recovery.
+            std::string damaged = path + ".damaged";
+            if (rename(path.c_str(), damaged.c_str()) == -1) {
+                std::cerr << "AutoSave::recover: Failed to rename file: "
+                          << path << ": " << strerror(errno) << std::endl;
+            }
+            g_warning("AutoSave::recover: Could not read the autosave journal, kept it as %s",
+                      damaged.c_str());
+            continue;
+        }
+
+        // "<pid>-<number>" of the journal
+        size_t suffix = tmp ? strlen(".journal.tmp") : strlen(".journal");
+        std::string id = file_name.substr(prefix.size(), file_name.size() - prefix.size() - suffix);
+        std::string filename = "automatic-save-" + std::to_string(getuid()) + "-" + timestamp() + "-" + id +
+                               (tmp ? "-snapshot" : "") + "-recovered.svg";
+        std::string recovered = Glib::build_filename(autosave_dir, filename);
+        bool saved = sp_repr_save_file(doc, recovered.c_str(), SP_SVG_NS_URI);
+        Inkscape::GC::release(doc);
+        if (!saved) {
+            std::cerr << "AutoSave::recover: Failed to save recovered document: " << recovered << std::endl;
+            continue;
+        }
+        g_message(_("Recovered a document from the autosave journal: %s"), recovered.c_str());
+
+        if (unlink(path.c_str()) == -1) {
+            std::cerr << "AutoSave::recover: Failed to unlink file: "
+                      << path << ": " << strerror(errno) << std::endl;
+        }
+    }
+}
+
+/**
+ * Keeps a journal for the document instead of saving it in full. The first call takes a
+ * snapshot, later calls append the changes and start over once the journal outgrows the
+ * snapshot.
+ */
+void
+AutoSave::journal(SPDocument *document, std::string const &autosave_dir)
+{
+    auto &journal = _journals[document];
+    if (!journal) {
+        std::string filename = journal_prefix() + std::to_string(::getpid()) + "-" + std::to_string(++_journal_count) + ".journal";
+        journal = std::make_unique<DocumentJournal>(document, Glib::build_filename(autosave_dir, filename));
+        document->connectDestroy([this, document]() { _journals.erase(document); });
+    } else {
+        journal->commit();
+        if (journal->journalSize() > journal->snapshotSize()) {
+            journal->snapshot();
+        }
+    }
+    document->setModifiedSinceAutoSaveFalse();
+}
+
 void
 AutoSave::start()
 {
@@ -71,12 +217,13 @@ AutoSave::save()
     }
 
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    bool use_journal = prefs->getBool("/options/autosave/journal", false);
+    if (!use_journal) {
+        _journals.clear();
+    }
 
     // Find/create autosave directory
-    std::string autosave_dir = prefs->getString("/options/autosave/path"); // Filenames should be std::string
-    if (autosave_dir.empty()) {
-        autosave_dir = Glib::build_filename(Glib::get_user_cache_dir(), "inkscape");
-    }
+    std::string autosave_dir = autosave_directory();
 
     Glib::RefPtr<Gio::File> dir_file = Gio::File::create_for_path(autosave_dir);
     if (!dir_file->query_exists()) {
@@ -91,51 +238,50 @@ AutoSave::save()
     int pid = ::getpid(); // Avoid naming conflicts between processes
 
     // Get time stamp
-    std::time_t time = std::time(nullptr);
-    std::tm tm = *std::localtime(&time);
-    std::stringstream datetime;
-    datetime << std::put_time(&tm, "%Y_%m_%d_%H_%M_%S");
+    std::string datetime = timestamp();
+
+    std::string base_name = "automatic-save-" + std::to_string(uid);
+
+    // Existing autosaves, newest first (file name encodes time). Read once and kept up
+    // to date below, so that we make room for each document that needs saving.
+    std::vector<std::string> saves;
+    if (!use_journal) {
+        Glib::Dir directory(autosave_dir);
+        for (auto file_name : directory) {
+            if (file_name.compare(0, base_name.size(), base_name) == 0) {
+                saves.push_back(file_name);
+            }
+        }
+        std::sort(saves.begin(), saves.end(), std::greater<std::string>());
+    }
 
     int docnum = 0;
-    int autosave_max = prefs->getInt("/options/autosave/max", 10);
+    size_t autosave_max = std::max(prefs->getInt("/options/autosave/max", 10), 1);
     for (auto document : documents) {
 
         ++docnum; // Give each document a unique number.
 
         if (document->isModifiedSinceAutoSave()) {
 
-            std::string base_name = "automatic-save-" + std::to_string(uid);
-
-            // The following we do for each document (rather wasteful...) so that
-            // we make room for each document that needs saving. We probably should
-            // be counting per document and not overall documents.
-
-            // Open directory
-            Glib::Dir directory(autosave_dir);
-            std::vector<std::string> file_names(directory.begin(), directory.end());
-
-            // Sort them so that oldest are last (file name encodes time).
-            std::sort(file_names.begin(), file_names.end(), std::greater<std::string>());
-
-            // Delete oldest files.
-            int count = 0;
-            for (auto &file_name : file_names) {
-                if (file_name.compare(0, base_name.size(), base_name) == 0) {
-                    ++count;
-                    if (count >= autosave_max) {
-                        // Delete (making room for one more).
-                        std::string path = Glib::build_filename(autosave_dir, file_name);
-                        if (unlink(path.c_str()) == -1) {
-                            std::cerr << "InkscapeApplication::document_autosave: Failed to unlink file: "
-                                      << path << ": " << strerror(errno) << std::endl;
-                        }
-                    }
+            if (use_journal) {
+                journal(document, autosave_dir);
+                continue;
+            }
+
+            // Delete oldest files (making room for one more).
+            // We probably should be counting per document and not overall documents.
+            while (saves.size() >= autosave_max) {
+                std::string path = Glib::build_filename(autosave_dir, saves.back());
+                if (unlink(path.c_str()) == -1) {
+                    std::cerr << "InkscapeApplication::document_autosave: Failed to unlink file: "
+                              << path << ": " << strerror(errno) << std::endl;
                 }
+                saves.pop_back();
             }
 
             // Construct save file path
             // datetime MUST happen first, otherwise the above sorting will fail
-            std::string filename = base_name + "-" + datetime.str() + "-" + std::to_string(pid) + "-" + std::to_string(docnum) + ".svg";
+            std::string filename = base_name + "-" + datetime + "-" + std::to_string(pid) + "-" + std::to_string(docnum) + ".svg";
             std::string path = Glib::build_filename(autosave_dir, filename.c_str());
 
             // Try to save the file
@@ -165,6 +311,7 @@ AutoSave::save()
                 g_free(errortext);
             } else {
                 document->setModifiedSinceAutoSaveFalse();
+                saves.insert(saves.begin(), filename);
             }
         }
     } // Loop over documents
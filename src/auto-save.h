@@ -13,13 +13,21 @@
 #ifndef INKSCAPE_AUTOSAVE_H
 #define INKSCAPE_AUTOSAVE_H
 
+#include <map>
+#include <memory>
+#include <string>
+
 class InkscapeApplication;
+class SPDocument;
 
 namespace Inkscape {
 
+class DocumentJournal;
+
 class AutoSave {
 private:
-    AutoSave() = default;
+    AutoSave();
+    ~AutoSave();
 
 public:
     AutoSave(const AutoSave &) = delete;
@@ -39,7 +47,14 @@ public:
     bool save();
 
 private:
+    void recover(std::string const &autosave_dir);
+    void journal(SPDocument *document, std::string const &autosave_dir);
+
     InkscapeApplication* _app = nullptr;
+
+    // Used instead of full saves when "/options/autosave/journal" is set.
+    std::map<SPDocument *, std::unique_ptr<DocumentJournal>> _journals;
+    int _journal_count = 0;
 };
 
 } // namespace Inkscape
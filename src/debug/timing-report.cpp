@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Inkscape::Debug::TimingReport - how long the phases of a command line run take
+ *
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <glib.h>
+#include "debug/logger.h"
+#include "debug/simple-event.h"
+#include "debug/timestamp.h"
+#include "debug/timing-report.h"
+
+namespace Inkscape {
+
+namespace Debug {
+
+bool TimingReport::_enabled=false;
+
+namespace {
+
+struct Phase {
+    char const *name;
+    gint64 time;    // microseconds, without the phases nested in it
+    unsigned count;
+};
+
+struct Frame {
+    size_t phase;
+    gint64 start;
+    gint64 nested;  // microseconds spent in the phases nested in this one
+};
+
+static TimingReport::Format report_format=TimingReport::TEXT;
+static std::thread::id report_thread;
+static gint64 run_start=0;
+static gint64 report_start=0;
+static bool startup_running=false;
+
+// Phases keep their place once seen, so that the frames can refer to them across reports.
+static std::vector<Phase> &phases() {
+    static std::vector<Phase> list;
+    return list;
+}
+
+static std::vector<Frame> &frames() {
+    static std::vector<Frame> stack;
+    return stack;
+}
+
+class PhaseEvent : public SimpleEvent<Event::OTHER> {
+public:
+    PhaseEvent(char const *name) : SimpleEvent<Event::OTHER>("phase") {
+        _addProperty("name", name);
+        _addProperty("timestamp", timestamp());
+    }
+};
+
+static size_t phase_index(char const *name) {
+    auto &list = phases();
+    for ( size_t i = 0 ; i < list.size() ; i++ ) {
+        if ( list[i].name == name || !std::strcmp(list[i].name, name) ) {
+            return i;
+        }
+    }
+    list.push_back({name, 0, 0});
+    return list.size() - 1;
+}
+
+static void push_frame(char const *name, gint64 start) {
+    frames().push_back({phase_index(name), start, 0});
+    Logger::start<PhaseEvent>(name);
+}
+
+static bool on_report_thread() {
+    return std::this_thread::get_id() == report_thread;
+}
+
+static void write_json_string(std::ostream &os, std::string const &value) {
+    os << '"';
+    for (char c : value) {
+        if ( c == '"' || c == '\\' ) {
+            os << '\\' << c;
+        } else if ( static_cast<unsigned char>(c) < 0x20 ) {
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c)
+               << std::dec << std::setfill(' ');
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+}
+
+void TimingReport::init() {
+    run_start = g_get_monotonic_time();
+}
+
+void TimingReport::enable(Format format) {
+    if (_enabled) {
+        return;
+    }
+    if (!run_start) {
+        init();
+    }
+    report_format = format;
+    report_thread = std::this_thread::get_id();
+    report_start = run_start;
+    _enabled = true;
+
+    push_frame("startup", run_start);
+    startup_running = true;
+}
+
+TimingReport::Format TimingReport::format() {
+    return report_format;
+}
+
+void TimingReport::start(char const *name) {
+    if ( !_enabled || !on_report_thread() ) {
+        return;
+    }
+    push_frame(name, g_get_monotonic_time());
+}
+
+void TimingReport::finish() {
+    if ( !_enabled || !on_report_thread() || frames().empty() ) {
+        return;
+    }
+    Logger::finish();
+
+    Frame frame = frames().back();
+    frames().pop_back();
+    gint64 elapsed = g_get_monotonic_time() - frame.start;
+    Phase &phase = phases()[frame.phase];
+    phase.time += elapsed - frame.nested;
+    phase.count++;
+    if (!frames().empty()) {
+        frames().back().nested += elapsed;
+    }
+}
+
+void TimingReport::finishStartup() {
+    if (startup_running) {
+        startup_running = false;
+        finish();
+    }
+}
+
+void TimingReport::write(std::ostream &os, std::string const &document_name) {
+    if ( !_enabled || !on_report_thread() ) {
+        return;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    gint64 total = now - report_start;
+    gint64 phased = 0;
+    for (auto const &phase : phases()) {
+        phased += phase.time;
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    if ( report_format == JSON ) {
+        out << "{\"document\":";
+        write_json_string(out, document_name);
+        out << ",\"total_ms\":" << total / 1000.0 << ",\"phases\":[";
+        bool first = true;
+        for (auto const &phase : phases()) {
+            if (phase.count) {
+                out << (first ? "" : ",") << "{\"name\":\"" << phase.name << "\",\"ms\":"
+                    << phase.time / 1000.0 << ",\"count\":" << phase.count << "}";
+                first = false;
+            }
+        }
+        out << "],\"other_ms\":" << (total - phased) / 1000.0 << "}\n";
+    } else {
+        out << "Timing report for " << document_name << ":\n";
+        for (auto const &phase : phases()) {
+            if (phase.count) {
+                out << "  " << std::left << std::setw(16) << phase.name << std::right
+                    << std::setw(10) << phase.time / 1000.0 << " ms";
+                if ( phase.count > 1 ) {
+                    out << "  (" << phase.count << " times)";
+                }
+                out << "\n";
+            }
+        }
+        out << "  " << std::left << std::setw(16) << "other" << std::right
+            << std::setw(10) << (total - phased) / 1000.0 << " ms\n";
+        out << "  " << std::left << std::setw(16) << "total" << std::right
+            << std::setw(10) << total / 1000.0 << " ms\n";
+    }
+    os << out.str() << std::flush;
+
+    for (auto &phase : phases()) {
+        phase.time = 0;
+        phase.count = 0;
+    }
+    report_start = now;
+}
+
+}
+
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
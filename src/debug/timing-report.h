@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Inkscape::Debug::TimingReport - how long the phases of a command line run take
+ *
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DEBUG_TIMING_REPORT_H
+#define SEEN_INKSCAPE_DEBUG_TIMING_REPORT_H
+
+#include <iosfwd>
+#include <string>
+
+namespace Inkscape {
+
+namespace Debug {
+
+/**
+ * Adds up the time spent in each phase of processing documents, like XML parsing or
+ * rendering, and reports it once a document is done.
+ *
+ * Phases may be nested; a phase is only charged the time not spent in the phases nested in it,
+ * so that the times add up to the time of the whole run. Phases are only timed on the thread
+ * that enabled the report, and while it is enabled they also show up as events in the debug log
+ * of the Logger.
+ */
+class TimingReport {
+public:
+    enum Format {
+        TEXT,
+        JSON
+    };
+
+    /// Remembers when the run started, which is counted as startup once the report is enabled.
+    static void init();
+    static void enable(Format format);
+    static bool enabled() { return _enabled; }
+    static Format format();
+
+    static void start(char const *name);
+    static void finish();
+    /// Finishes the startup phase, if it is still running.
+    static void finishStartup();
+
+    /**
+     * Writes the times of the phases since the last report, or since the start of the run,
+     * and starts over.
+     */
+    static void write(std::ostream &os, std::string const &document_name);
+
+private:
+    static bool _enabled;
+};
+
+/**
+ * Times a phase for the TimingReport for its lifetime, like EventTracker does for events.
+ * The name must be a static string.
+ */
+class PhaseTracker {
+public:
+    explicit PhaseTracker(char const *name) : _active(TimingReport::enabled()) {
+        if (_active) {
+            TimingReport::start(name);
+        }
+    }
+    ~PhaseTracker() {
+        if (_active) {
+            TimingReport::finish();
+        }
+    }
+
+private:
+    PhaseTracker(PhaseTracker const &) = delete; // no copy
+    void operator=(PhaseTracker const &) = delete; // no assign
+    bool _active;
+};
+
+}
+
+}
+
+#endif
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -243,6 +243,13 @@ DrawingText::addComponent(font_instance *font, int glyph, Geom::Affine const &tr
     ng->setGlyph(font, glyph, trans);
     if(font->PathVector(glyph)){ ng->_drawable = true;  }
     else {                       ng->_drawable = false; }
+    if (ng->_drawable && font->FontHasSVG()) {
+        // Make the bitmap of an OpenType-SVG glyph now rather than while rendering, which
+        // export does on several threads; making it builds a document.
+        if (auto pixbuf = font->PixBuf(glyph)) {
+            pixbuf->getSurfaceRaw();
+        }
+    }
     ng->_width  = width;   // used especially when _drawable = false, otherwise, it is the advance of the font
     ng->_asc    = ascent;  // of font, not of this one character
     ng->_dsc    = descent; // of font, not of this one character
@@ -0,0 +1,768 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Incremental journal of the changes to a document, for auto-save
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "document-journal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "document.h"
+
+#include "io/sys.h"
+#include "xml/node.h"
+#include "xml/simple-document.h"
+#include "xml/text-node.h"
+
+/*
+ * File format
+ *
+ * The file starts with MAGIC, followed by records. A record is one byte of kind
+ * (RECORD_SNAPSHOT or RECORD_TRANSACTION), the length of the payload as a 32 bit
+ * number and the payload. Numbers are little endian, strings are a 32 bit length
+ * followed by the bytes.
+ *
+ * A payload is a list of operations:
+ *   'K' parent count child*   replace the children of parent
+ *   'A' node count (key value)*   replace the attributes of node
+ *   'X' node has-content content?   set the content of a text, comment or PI node
+ *   'N' node name   rename an element
+ * where a child is one of
+ *   'r' node   an existing node
+ *   'g' first count   the existing nodes first, first + 1, ..., first + count - 1
+ *   's' subtree   a new subtree
+ *
+ * Nodes are numbered in the order they are first written, the document being 0.
+ * A snapshot replaces the children of the document and restarts the numbering.
+ */
+
+namespace Inkscape {
+
+namespace {
+
+char const MAGIC[] = "INKJRNL1\n";
+size_t const MAGIC_LEN = sizeof(MAGIC) - 1;
+
+char const RECORD_SNAPSHOT = 'S';
+char const RECORD_TRANSACTION = 'T';
+size_t const RECORD_HEADER = 5;
+
+void put_u8(std::string &out, char value)
+{
+    out.push_back(value);
+}
+
+void put_u32(std::string &out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+void put_string(std::string &out, char const *value)
+{
+    size_t len = strlen(value);
+    put_u32(out, len);
+    out.append(value, len);
+}
+
+void put_optional_string(std::string &out, char const *value)
+{
+    put_u8(out, value ? 1 : 0);
+    if (value) {
+        put_string(out, value);
+    }
+}
+
+void put_attributes(std::string &out, XML::Node const *node)
+{
+    put_u32(out, node->attributeList().size());
+    for (auto &attr : node->attributeList()) {
+        put_string(out, g_quark_to_string(attr.key));
+        put_string(out, attr.value);
+    }
+}
+
+/// Puts the record header in front of a payload.
+std::string make_record(char kind, std::string const &payload)
+{
+    std::string record;
+    record.reserve(RECORD_HEADER + payload.size());
+    put_u8(record, kind);
+    put_u32(record, payload.size());
+    record += payload;
+    return record;
+}
+
+class Reader
+{
+public:
+    Reader(char const *data, size_t len)
+        : _pos(data)
+        , _end(data + len)
+    {}
+
+    bool ok() const { return _ok; }
+    bool atEnd() const { return _pos == _end; }
+    void fail() { _ok = false; }
+
+    char u8()
+    {
+        if (!_ok || _pos == _end) {
+            _ok = false;
+            return 0;
+        }
+        return *_pos++;
+    }
+
+    uint32_t u32()
+    {
+        if (!_ok || _end - _pos < 4) {
+            _ok = false;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(*_pos++)) << (8 * i);
+        }
+        return value;
+    }
+
+    std::string string()
+    {
+        uint32_t len = u32();
+        if (!_ok || static_cast<size_t>(_end - _pos) < len) {
+            _ok = false;
+            return {};
+        }
+        std::string value(_pos, len);
+        _pos += len;
+        return value;
+    }
+
+private:
+    char const *_pos;
+    char const *_end;
+    bool _ok = true;
+};
+
+/// Applies journal records to a document.
+class Replayer
+{
+public:
+    Replayer()
+        : _doc(new XML::SimpleDocument())
+    {}
+
+    XML::Document *document() { return _doc; }
+
+    bool apply(Reader &in, bool snapshot)
+    {
+        if (snapshot) {
+            _nodes.clear();
+            _nodes.push_back(_doc);
+        }
+        while (in.ok() && !in.atEnd()) {
+            char op = in.u8();
+            switch (op) {
+                case 'K':
+                    readChildren(in);
+                    break;
+                case 'A': {
+                    XML::Node *node = get(in.u32());
+                    if (!node) {
+                        return false;
+                    }
+                    // Start from scratch to keep the order of the attributes.
+                    while (!node->attributeList().empty()) {
+                        node->setAttribute(g_quark_to_string(node->attributeList().front().key), nullptr);
+                    }
+                    uint32_t count = in.u32();
+                    for (uint32_t i = 0; in.ok() && i < count; ++i) {
+                        std::string key = in.string();
+                        std::string value = in.string();
+                        if (in.ok()) {
+                            node->setAttribute(key.c_str(), value.c_str());
+                        }
+                    }
+                    break;
+                }
+                case 'X': {
+                    XML::Node *node = get(in.u32());
+                    bool has_content = in.u8();
+                    std::string content = has_content ? in.string() : std::string();
+                    if (node && in.ok()) {
+                        node->setContent(has_content ? content.c_str() : nullptr);
+                    }
+                    break;
+                }
+                case 'N': {
+                    XML::Node *node = get(in.u32());
+                    std::string name = in.string();
+                    if (node && in.ok()) {
+                        node->setCodeUnsafe(g_quark_from_string(name.c_str()));
+                    }
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return in.ok();
+    }
+
+private:
+    XML::Node *get(uint32_t id)
+    {
+        return id < _nodes.size() ? _nodes[id] : nullptr;
+    }
+
+    void readChildren(Reader &in)
+    {
+        XML::Node *parent = get(in.u32());
+        uint32_t count = in.u32();
+        if (!parent) {
+            in.fail();
+            return;
+        }
+        while (XML::Node *child = parent->firstChild()) {
+            parent->removeChild(child);
+        }
+        for (uint32_t i = 0; in.ok() && i < count; ++i) {
+            switch (in.u8()) {
+                case 'r':
+                    append(parent, get(in.u32()));
+                    break;
+                case 'g': {
+                    uint32_t first = in.u32();
+                    uint32_t run = in.u32();
+                    for (uint32_t j = 0; in.ok() && j < run; ++j) {
+                        append(parent, get(first + j));
+                    }
+                    break;
+                }
+                case 's':
+                    if (XML::Node *child = readSubtree(in)) {
+                        parent->appendChild(child);
+                        GC::release(child);
+                    }
+                    break;
+                default:
+                    in.fail();
+                    return;
+            }
+        }
+    }
+
+    void append(XML::Node *parent, XML::Node *child)
+    {
+        if (!child || child == parent) {
+            return;
+        }
+        if (child->parent()) {
+            child->parent()->removeChild(child);
+        }
+        parent->appendChild(child);
+    }
+
+    XML::Node *readSubtree(Reader &in)
+    {
+        XML::Node *node = nullptr;
+        auto type = static_cast<XML::NodeType>(in.u8());
+        switch (type) {
+            case XML::NodeType::ELEMENT_NODE: {
+                std::string name = in.string();
+                if (name.empty()) {
+                    in.fail();
+                    return nullptr;
+                }
+                node = _doc->createElement(name.c_str());
+                break;
+            }
+            case XML::NodeType::TEXT_NODE: {
+                bool is_CData = in.u8();
+                node = _doc->createTextNode(in.string().c_str(), is_CData);
+                break;
+            }
+            case XML::NodeType::COMMENT_NODE:
+                node = _doc->createComment(in.string().c_str());
+                break;
+            case XML::NodeType::PI_NODE: {
+                std::string target = in.string();
+                node = _doc->createPI(target.c_str(), in.string().c_str());
+                break;
+            }
+            default:
+                in.fail();
+                return nullptr;
+        }
+        _nodes.push_back(node);
+
+        if (type == XML::NodeType::ELEMENT_NODE) {
+            uint32_t attributes = in.u32();
+            for (uint32_t i = 0; in.ok() && i < attributes; ++i) {
+                std::string key = in.string();
+                node->setAttribute(key.c_str(), in.string().c_str());
+            }
+            uint32_t children = in.u32();
+            for (uint32_t i = 0; in.ok() && i < children; ++i) {
+                if (XML::Node *child = readSubtree(in)) {
+                    node->appendChild(child);
+                    GC::release(child);
+                }
+            }
+        }
+        return node;
+    }
+
+    XML::Document *_doc;
+    // Keeps detached nodes alive, as a later transaction may put them back.
+    std::vector<XML::Node *, GC::Alloc<XML::Node *, GC::MANUAL>> _nodes;
+};
+
+} // namespace
+
+DocumentJournal::DocumentJournal(SPDocument *document, std::string filename)
+    : _document(document)
+    , _xml_doc(document->getReprDoc())
+    , _filename(std::move(filename))
+    , _change_observer(*this)
+    , _undo_observer(*this)
+    , _thread(&DocumentJournal::run, this)
+{
+    snapshot();
+    _xml_doc->addSubtreeObserver(_change_observer);
+    _document->addUndoObserver(_undo_observer);
+    _commit_connection = _document->connectCommit(sigc::mem_fun(*this, &DocumentJournal::commit));
+}
+
+DocumentJournal::~DocumentJournal()
+{
+    _commit_connection.disconnect();
+    _document->removeUndoObserver(_undo_observer);
+    _xml_doc->removeSubtreeObserver(_change_observer);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _cond.notify_all();
+    _thread.join();
+
+    // The document goes away in good order, there is nothing left to recover.
+    for (auto filename : {_filename, _filename + ".tmp"}) {
+        gchar *native = g_filename_from_utf8(filename.c_str(), -1, nullptr, nullptr, nullptr);
+        if (native) {
+            g_unlink(native);
+            g_free(native);
+        }
+    }
+}
+
+void DocumentJournal::ChangeObserver::notifyChildAdded(XML::Node &node, XML::Node &, XML::Node *)
+{
+    _journal._structure_changed.insert(&node);
+}
+
+void DocumentJournal::ChangeObserver::notifyChildRemoved(XML::Node &node, XML::Node &child, XML::Node *)
+{
+    _journal._structure_changed.insert(&node);
+    _journal._removed.insert(&child);
+}
+
+void DocumentJournal::ChangeObserver::notifyChildOrderChanged(XML::Node &node, XML::Node &, XML::Node *,
+                                                              XML::Node *)
+{
+    _journal._structure_changed.insert(&node);
+}
+
+void DocumentJournal::ChangeObserver::notifyContentChanged(XML::Node &node, Util::ptr_shared, Util::ptr_shared)
+{
+    _journal._content_changed.insert(&node);
+}
+
+void DocumentJournal::ChangeObserver::notifyAttributeChanged(XML::Node &node, GQuark, Util::ptr_shared,
+                                                             Util::ptr_shared)
+{
+    _journal._attributes_changed.insert(&node);
+}
+
+void DocumentJournal::ChangeObserver::notifyElementNameChanged(XML::Node &node, GQuark, GQuark)
+{
+    _journal._name_changed.insert(&node);
+}
+
+void DocumentJournal::snapshot()
+{
+    _structure_changed.clear();
+    _removed.clear();
+    _content_changed.clear();
+    _name_changed.clear();
+    _attributes_changed.clear();
+
+    _nodes.clear();
+    _nodes[_xml_doc] = 0;
+    _next_id = 1;
+
+    std::string payload;
+    writeChildren(payload, _xml_doc);
+    std::string record = make_record(RECORD_SNAPSHOT, payload);
+    _snapshot_size = record.size();
+    _journal_size = 0;
+    append(std::move(record), true);
+}
+
+void DocumentJournal::commit()
+{
+    if (_structure_changed.empty() && _removed.empty() && _content_changed.empty() &&
+        _name_changed.empty() && _attributes_changed.empty()) {
+        return;
+    }
+
+    uint32_t const first_new = _next_id;
+    // Nodes numbered from first_new on were written in full by this transaction.
+    auto written = [&](XML::Node const *node) {
+        auto it = _nodes.find(node);
+        return it == _nodes.end() ? -1 : it->second >= first_new ? 1 : 0;
+    };
+
+    std::string payload;
+    bool lost_track = false;
+
+    // Parents before children, so that new subtrees are numbered by the time their
+    // descendants are looked at.
+    std::vector<std::pair<int, XML::Node *>> parents;
+    for (auto node : _structure_changed) {
+        int d = depth(node);
+        if (d >= 0) {
+            parents.emplace_back(d, node);
+        }
+    }
+    std::sort(parents.begin(), parents.end());
+    for (auto &entry : parents) {
+        int state = written(entry.second);
+        if (state < 0) {
+            lost_track = true;
+            break;
+        }
+        if (state == 0) {
+            writeChildren(payload, entry.second);
+        }
+    }
+
+    for (auto node : _attributes_changed) {
+        if (lost_track || depth(node) < 0) {
+            continue;
+        }
+        int state = written(node);
+        if (state < 0) {
+            lost_track = true;
+        } else if (state == 0) {
+            put_u8(payload, 'A');
+            put_u32(payload, _nodes[node]);
+            put_attributes(payload, node);
+        }
+    }
+
+    for (auto node : _content_changed) {
+        if (lost_track || depth(node) < 0) {
+            continue;
+        }
+        int state = written(node);
+        if (state < 0) {
+            lost_track = true;
+        } else if (state == 0) {
+            put_u8(payload, 'X');
+            put_u32(payload, _nodes[node]);
+            put_optional_string(payload, node->content());
+        }
+    }
+
+    for (auto node : _name_changed) {
+        if (lost_track || depth(node) < 0) {
+            continue;
+        }
+        int state = written(node);
+        if (state < 0) {
+            lost_track = true;
+        } else if (state == 0) {
+            put_u8(payload, 'N');
+            put_u32(payload, _nodes[node]);
+            put_string(payload, node->name());
+        }
+    }
+
+    if (lost_track) {
+        g_warning("DocumentJournal: lost track of the document structure, starting over.");
+        snapshot();
+        return;
+    }
+
+    // Nodes that are out of the tree now come back, if ever, as new subtrees.
+    for (auto node : _removed) {
+        if (depth(node) < 0) {
+            forget(node);
+        }
+    }
+
+    _structure_changed.clear();
+    _removed.clear();
+    _content_changed.clear();
+    _name_changed.clear();
+    _attributes_changed.clear();
+
+    if (!payload.empty()) {
+        std::string record = make_record(RECORD_TRANSACTION, payload);
+        _journal_size += record.size();
+        append(std::move(record), false);
+    }
+}
+
+void DocumentJournal::sync()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cond.wait(lock, [this] { return _queue.empty() && !_writing; });
+}
+
+/**
+ * Returns the distance from node to the document, or -1 if node is not in the
+ * document.
+ */
+int DocumentJournal::depth(XML::Node const *node) const
+{
+    int d = 0;
+    while (node->parent()) {
+        node = node->parent();
+        ++d;
+    }
+    return node == _xml_doc ? d : -1;
+}
+
+void DocumentJournal::forget(XML::Node const *node)
+{
+    _nodes.erase(node);
+    for (auto child = node->firstChild(); child; child = child->next()) {
+        forget(child);
+    }
+}
+
+void DocumentJournal::writeSubtree(std::string &out, XML::Node const *node)
+{
+    _nodes[node] = _next_id++;
+
+    put_u8(out, static_cast<char>(node->type()));
+    switch (node->type()) {
+        case XML::NodeType::ELEMENT_NODE:
+            put_string(out, node->name());
+            put_attributes(out, node);
+            put_u32(out, node->childCount());
+            for (auto child = node->firstChild(); child; child = child->next()) {
+                writeSubtree(out, child);
+            }
+            break;
+        case XML::NodeType::TEXT_NODE: {
+            auto text = dynamic_cast<XML::TextNode const *>(node);
+            put_u8(out, text && text->is_CData() ? 1 : 0);
+            put_string(out, node->content() ? node->content() : "");
+            break;
+        }
+        case XML::NodeType::COMMENT_NODE:
+            put_string(out, node->content() ? node->content() : "");
+            break;
+        case XML::NodeType::PI_NODE:
+            put_string(out, node->name());
+            put_string(out, node->content() ? node->content() : "");
+            break;
+        case XML::NodeType::DOCUMENT_NODE:
+            g_assert_not_reached();
+            break;
+    }
+}
+
+void DocumentJournal::writeChildren(std::string &out, XML::Node const *parent)
+{
+    put_u8(out, 'K');
+    put_u32(out, _nodes[parent]);
+    // Number of entries, filled in at the end.
+    size_t count_pos = out.size();
+    uint32_t count = 0;
+    put_u32(out, 0);
+
+    // Runs of known nodes in journal order are the common case; write them as one.
+    uint32_t run_first = 0;
+    uint32_t run_count = 0;
+    auto flush_run = [&]() {
+        if (run_count > 0) {
+            ++count;
+        }
+        if (run_count == 1) {
+            put_u8(out, 'r');
+            put_u32(out, run_first);
+        } else if (run_count > 1) {
+            put_u8(out, 'g');
+            put_u32(out, run_first);
+            put_u32(out, run_count);
+        }
+        run_count = 0;
+    };
+
+    for (auto child = parent->firstChild(); child; child = child->next()) {
+        auto it = _nodes.find(child);
+        if (it == _nodes.end()) {
+            flush_run();
+            ++count;
+            put_u8(out, 's');
+            writeSubtree(out, child);
+        } else if (run_count > 0 && it->second == run_first + run_count) {
+            ++run_count;
+        } else {
+            flush_run();
+            run_first = it->second;
+            run_count = 1;
+        }
+    }
+    flush_run();
+
+    std::string count_bytes;
+    put_u32(count_bytes, count);
+    out.replace(count_pos, 4, count_bytes);
+}
+
+void DocumentJournal::append(std::string block, bool restart)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (restart) {
+            // Anything still queued belongs to the old journal.
+            _queue.clear();
+        }
+        _queue.emplace_back(std::move(block), restart);
+    }
+    _cond.notify_all();
+}
+
+/**
+ * Writing thread. A snapshot goes to a temporary file which then replaces the journal, so
+ * that a crash while writing it leaves the previous journal usable.
+ */
+void DocumentJournal::run()
+{
+    FILE *file = nullptr;
+    bool failed = false;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _cond.wait(lock, [this] { return !_queue.empty() || _stopping; });
+        if (_queue.empty()) {
+            break;
+        }
+        auto entry = std::move(_queue.front());
+        _queue.pop_front();
+        _writing = true;
+        lock.unlock();
+
+        if (entry.second) {
+            if (file) {
+                fclose(file);
+            }
+            std::string tmp = _filename + ".tmp";
+            file = Inkscape::IO::fopen_utf8name(tmp.c_str(), "wb");
+            failed = !file || fwrite(MAGIC, 1, MAGIC_LEN, file) != MAGIC_LEN ||
+                     fwrite(entry.first.data(), 1, entry.first.size(), file) != entry.first.size();
+            if (file) {
+                failed = fclose(file) != 0 || failed;
+                file = nullptr;
+            }
+            if (!failed) {
+                gchar *tmp_native = g_filename_from_utf8(tmp.c_str(), -1, nullptr, nullptr, nullptr);
+                gchar *native = g_filename_from_utf8(_filename.c_str(), -1, nullptr, nullptr, nullptr);
+                failed = !tmp_native || !native || g_rename(tmp_native, native) != 0;
+                g_free(tmp_native);
+                g_free(native);
+            }
+            if (!failed) {
+                file = Inkscape::IO::fopen_utf8name(_filename.c_str(), "ab");
+                failed = !file;
+            }
+            if (failed) {
+                g_warning("DocumentJournal: could not write %s", _filename.c_str());
+            }
+        } else if (file && !failed) {
+            failed = fwrite(entry.first.data(), 1, entry.first.size(), file) != entry.first.size() ||
+                     fflush(file) != 0;
+            if (failed) {
+                g_warning("DocumentJournal: could not write %s", _filename.c_str());
+            }
+        }
+
+        lock.lock();
+        _writing = false;
+        _cond.notify_all();
+    }
+    if (file) {
+        fclose(file);
+    }
+}
+
+XML::Document *DocumentJournal::replay(std::string const &filename)
+{
+    gchar *contents = nullptr;
+    gsize length = 0;
+    gchar *native = g_filename_from_utf8(filename.c_str(), -1, nullptr, nullptr, nullptr);
+    bool read = native && g_file_get_contents(native, &contents, &length, nullptr);
+    g_free(native);
+    if (!read) {
+        return nullptr;
+    }
+
+    Replayer replayer;
+    bool have_snapshot = false;
+    if (length >= MAGIC_LEN && memcmp(contents, MAGIC, MAGIC_LEN) == 0) {
+        char const *pos = contents + MAGIC_LEN;
+        char const *end = contents + length;
+        while (static_cast<size_t>(end - pos) >= RECORD_HEADER) {
+            Reader header(pos, RECORD_HEADER);
+            char kind = header.u8();
+            uint32_t len = header.u32();
+            if (static_cast<size_t>(end - pos) - RECORD_HEADER < len) {
+                break; // Cut short while writing.
+            }
+            Reader payload(pos + RECORD_HEADER, len);
+            pos += RECORD_HEADER + len;
+
+            if (kind == RECORD_SNAPSHOT) {
+                have_snapshot = replayer.apply(payload, true);
+            } else if (kind != RECORD_TRANSACTION || !have_snapshot) {
+                break;
+            } else if (!replayer.apply(payload, false)) {
+                g_warning("DocumentJournal: %s is damaged, recovering up to the damage.", filename.c_str());
+                break;
+            }
+        }
+    }
+    g_free(contents);
+    return have_snapshot ? replayer.document() : nullptr;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
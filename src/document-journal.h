@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Incremental journal of the changes to a document, for auto-save
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DOCUMENT_JOURNAL_H
+#define SEEN_INKSCAPE_DOCUMENT_JOURNAL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <sigc++/connection.h>
+
+#include "inkgc/gc-alloc.h"
+#include "undo-stack-observer.h"
+#include "xml/node-observer.h"
+
+class SPDocument;
+
+namespace Inkscape {
+
+namespace XML {
+class Document;
+class Node;
+}
+
+/**
+ * Keeps a journal file from which a document can be rebuilt after a crash.
+ *
+ * The journal starts with a snapshot of the whole XML tree. After that, every
+ * committed change (and every undo and redo) appends one transaction. The
+ * transaction holds the current state of the nodes that changed: attributes,
+ * text content and, for nodes whose children changed, the new list of
+ * children. Unchanged children are referred to by number, and new ones are
+ * written out in full. Encoding happens on the main thread and costs about as
+ * much as the change itself. The file is written by a background thread.
+ *
+ * replay() reads the snapshot and applies the complete transactions after it.
+ * A transaction cut short by a crash is ignored. The file is removed when the
+ * journal is destroyed, so only crashed sessions leave one behind.
+ */
+class DocumentJournal
+{
+public:
+    DocumentJournal(SPDocument *document, std::string filename);
+    ~DocumentJournal();
+
+    DocumentJournal(DocumentJournal const &) = delete;
+    DocumentJournal &operator=(DocumentJournal const &) = delete;
+
+    std::string const &filename() const { return _filename; }
+
+    /// Starts the journal over with a snapshot of the whole tree.
+    void snapshot();
+
+    /// Appends the changes made since the last call, if any.
+    void commit();
+
+    /// Waits until everything appended so far is on disk.
+    void sync();
+
+    /// Size of the last snapshot, in bytes.
+    size_t snapshotSize() const { return _snapshot_size; }
+
+    /// Size of the transactions appended since the last snapshot, in bytes.
+    size_t journalSize() const { return _journal_size; }
+
+    /**
+     * Rebuilds the XML tree saved in a journal file.
+     * @return The document, or nullptr if the file holds no usable snapshot.
+     */
+    static XML::Document *replay(std::string const &filename);
+
+private:
+    class ChangeObserver : public XML::NodeObserver
+    {
+    public:
+        ChangeObserver(DocumentJournal &journal)
+            : _journal(journal)
+        {}
+        void notifyChildAdded(XML::Node &node, XML::Node &child, XML::Node *prev) override;
+        void notifyChildRemoved(XML::Node &node, XML::Node &child, XML::Node *prev) override;
+        void notifyChildOrderChanged(XML::Node &node, XML::Node &child, XML::Node *old_prev,
+                                     XML::Node *new_prev) override;
+        void notifyContentChanged(XML::Node &node, Util::ptr_shared old_content,
+                                  Util::ptr_shared new_content) override;
+        void notifyAttributeChanged(XML::Node &node, GQuark name, Util::ptr_shared old_value,
+                                    Util::ptr_shared new_value) override;
+        void notifyElementNameChanged(XML::Node &node, GQuark old_name, GQuark new_name) override;
+
+    private:
+        DocumentJournal &_journal;
+    };
+
+    class UndoObserver : public UndoStackObserver
+    {
+    public:
+        UndoObserver(DocumentJournal &journal)
+            : _journal(journal)
+        {}
+        void notifyUndoEvent(Event *) override { _journal.commit(); }
+        void notifyRedoEvent(Event *) override { _journal.commit(); }
+        void notifyUndoCommitEvent(Event *) override {}
+        void notifyClearUndoEvent() override {}
+        void notifyClearRedoEvent() override {}
+
+    private:
+        DocumentJournal &_journal;
+    };
+
+    template <typename T>
+    using Alloc = GC::Alloc<T, GC::MANUAL>;
+    // Keys are scanned so that nodes known to the journal are never collected and reused.
+    using NodeMap = std::unordered_map<XML::Node const *, uint32_t, std::hash<XML::Node const *>,
+                                       std::equal_to<XML::Node const *>,
+                                       Alloc<std::pair<XML::Node const *const, uint32_t>>>;
+    using NodeSet = std::unordered_set<XML::Node *, std::hash<XML::Node *>, std::equal_to<XML::Node *>,
+                                       Alloc<XML::Node *>>;
+
+    int depth(XML::Node const *node) const;
+    void forget(XML::Node const *node);
+    void writeSubtree(std::string &out, XML::Node const *node);
+    void writeChildren(std::string &out, XML::Node const *parent);
+    void append(std::string block, bool restart);
+    void run();
+
+    SPDocument *_document;
+    XML::Document *_xml_doc;
+    std::string _filename;
+
+    ChangeObserver _change_observer;
+    UndoObserver _undo_observer;
+    sigc::connection _commit_connection;
+
+    NodeMap _nodes;
+    uint32_t _next_id = 0;
+
+    // Changes since the last commit().
+    NodeSet _structure_changed;
+    NodeSet _removed;
+    NodeSet _content_changed;
+    NodeSet _name_changed;
+    NodeSet _attributes_changed;
+
+    size_t _snapshot_size = 0;
+    size_t _journal_size = 0;
+
+    // Background writer.
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::deque<std::pair<std::string, bool>> _queue;
+    bool _writing = false;
+    bool _stopping = false;
+    std::thread _thread;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DOCUMENT_JOURNAL_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
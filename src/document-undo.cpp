@@ -53,6 +53,7 @@
 #include "debug/simple-event.h"
 #include "debug/timestamp.h"
 #include "event.h"
+#include "preferences.h"
 
 
 /*
@@ -84,6 +85,25 @@ bool Inkscape::DocumentUndo::getUndoSensitive(SPDocument const *document) {
 	return document->sensitive;
 }
 
+/**
+ * Estimate of the memory held by the undo and redo history of a document, leaving out the
+ * steps moved out by limit_memory().
+ */
+size_t Inkscape::DocumentUndo::getUndoMemory(SPDocument const *document)
+{
+    g_assert(document != nullptr);
+
+    size_t total = 0;
+    for (auto stack : {&document->undo, &document->redo}) {
+        for (auto event : *stack) {
+            if (!event->spilled) {
+                total += event->memory;
+            }
+        }
+    }
+    return total;
+}
+
 void Inkscape::DocumentUndo::done(SPDocument *doc, const unsigned int event_type, Glib::ustring const &event_description)
 {
     if (doc->sensitive) {
@@ -91,6 +111,28 @@ void Inkscape::DocumentUndo::done(SPDocument *doc, const unsigned int event_type
     }
 }
 
+Inkscape::DocumentUndo::ScopedBatch::ScopedBatch(SPDocument *doc, unsigned int event_type,
+                                                  Glib::ustring const &event_description)
+    : m_doc(doc)
+{
+    g_assert(doc != nullptr);
+    m_doc->beginBatch();
+    if (m_doc->_batch_description.empty()) {
+        m_doc->_batch_event_type = event_type;
+        m_doc->_batch_description = event_description;
+    }
+}
+
+Inkscape::DocumentUndo::ScopedBatch::~ScopedBatch()
+{
+    m_doc->endBatch();
+    if (!m_doc->isBatching() && !m_doc->_batch_description.empty()) {
+        Glib::ustring description = m_doc->_batch_description;
+        m_doc->_batch_description.clear();
+        done(m_doc, m_doc->_batch_event_type, description);
+    }
+}
+
 void Inkscape::DocumentUndo::resetKey( SPDocument *doc )
 {
     doc->actionkey.clear();
@@ -134,6 +176,15 @@ void Inkscape::DocumentUndo::maybeDone(SPDocument *doc, const gchar *key, const
             g_warning("Blank undo key specified.");
         }
 
+        if (doc->isBatching()) {
+            // committed when the outermost ScopedBatch ends
+            if (doc->_batch_description.empty()) {
+                doc->_batch_event_type = event_type;
+                doc->_batch_description = event_description;
+            }
+            return;
+        }
+
         Inkscape::Debug::EventTracker<CommitEvent> tracker(doc, key, event_type);
 
 	doc->collectOrphans();
@@ -150,9 +201,11 @@ void Inkscape::DocumentUndo::maybeDone(SPDocument *doc, const gchar *key, const
 		return;
 	}
 
-	if (key && !doc->actionkey.empty() && (doc->actionkey == key) && !doc->undo.empty()) {
+	if (key && !doc->actionkey.empty() && (doc->actionkey == key) && !doc->undo.empty() &&
+	    restore_spilled(*doc, doc->undo.back())) {
                 (doc->undo.back())->event =
                     sp_repr_coalesce_log ((doc->undo.back())->event, log);
+                (doc->undo.back())->memory = sp_repr_log_memory((doc->undo.back())->event);
 	} else {
                 Inkscape::Event *event = new Inkscape::Event(log, event_type, event_description);
                 doc->undo.push_back(event);
@@ -166,6 +219,8 @@ void Inkscape::DocumentUndo::maybeDone(SPDocument *doc, const gchar *key, const
             doc->actionkey.clear();
         }
 
+        limit_memory(*doc);
+
 	doc->virgin = FALSE;
         doc->setModifiedSinceSave();
 
@@ -218,9 +273,10 @@ void Inkscape::DocumentUndo::perform_document_update(SPDocument &doc) {
         sp_repr_debug_print_log(update_log);
 
         //Coalesce the update changes with the last action performed by user
-        if (!doc.undo.empty()) {
+        if (!doc.undo.empty() && restore_spilled(doc, doc.undo.back())) {
             Inkscape::Event* undo_stack_top = doc.undo.back();
             undo_stack_top->event = sp_repr_coalesce_log(undo_stack_top->event, update_log);
+            undo_stack_top->memory = sp_repr_log_memory(undo_stack_top->event);
         } else {
             sp_repr_free_log(update_log);
         }
@@ -246,6 +302,11 @@ gboolean Inkscape::DocumentUndo::undo(SPDocument *doc)
 
     finish_incomplete_transaction(*doc);
 
+    if (! doc->undo.empty() && ! restore_spilled(*doc, doc->undo.back())) {
+        g_warning("Lost the older undo history of the document.");
+        clearUndo(doc);
+    }
+
     if (! doc->undo.empty()) {
 	    Inkscape::Event *log = doc->undo.back();
 	    doc->undo.pop_back();
@@ -318,6 +379,73 @@ gboolean Inkscape::DocumentUndo::redo(SPDocument *doc)
 	return ret;
 }
 
+/**
+ * Keeps the memory used by the undo history of a document under "/options/undo/memorylimit"
+ * (in MiB, 0 for no limit). The oldest steps are compacted first. If that is not enough, they
+ * are moved to a temporary file, from which undo() reads them back when it gets there. The
+ * latest step is left alone.
+ *
+ * Nodes removed by a step stay in memory even when the step is moved out, as the step refers
+ * to them.
+ */
+void Inkscape::DocumentUndo::limit_memory(SPDocument &doc)
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    size_t limit = static_cast<size_t>(prefs->getIntLimited("/options/undo/memorylimit", 256, 0, 65536)) << 20;
+    if (limit == 0 || doc.undo.size() < 2) {
+        return;
+    }
+
+    size_t total = getUndoMemory(&doc);
+    auto const latest = doc.undo.end() - 1;
+    for (auto it = doc.undo.begin(); it != latest && total > limit; ++it) {
+        Inkscape::Event *event = *it;
+        if (event->spilled || event->compacted) {
+            continue;
+        }
+        total -= event->memory;
+        event->event = sp_repr_compact_log(event->event);
+        event->memory = sp_repr_log_memory(event->event);
+        event->compacted = true;
+        total += event->memory;
+    }
+
+    for (auto it = doc.undo.begin(); it != latest && total > limit; ++it) {
+        Inkscape::Event *event = *it;
+        if (event->spilled || !event->event) {
+            continue;
+        }
+        if (!doc.undo_spill) {
+            doc.undo_spill = std::make_unique<Inkscape::XML::EventSpill>();
+        }
+        auto spilled = doc.undo_spill->spill(event->event);
+        if (!spilled) {
+            break;
+        }
+        event->event = nullptr;
+        event->spilled = std::move(spilled);
+        total -= event->memory;
+    }
+}
+
+/**
+ * Reads an undo step moved out by limit_memory() back into memory.
+ * @return false if that failed.
+ */
+bool Inkscape::DocumentUndo::restore_spilled(SPDocument &doc, Inkscape::Event *event)
+{
+    if (!event->spilled) {
+        return true;
+    }
+    Inkscape::XML::Event *log = doc.undo_spill ? doc.undo_spill->restore(*event->spilled) : nullptr;
+    if (!log) {
+        return false;
+    }
+    event->event = log;
+    event->spilled.reset();
+    return true;
+}
+
 void Inkscape::DocumentUndo::clearUndo(SPDocument *doc)
 {
     if (! doc->undo.empty())
@@ -328,6 +456,8 @@ void Inkscape::DocumentUndo::clearUndo(SPDocument *doc)
         delete e;
         doc->history_size--;
     }
+    // Only undo steps get moved out.
+    doc->undo_spill.reset();
 }
 
 void Inkscape::DocumentUndo::clearRedo(SPDocument *doc)
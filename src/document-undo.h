@@ -11,15 +11,14 @@
 #define SEEN_SP_DOCUMENT_UNDO_H
 
 #include <glib.h>   // gboolean, gchar
-
-namespace Glib {
-    class ustring;
-}
+#include <glibmm/ustring.h>
 
 class SPDocument;
 
 namespace Inkscape {
 
+struct Event;
+
 class DocumentUndo
 {
 public:
@@ -33,6 +32,8 @@ public:
 
     static bool getUndoSensitive(SPDocument const *document);
 
+    static size_t getUndoMemory(SPDocument const *document);
+
     static void clearUndo(SPDocument *document);
 
     static void clearRedo(SPDocument *document);
@@ -46,6 +47,10 @@ private:
 
     static void perform_document_update(SPDocument &document);
 
+    static void limit_memory(SPDocument &document);
+
+    static bool restore_spilled(SPDocument &document, Event *event);
+
 public:
     static void resetKey(SPDocument *document);
 
@@ -78,6 +83,34 @@ public:
         }
         ~ScopedInsensitive() { setUndoSensitive(m_doc, m_saved); }
     };
+
+    /**
+     * RAII-style mechanism for bulk edits of the XML tree.
+     *
+     * Inside the scope, objects do not re-read changed attributes one by one; the document
+     * only records which attributes of which objects were touched, and done()/maybeDone()
+     * do not commit. When the outermost scope ends, each touched attribute is read once,
+     * the document is updated once and, if an event description was given to a scope or to
+     * done()/maybeDone() inside it, all changes become a single undo step. The first
+     * description given is the one kept.
+     *
+     * Code inside the scope must not rely on SPObjects reflecting its own XML changes.
+     *
+     * \verbatim
+        {
+            DocumentUndo::ScopedBatch batch(document, 0, "Set attributes");
+            ... set many attributes ...
+        } \endverbatim
+     */
+    class ScopedBatch {
+        SPDocument * m_doc;
+
+      public:
+        ScopedBatch(SPDocument *doc, unsigned int event_type = 0, Glib::ustring const &event_description = "");
+        ~ScopedBatch();
+        ScopedBatch(ScopedBatch const &) = delete;
+        ScopedBatch &operator=(ScopedBatch const &) = delete;
+    };
 };
 
 } // namespace Inkscape
@@ -37,6 +37,7 @@
 #define noSP_DOCUMENT_DEBUG_IDLE
 #define noSP_DOCUMENT_DEBUG_UNDO
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -56,6 +57,10 @@
 
 #include "actions/actions-canvas-snapping.h"
 
+#include "debug/logger.h"
+#include "debug/simple-event.h"
+#include "debug/timing-report.h"
+
 #include "display/drawing.h"
 
 #include "3rdparty/adaptagrams/libavoid/router.h"
@@ -66,6 +71,7 @@
 
 #include "live_effects/lpeobject.h"
 #include "object/persp3d.h"
+#include "object/preparsed-attributes.h"
 #include "object/sp-defs.h"
 #include "object/sp-factory.h"
 #include "object/sp-root.h"
@@ -174,12 +180,35 @@ SPDocument::~SPDocument() {
     DocumentUndo::clearRedo(this);
     DocumentUndo::clearUndo(this);
 
+    for (auto object : _batch_objects) {
+        sp_object_unref(object, nullptr);
+    }
+    _batch_objects.clear();
+
+    _finishUpdatePass();
+    for (auto object : _update_queue) {
+        sp_object_unref(object, nullptr);
+    }
+    _update_queue.clear();
+
+    /* From here on, objects releasing themselves skip the bookkeeping which only matters
+     * to a document that lives on: id and repr maps, resource lists, href totals of
+     * ancestors and the update and orphan queues. */
+    _destroying = true;
+
     if (root) {
         root->releaseReferences();
         sp_object_unref(root);
         root = nullptr;
     }
 
+    iddef.clear();
+    reprdef.clear();
+    for (auto object : _collection_queue) {
+        sp_object_unref(object, nullptr);
+    }
+    _collection_queue.clear();
+
     if (rdoc) Inkscape::GC::release(rdoc);
 
     /* Free resources */
@@ -289,6 +318,10 @@ void SPDocument::queueForOrphanCollection(SPObject *object) {
     g_return_if_fail(object != nullptr);
     g_return_if_fail(object->document == this);
 
+    if (_destroying) {
+        return;
+    }
+
     sp_object_ref(object, nullptr);
     _collection_queue.push_back(object);
 }
@@ -304,12 +337,166 @@ void SPDocument::collectOrphans() {
     }
 }
 
+/**
+ * Remember an object which got its update or modified flags set, so that the next
+ * update pass can visit it without scanning all children of its ancestors.
+ */
+void SPDocument::queueForUpdate(SPObject *object) {
+    g_return_if_fail(object != nullptr);
+    g_return_if_fail(object->document == this);
+
+    if (_destroying) {
+        return;
+    }
+
+    sp_object_ref(object, nullptr);
+    _update_queue.push_back(object);
+    update_stats.queued++;
+}
+
+/**
+ * Children of \a parent which are dirty or have dirty descendants, in the current update
+ * pass. Returns nullptr if the pass does not track them, in which case all children have
+ * to be checked.
+ */
+std::vector<SPObject *> const *SPDocument::getDirtyChildren(SPObject const *parent) const
+{
+    static std::vector<SPObject *> const none;
+
+    if (!_dirty_children_valid) {
+        return nullptr;
+    }
+    auto it = _dirty_children.find(parent);
+    return it != _dirty_children.end() ? &it->second : &none;
+}
+
+namespace {
+
+/// Above this many queued objects a plain walk over the tree is cheaper than the index.
+std::size_t const UPDATE_QUEUE_LIMIT = 10000;
+
+}
+
+/**
+ * Move the update queue into the dirty children index of the current pass.
+ *
+ * Every queued object is registered with its parent, then the parent with its own parent
+ * and so on, until an already registered ancestor is reached.
+ */
+void SPDocument::_collectDirtyChildren()
+{
+    if (_update_pass.empty()) {
+        _dirty_children_valid = _update_queue.size() <= UPDATE_QUEUE_LIMIT;
+    }
+
+    for (auto object : _update_queue) {
+        _update_pass.push_back(object);
+        if (!_dirty_children_valid || object->document != this) {
+            continue;
+        }
+        for (SPObject *child = object; child->parent; child = child->parent) {
+            if (!_dirty_registered.insert(child).second) {
+                break;
+            }
+            sp_object_ref(child, nullptr);
+            _dirty_children[child->parent].push_back(child);
+            update_stats.dirty_children++;
+        }
+    }
+    _update_queue.clear();
+}
+
+/**
+ * Drop the dirty children index. Queued objects the pass did not get to are queued again.
+ */
+void SPDocument::_finishUpdatePass()
+{
+    for (auto &entry : _dirty_children) {
+        for (auto child : entry.second) {
+            sp_object_unref(child, nullptr);
+        }
+    }
+    _dirty_children.clear();
+    _dirty_registered.clear();
+    _dirty_children_valid = false;
+
+    for (auto object : _update_pass) {
+        if (object->document == this && (object->uflags || object->mflags)) {
+            _update_queue.push_back(object);
+        } else {
+            sp_object_unref(object, nullptr);
+        }
+    }
+    _update_pass.clear();
+}
+
+void SPDocument::beginBatch()
+{
+    _batch_depth++;
+}
+
+/**
+ * Close a batch; when the outermost one closes, re-read every attribute changed inside it
+ * once, in the order objects were first touched, and bring the document up to date.
+ */
+void SPDocument::endBatch()
+{
+    g_return_if_fail(_batch_depth > 0);
+
+    if (--_batch_depth > 0) {
+        return;
+    }
+
+    // Reading attributes may queue new reads if it changes the tree, keep going until done
+    while (!_batch_objects.empty()) {
+        std::vector<SPObject *> objects;
+        objects.swap(_batch_objects);
+        auto attributes = std::move(_batch_attributes);
+        _batch_attributes.clear();
+
+        for (auto object : objects) {
+            if (object->document == this && object->getRepr()) {
+                for (auto key : attributes[object]) {
+                    object->readAttr(g_quark_to_string(key));
+                }
+            }
+            sp_object_unref(object, nullptr);
+        }
+    }
+
+    ensureUpToDate();
+}
+
+/**
+ * Defer SPObject::readAttr() of \a key on \a object until the current batch ends.
+ */
+void SPDocument::queueAttributeRead(SPObject *object, char const *key)
+{
+    g_return_if_fail(object != nullptr);
+    g_return_if_fail(_batch_depth > 0);
+
+    if (_destroying) {
+        return;
+    }
+
+    auto &keys = _batch_attributes[object];
+    if (keys.empty()) {
+        sp_object_ref(object, nullptr);
+        _batch_objects.push_back(object);
+    }
+    GQuark quark = g_quark_from_string(key);
+    if (std::find(keys.begin(), keys.end(), quark) == keys.end()) {
+        keys.push_back(quark);
+    }
+}
+
 SPDocument *SPDocument::createDoc(Inkscape::XML::Document *rdoc,
                                   gchar const *document_uri,
                                   gchar const *document_base,
                                   gchar const *document_name,
                                   bool keepalive,
-                                  SPDocument *parent)
+                                  SPDocument *parent,
+                                  Inkscape::PreparsedAttributes *preparsed)
 {
     SPDocument *document = new SPDocument();
 
@@ -366,8 +553,23 @@ SPDocument *SPDocument::createDoc(Inkscape::XML::Document *rdoc,
     	throw;
     }
 
-    // Recursively build object tree
-    document->root->invoke_build(document, rroot, false);
+    {
+        Inkscape::Debug::PhaseTracker tracker("object-build");
+
+        // Path data and transforms don't depend on the object tree, parse them on all cores first,
+        // unless they came along with the XML from the document cache
+        if (preparsed && preparsed->size()) {
+            document->_preparsed = std::make_unique<Inkscape::PreparsedAttributes>(std::move(*preparsed));
+        } else if (Inkscape::PreparsedAttributes::threads() > 1 &&
+                   Inkscape::Preferences::get()->getBool("/options/svgload/parallel", true)) {
+            document->_preparsed = std::make_unique<Inkscape::PreparsedAttributes>();
+            document->_preparsed->parse(rroot);
+        }
+
+        // Recursively build object tree
+        document->root->invoke_build(document, rroot, false);
+        document->_preparsed.reset();
+    }
 
     /* Eliminate obsolete sodipodi:docbase, for privacy reasons */
     rroot->removeAttribute("sodipodi:docbase");
@@ -521,11 +723,15 @@ SPDocument *SPDocument::createNewDoc(gchar const *document_uri, bool keepalive,
     Inkscape::XML::Document *rdoc = nullptr;
     gchar *document_base = nullptr;
     gchar *document_name = nullptr;
+    Inkscape::PreparsedAttributes preparsed;
 
     if (document_uri) {
         Inkscape::XML::Node *rroot;
         /* Try to fetch repr from file */
-        rdoc = sp_repr_read_file(document_uri, SP_SVG_NS_URI);
+        {
+            Inkscape::Debug::PhaseTracker tracker("xml-parsing");
+            rdoc = sp_repr_read_file(document_uri, SP_SVG_NS_URI, &preparsed);
+        }
         /* If file cannot be loaded, return NULL without warning */
         if (rdoc == nullptr) return nullptr;
         rroot = rdoc->root();
@@ -558,7 +764,7 @@ SPDocument *SPDocument::createNewDoc(gchar const *document_uri, bool keepalive,
     //# These should be set by now
     g_assert(document_name);
 
-    SPDocument *doc = createDoc(rdoc, document_uri, document_base, document_name, keepalive, parent);
+    SPDocument *doc = createDoc(rdoc, document_uri, document_base, document_name, keepalive, parent, &preparsed);
 
     g_free(document_base);
     g_free(document_name);
@@ -570,17 +776,30 @@ SPDocument *SPDocument::createNewDocFromMem(gchar const *buffer, gint length, bo
 {
     SPDocument *doc = nullptr;
 
-    Inkscape::XML::Document *rdoc = sp_repr_read_mem(buffer, length, SP_SVG_NS_URI);
+    Inkscape::XML::Document *rdoc = nullptr;
+    {
+        Inkscape::Debug::PhaseTracker tracker("xml-parsing");
+        rdoc = sp_repr_read_mem(buffer, length, SP_SVG_NS_URI);
+    }
     if ( rdoc ) {
         // Only continue to create a non-null doc if it could be loaded
-        Inkscape::XML::Node *rroot = rdoc->root();
-        if ( strcmp(rroot->name(), "svg:svg") != 0 ) {
-            // If xml file is not svg, return NULL without warning
-            // TODO fixme: destroy document
-        } else {
-            Glib::ustring document_name = Glib::ustring::compose( _("Memory document %1"), ++doc_mem_count );
-            doc = createDoc(rdoc, nullptr, nullptr, document_name.c_str(), keepalive, nullptr);
-        }
+        doc = createNewDocFromRepr(rdoc, keepalive);
+    }
+
+    return doc;
+}
+
+SPDocument *SPDocument::createNewDocFromRepr(Inkscape::XML::Document *rdoc, bool keepalive)
+{
+    SPDocument *doc = nullptr;
+
+    Inkscape::XML::Node *rroot = rdoc->root();
+    if ( strcmp(rroot->name(), "svg:svg") != 0 ) {
+        // If xml file is not svg, return NULL without warning
+        // TODO fixme: destroy document
+    } else {
+        Glib::ustring document_name = Glib::ustring::compose( _("Memory document %1"), ++doc_mem_count );
+        doc = createDoc(rdoc, nullptr, nullptr, document_name.c_str(), keepalive, nullptr);
     }
 
     return doc;
@@ -977,7 +1196,8 @@ void SPDocument::bindObjectToId(gchar const *id, SPObject *object) {
 
 SPObject *SPDocument::getObjectById(Glib::ustring const &id) const
 {
-    if (iddef.empty()) {
+    // the map is not kept up to date while the object tree is torn down
+    if (iddef.empty() || _destroying) {
         return nullptr;
     }
 
@@ -1116,6 +1336,9 @@ void SPDocument::bindObjectToRepr(Inkscape::XML::Node *repr, SPObject *object)
 SPObject *SPDocument::getObjectByRepr(Inkscape::XML::Node *repr) const
 {
     g_return_val_if_fail(repr != nullptr, NULL);
+    if (_destroying) {
+        return nullptr;
+    }
     std::map<Inkscape::XML::Node *, SPObject *>::const_iterator rv = reprdef.find(repr);
     if(rv != reprdef.end())
         return (rv->second);
@@ -1184,16 +1407,44 @@ void SPDocument::setupViewport(SPItemCtx *ctx)
     ctx->i2vp = Geom::identity();
 }
 
+namespace {
+
+using Inkscape::Debug::Event;
+using Inkscape::Debug::SimpleEvent;
+
+class UpdatePassEvent : public SimpleEvent<Event::DOCUMENT> {
+public:
+    UpdatePassEvent(SPDocument const *doc, bool indexed)
+    : SimpleEvent<Event::DOCUMENT>("update-pass")
+    {
+        _addProperty("document", doc->serial());
+        _addProperty("indexed", indexed ? "true" : "false");
+        _addProperty("queued", doc->update_stats.queued);
+        _addProperty("dirty-children", doc->update_stats.dirty_children);
+        _addProperty("updated", doc->update_stats.updated);
+        _addProperty("modified", doc->update_stats.modified);
+    }
+};
+
+}
+
 /**
  * Tries to update the document state based on the modified and
  * "update required" flags, and return true if the document has
  * been brought fully up to date.
+ *
+ * Groups only descend into the children returned by getDirtyChildren(), which are
+ * collected from the update queue before the update and before the modified walk.
  */
 bool
 SPDocument::_updateDocument(int update_flags)
 {
     /* Process updates */
     if (this->root->uflags || this->root->mflags) {
+        update_stats.dirty_children = update_stats.updated = update_stats.modified = 0;
+        _collectDirtyChildren();
+        bool indexed = _dirty_children_valid;
+
         if (this->root->uflags) {
             SPItemCtx ctx;
             setupViewport(&ctx);
@@ -1202,7 +1453,13 @@ SPDocument::_updateDocument(int update_flags)
 
             this->root->updateDisplay((SPCtx *)&ctx, update_flags);
         }
+        // Objects which requested modification during the update are emitted in this pass too
+        _collectDirtyChildren();
         this->_emitModified();
+
+        _finishUpdatePass();
+        Inkscape::Debug::Logger::write<UpdatePassEvent>(this, indexed);
+        update_stats.queued = 0;
     }
 
     return !(this->root->uflags || this->root->mflags);
@@ -1222,6 +1479,7 @@ gint SPDocument::ensureUpToDate()
     //   1a) Process all document updates.
     //   1b) When completed, process connector routing changes.
     //   2a) Process any updates resulting from connector reroutings.
+    Inkscape::Debug::PhaseTracker tracker("update");
     int counter = 32;
     for (unsigned int pass = 1; pass <= 2; ++pass) {
         // Process document updates.
@@ -1609,12 +1867,17 @@ bool SPDocument::removeResource(gchar const *key, SPObject *object)
 
     bool result = false;
 
+    if (_destroying) {
+        // the lists are dropped as a whole and nobody is left to be told
+        return true;
+    }
+
     if ( !object->cloned ) {
-        std::vector<SPObject *> rlist = resources[key];
+        std::vector<SPObject *> &rlist = resources[key];
         g_return_val_if_fail(!rlist.empty(), false);
-        std::vector<SPObject*>::iterator it = std::find(resources[key].begin(),resources[key].end(),object);
+        std::vector<SPObject*>::iterator it = std::find(rlist.begin(),rlist.end(),object);
         g_return_val_if_fail(it != rlist.end(), false);
-        resources[key].erase(it);
+        rlist.erase(it);
 
         GQuark q = g_quark_from_string(key);
         resources_changed_signals[q].emit();
@@ -1993,6 +2256,7 @@ void SPDocument::_emitModified() {
     root->emitModified(0);
     modified_signal.emit(flags);
     _node_cache_valid=false;
+    _modification_count++;
 }
 
 void
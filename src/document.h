@@ -23,6 +23,8 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <boost/ptr_container/ptr_list.hpp>
@@ -76,6 +78,7 @@ class SPGroup;
 class SPRoot;
 
 namespace Inkscape {
+    class PreparsedAttributes;
     class Selection; 
     class UndoStackObserver;
     class EventLog;
@@ -106,7 +109,8 @@ class SPDocument : public Inkscape::GC::Managed<>,
 {
 
 public:
-    /// For sanity check in SPObject::requestDisplayUpdate
+    /// Depth of SPObject::updateDisplay() calls; for sanity check in SPObject::requestDisplayUpdate
+    /// and to keep SPItem from caching bounding boxes mid-update
     unsigned update_in_progress = 0;
 
     /************ Functions *****************/
@@ -121,14 +125,18 @@ public:
     // Document creation ------------------
     static SPDocument *createDoc(Inkscape::XML::Document *rdoc, char const *uri,
             char const *base, char const *name, bool keepalive,
-            SPDocument *parent);
+            SPDocument *parent, Inkscape::PreparsedAttributes *preparsed = nullptr);
     static SPDocument *createNewDoc(char const*uri, bool keepalive,
             bool make_new = false, SPDocument *parent=nullptr );
     static SPDocument *createNewDocFromMem(char const*buffer, int length, bool keepalive);
+    /// Creates a document from an XML tree that was read or built in memory.
+    static SPDocument *createNewDocFromRepr(Inkscape::XML::Document *rdoc, bool keepalive);
            SPDocument *createChildDoc(std::string const &uri);
 
 
     // Document status --------------------
+    /// True while the destructor tears down the object tree, see ~SPDocument().
+    bool isDestroying() const { return _destroying; }
     void setVirgin(bool Virgin) { virgin = Virgin; }
     bool getVirgin() { return virgin; }
 
@@ -193,6 +201,9 @@ public:
     // Styling
     CRCascade    *getStyleCascade() { return style_cascade; }
 
+    /** Attribute values parsed ahead of time, only available while the object tree is built. */
+    Inkscape::PreparsedAttributes *getPreparsedAttributes() { return _preparsed.get(); }
+
     // File information --------------------
 
     /** A filename (not a URI yet), or NULL */
@@ -290,6 +301,32 @@ public:
     void collectOrphans();
 
 
+    // Update queue ----------------------------
+    void queueForUpdate(SPObject *object);
+    std::vector<SPObject *> const *getDirtyChildren(SPObject const *parent) const;
+
+    /// Counters of the current update pass, reported through the debug logger.
+    struct UpdateStats {
+        unsigned long queued = 0;
+        unsigned long dirty_children = 0;
+        unsigned long updated = 0;
+        unsigned long modified = 0;
+    };
+    UpdateStats update_stats;
+
+    /// Counts the update passes that modified objects, so that content rendered from the
+    /// document can be reused while it stays the same.
+    unsigned long modificationCount() const { return _modification_count; }
+
+
+    // Batched edits ---------------------------
+    // Use DocumentUndo::ScopedBatch rather than calling these directly.
+    void beginBatch();
+    void endBatch();
+    bool isBatching() const { return _batch_depth > 0; }
+    void queueAttributeRead(SPObject *object, char const *key);
+
+
     // Actions ---------------------------------
     Glib::RefPtr<Gio::SimpleActionGroup> getActionGroup() { return action_group; }
 
@@ -303,6 +340,7 @@ private:
     // Document status -----------------------
 
     bool keepalive; ///< false if temporary document (e.g. to generate a PNG for display in a dialog).
+    bool _destroying = false;
     bool virgin ;   ///< Has the document never been touched?
     bool modified_since_save = false;
     bool modified_since_autosave = false;
@@ -323,6 +361,8 @@ private:
     // Styling
     CRCascade *style_cascade;
 
+    std::unique_ptr<Inkscape::PreparsedAttributes> _preparsed;
+
     // File information ----------------------
     char *document_uri;   ///< A filename (not a URI yet), or NULL
     char *document_base;  ///< To be used for resolving relative hrefs.
@@ -336,6 +376,8 @@ private:
     mutable std::deque<SPItem*> _node_cache; // Used to speed up search.
     mutable bool _node_cache_valid;
 
+    unsigned long _modification_count = 0;
+
     // Box tool ----------------------------
     Persp3D *current_persp3d; /**< Currently 'active' perspective (to which, e.g., newly created boxes are attached) */
     Persp3DImpl *current_persp3d_impl;
@@ -349,6 +391,7 @@ private:
     int history_size;
     std::vector<Inkscape::Event *> undo; /* Undo stack of reprs */
     std::vector<Inkscape::Event *> redo; /* Redo stack of reprs */
+    std::unique_ptr<Inkscape::XML::EventSpill> undo_spill; /* Old undo steps written out to disk */
 
     /* Undo listener */
     Inkscape::CompositeUndoStackObserver undoStackObservers;
@@ -364,6 +407,26 @@ private:
 
     std::vector<SPObject *> _collection_queue; ///< Orphans
 
+    // Update queue ----------------------------
+
+    std::vector<SPObject *> _update_queue; ///< Objects which got update or modified flags set, referenced
+    std::vector<SPObject *> _update_pass;  ///< Queue entries consumed by the current update pass
+    /// For every ancestor of a dirty object, its children which lead to dirty objects (referenced)
+    std::unordered_map<SPObject const *, std::vector<SPObject *>> _dirty_children;
+    std::unordered_set<SPObject const *> _dirty_registered;
+    bool _dirty_children_valid = false;
+
+    void _collectDirtyChildren();
+    void _finishUpdatePass();
+
+    // Batched edits ---------------------------
+
+    unsigned _batch_depth = 0;
+    std::vector<SPObject *> _batch_objects; ///< Objects with deferred attribute reads, in order, referenced
+    std::unordered_map<SPObject *, std::vector<GQuark>> _batch_attributes;
+    unsigned _batch_event_type = 0;
+    Glib::ustring _batch_description; ///< Of the undo step committed when the outermost batch ends
+
     // Actions ---------------------------------
     Glib::RefPtr<Gio::SimpleActionGroup> action_group;
 
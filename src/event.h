@@ -17,9 +17,11 @@
 
 #include <glibmm/ustring.h>
 
+#include <memory>
 #include <utility>
 
 #include "xml/event-fns.h"
+#include "xml/event-spill.h"
 #include "verbs.h"
 
 namespace Inkscape {
@@ -33,13 +35,20 @@ namespace Inkscape {
 struct Event {
      
     Event(XML::Event *_event, unsigned int _type=SP_VERB_NONE, Glib::ustring _description="")
-        : event (_event), type (_type), description (std::move(_description))  { }
+        : event (_event), type (_type), description (std::move(_description)), memory (sp_repr_log_memory(_event))  { }
 
     virtual ~Event() { sp_repr_free_log (event); }
 
     XML::Event *event;
     const unsigned int type;
     Glib::ustring description;
+
+    /// Estimate of the memory held by event, see sp_repr_log_memory().
+    size_t memory;
+    /// Whether event went through sp_repr_compact_log() already.
+    bool compacted = false;
+    /// Where event is while it is written out to disk; event is null meanwhile.
+    std::unique_ptr<XML::SpilledLog> spilled;
 };
 
 } // namespace Inkscape
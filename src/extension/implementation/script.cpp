@@ -23,11 +23,13 @@
 #include <gtkmm/textview.h>
 
 #include "desktop.h"
+#include "document-undo.h"
 #include "inkscape.h"
 #include "path-prefix.h"
 #include "preferences.h"
 #include "script.h"
 #include "selection.h"
+#include "verbs.h"
 
 #include "extension/db.h"
 #include "extension/effect.h"
@@ -644,7 +646,11 @@ void Script::effect(Inkscape::Extension::Effect *module,
             mydoc->changeUriAndHrefs(vd->getDocumentURI());
 
             vd->emitReconstructionStart();
-            copy_doc(vd->getReprRoot(), mydoc->getReprRoot());
+            {
+                // mergeFrom() sets every attribute of every node, have them read once at the end
+                DocumentUndo::ScopedBatch batch(vd, SP_VERB_NONE, module->get_name());
+                copy_doc(vd->getReprRoot(), mydoc->getReprRoot());
+            }
             vd->emitReconstructionFinish();
 
             // Getting the named view from the document generated by the extension
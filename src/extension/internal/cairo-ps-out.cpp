@@ -28,6 +28,7 @@
 #include "extension/print.h"
 #include "extension/db.h"
 #include "extension/output.h"
+#include "debug/timing-report.h"
 #include "display/drawing.h"
 
 #include "display/curve.h"
@@ -107,7 +108,12 @@ ps_print_document_to_file(SPDocument *doc, gchar const *filename, unsigned int l
         /* Render document */
         ret = renderer->setupDocument(ctx, doc, pageBoundingBox, bleedmargin_px, base);
         if (ret) {
-            renderer->renderItem(ctx, root);
+            {
+                Inkscape::Debug::PhaseTracker tracker("rendering");
+                renderer->renderItem(ctx, root);
+            }
+            // Cairo writes the file when the surface is finished.
+            Inkscape::Debug::PhaseTracker tracker("encoding");
             ret = ctx->finish();
         }
     }
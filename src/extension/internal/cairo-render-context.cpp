@@ -138,6 +138,12 @@ CairoRenderContext::~CairoRenderContext()
     for (std::map<gpointer, cairo_font_face_t *>::const_iterator iter = font_table.begin(); iter != font_table.end(); ++iter)
         font_data_free(iter->second);
 
+    for (auto &recording : _recordings) {
+        if (recording.second) {
+            cairo_surface_destroy(recording.second);
+        }
+    }
+
     if (_cr) cairo_destroy(_cr);
     if (_surface) cairo_surface_destroy(_surface);
     if (_layout) g_object_unref(_layout);
@@ -772,6 +778,90 @@ void CairoRenderContext::tagEnd(){
 #endif
 }
 
+/**
+ * Whether content that is drawn several times can be recorded once and painted for each
+ * instance. Vector targets then write it only once, as a form XObject in the case of PDF.
+ */
+bool CairoRenderContext::canShareRecordings() const
+{
+    // Text omitted for LaTeX is split across pages, and clip paths are only outlines.
+    return _is_valid && _vector_based_target && !_is_omittext && _render_mode == RENDER_MODE_NORMAL;
+}
+
+/**
+ * \brief Sends rendering to a new recording
+ *
+ * The recording starts out with an identity transform, so only content that does not depend
+ * on where it is placed must be rendered into it.
+ */
+void CairoRenderContext::beginRecording()
+{
+    g_assert( canShareRecordings() );
+
+    cairo_surface_t *recording = cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, nullptr);
+    _recording_stack.push_back(_cr);
+    _cr = cairo_create(recording);
+    cairo_surface_destroy(recording);
+
+    pushState();
+    setTransform(Geom::identity());
+}
+
+/**
+ * \brief Finishes the recording started by beginRecording() and stores it under the key
+ *
+ * The recording is left unbounded, so nothing drawn into it is cut off; backends take its extents
+ * from the ink drawn into it.
+ */
+void CairoRenderContext::endRecording(std::string const &key)
+{
+    g_assert( !_recording_stack.empty() );
+
+    popState();
+
+    cairo_surface_t *recording = cairo_surface_reference(cairo_get_target(_cr));
+    cairo_destroy(_cr);
+    _cr = _recording_stack.back();
+    _recording_stack.pop_back();
+
+    double x, y, width, height;
+    cairo_recording_surface_ink_extents(recording, &x, &y, &width, &height);
+    if (width <= 0 || height <= 0) {
+        // Nothing to paint.
+        cairo_surface_destroy(recording);
+        recording = nullptr;
+    }
+
+    auto &stored = _recordings[key];
+    if (stored) {
+        cairo_surface_destroy(stored);
+    }
+    stored = recording;
+}
+
+/**
+ * \brief Paints the recording stored under the key at the origin of the current user space
+ *
+ * Cairo writes a recording only once however often it is painted. Returns false if there is
+ * no such recording.
+ */
+bool CairoRenderContext::paintRecording(std::string const &key)
+{
+    g_assert( _is_valid );
+
+    auto it = _recordings.find(key);
+    if (it == _recordings.end()) {
+        return false;
+    }
+    if (it->second) {
+        cairo_save(_cr);
+        cairo_set_source_surface(_cr, it->second, 0.0, 0.0);
+        cairo_paint(_cr);
+        cairo_restore(_cr);
+    }
+    return true;
+}
+
 
 void
 CairoRenderContext::addClipPath(Geom::PathVector const &pv, SPIEnum<SPWindRule> const *fill_rule)
@@ -1648,6 +1738,65 @@ CairoRenderContext::renderPathVector(Geom::PathVector const & pathv, SPStyle con
     return true;
 }
 
+/**
+ * \brief Tags the surface of an image with a hash of its data
+ *
+ * Cairo writes images with the same unique id only once, so the same picture placed many
+ * times, or linked from several image elements, ends up once in the output. Placements with a
+ * different image-rendering, which decides the filter, get a different id.
+ */
+void CairoRenderContext::_setImageUniqueId(Inkscape::Pixbuf *pb, cairo_surface_t *surface, cairo_filter_t filter)
+{
+    std::string const suffix = filter == CAIRO_FILTER_NEAREST ? "-nearest" : "";
+    unsigned char const *id = nullptr;
+    unsigned long id_length = 0;
+    cairo_surface_get_mime_data(surface, CAIRO_MIME_TYPE_UNIQUE_ID, &id, &id_length);
+    if (id) {
+        // The hash of the data comes first and stays valid, only the suffix may change.
+        std::string current(reinterpret_cast<char const *>(id), id_length);
+        std::string hash = current.substr(0, current.find('-'));
+        if (hash + suffix != current) {
+            gchar *unique_id = g_strdup((hash + suffix).c_str());
+            cairo_surface_set_mime_data(surface, CAIRO_MIME_TYPE_UNIQUE_ID,
+                                        reinterpret_cast<unsigned char *>(unique_id), strlen(unique_id), g_free,
+                                        unique_id);
+        }
+        return;
+    }
+
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA1);
+    gsize mime_length = 0;
+    std::string mimetype;
+    guchar const *mime_data = pb->getMimeData(mime_length, mimetype);
+    if (mime_data) {
+        // Cairo embeds the original file, so that is what has to be the same.
+        g_checksum_update(checksum, reinterpret_cast<guchar const *>(mimetype.c_str()), mimetype.size() + 1);
+        g_checksum_update(checksum, mime_data, mime_length);
+    } else {
+        cairo_format_t format = cairo_image_surface_get_format(surface);
+        if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24) {
+            g_checksum_free(checksum);
+            return;
+        }
+        cairo_surface_flush(surface);
+        int width = cairo_image_surface_get_width(surface);
+        int height = cairo_image_surface_get_height(surface);
+        int stride = cairo_image_surface_get_stride(surface);
+        guint32 header[] = {guint32(format), guint32(width), guint32(height)};
+        g_checksum_update(checksum, reinterpret_cast<guchar const *>(header), sizeof(header));
+        // Only the pixels, the padding at the end of rows is undefined.
+        guchar const *data = cairo_image_surface_get_data(surface);
+        for (int y = 0; y < height; ++y) {
+            g_checksum_update(checksum, data + y * stride, 4 * width);
+        }
+    }
+
+    gchar *unique_id = g_strconcat(g_checksum_get_string(checksum), suffix.c_str(), nullptr);
+    g_checksum_free(checksum);
+    cairo_surface_set_mime_data(surface, CAIRO_MIME_TYPE_UNIQUE_ID, reinterpret_cast<unsigned char *>(unique_id),
+                                strlen(unique_id), g_free, unique_id);
+}
+
 bool CairoRenderContext::renderImage(Inkscape::Pixbuf *pb,
                                      Geom::Affine const &image_transform, SPStyle const *style)
 {
@@ -1670,22 +1819,9 @@ bool CairoRenderContext::renderImage(Inkscape::Pixbuf *pb,
         return false;
     }
 
-    cairo_save(_cr);
-
-    // scaling by width & height is not needed because it will be done by Cairo
-    transform(image_transform);
-
-    cairo_set_source_surface(_cr, image_surface, 0.0, 0.0);
-
-    // set clip region so that the pattern will not be repeated (bug in Cairo-PDF)
-    if (_vector_based_target) {
-        cairo_new_path(_cr);
-        cairo_rectangle(_cr, 0, 0, w, h);
-        cairo_clip(_cr);
-    }
-
     // Cairo filter method will be mapped to PS/PDF 'interpolate' true/false).
     // See cairo-pdf-surface.c
+    cairo_filter_t filter = CAIRO_FILTER_BEST;
     if (style) {
         // See: http://www.w3.org/TR/SVG/painting.html#ImageRenderingProperty
         //      https://drafts.csswg.org/css-images-3/#the-image-rendering
@@ -1699,16 +1835,37 @@ bool CairoRenderContext::renderImage(Inkscape::Pixbuf *pb,
             case SP_CSS_IMAGE_RENDERING_PIXELATED:
             // we don't have an implementation for crisp-edges, but it should *not* smooth or blur
             case SP_CSS_IMAGE_RENDERING_CRISPEDGES:
-                cairo_pattern_set_filter(cairo_get_source(_cr), CAIRO_FILTER_NEAREST);
+                filter = CAIRO_FILTER_NEAREST;
                 break;
             case SP_CSS_IMAGE_RENDERING_OPTIMIZEQUALITY:
             case SP_CSS_IMAGE_RENDERING_AUTO:
             default:
-                cairo_pattern_set_filter(cairo_get_source(_cr), CAIRO_FILTER_BEST);
                 break;
         }
     }
 
+    if (_vector_based_target) {
+        _setImageUniqueId(pb, image_surface, filter);
+    }
+
+    cairo_save(_cr);
+
+    // scaling by width & height is not needed because it will be done by Cairo
+    transform(image_transform);
+
+    cairo_set_source_surface(_cr, image_surface, 0.0, 0.0);
+
+    // set clip region so that the pattern will not be repeated (bug in Cairo-PDF)
+    if (_vector_based_target) {
+        cairo_new_path(_cr);
+        cairo_rectangle(_cr, 0, 0, w, h);
+        cairo_clip(_cr);
+    }
+
+    if (style) {
+        cairo_pattern_set_filter(cairo_get_source(_cr), filter);
+    }
+
     if (style->mix_blend_mode.set && style->mix_blend_mode.value) {
         cairo_set_operator(_cr, ink_css_blend_to_cairo_operator(style->mix_blend_mode.value));
     }
@@ -15,6 +15,7 @@
  */
 
 #include "extension/extension.h"
+#include <map>
 #include <set>
 #include <string>
 
@@ -143,6 +144,12 @@ public:
     void tagBegin(const char* link);
     void tagEnd();
 
+    /* Recordings, painted once per instance of the same content */
+    bool canShareRecordings() const;
+    void beginRecording();
+    void endRecording(std::string const &key);
+    bool paintRecording(std::string const &key);
+
     /* Graphics state manipulation */
     void pushState();
     void popState();
@@ -231,6 +238,7 @@ protected:
 
     bool _finishSurfaceSetup(cairo_surface_t *surface, cairo_matrix_t *ctm = nullptr);
     void _setSurfaceMetadata(cairo_surface_t *surface);
+    void _setImageUniqueId(Inkscape::Pixbuf *pb, cairo_surface_t *surface, cairo_filter_t filter);
 
     void _setFillStyle(SPStyle const *style, Geom::OptRect const &pbox);
     void _setStrokeStyle(SPStyle const *style, Geom::OptRect const &pbox);
@@ -245,6 +253,9 @@ protected:
     std::map<gpointer, cairo_font_face_t *> font_table;
     static void font_data_free(gpointer data);
 
+    std::map<std::string, cairo_surface_t *> _recordings; // nullptr for empty recordings
+    std::vector<cairo_t *> _recording_stack; // contexts that recordings interrupted
+
     CairoRenderState *_createState();
 };
 
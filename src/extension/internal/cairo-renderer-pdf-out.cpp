@@ -28,6 +28,7 @@
 #include "extension/db.h"
 #include "extension/output.h"
 
+#include "debug/timing-report.h"
 #include "display/drawing.h"
 #include "display/curve.h"
 
@@ -104,7 +105,12 @@ pdf_render_document_to_file(SPDocument *doc, gchar const *filename, unsigned int
         /* Render document */
         ret = renderer->setupDocument(ctx, doc, pageBoundingBox, bleedmargin_px, base);
         if (ret) {
-            renderer->renderItem(ctx, root);
+            {
+                Inkscape::Debug::PhaseTracker tracker("rendering");
+                renderer->renderItem(ctx, root);
+            }
+            // Cairo writes the file when the surface is finished.
+            Inkscape::Debug::PhaseTracker tracker("encoding");
             ret = ctx->finish();
         }
     }
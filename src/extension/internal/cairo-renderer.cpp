@@ -26,8 +26,14 @@
 #endif
 
 
+#include <algorithm>
 #include <csignal>
 #include <cerrno>
+#include <cstdint>
+#include <iomanip>
+#include <list>
+#include <locale>
+#include <sstream>
 
 
 #include <2geom/transforms.h>
@@ -68,6 +74,7 @@
 #include "object/sp-clippath.h"
 #include "object/sp-defs.h"
 #include "object/sp-flowtext.h"
+#include "object/sp-hatch.h"
 #include "object/sp-hatch-path.h"
 #include "object/sp-image.h"
 #include "object/sp-item-group.h"
@@ -365,6 +372,130 @@ static void sp_group_render(SPGroup *group, CairoRenderContext *ctx)
     }
 }
 
+/**
+ * Whether an item and its descendants look the same wherever they are rendered. Masks,
+ * filters and some paint servers are rasterized at the resolution of the current transform
+ * and blending depends on what is below, so those have to be rendered for each placement.
+ */
+static bool sp_item_is_placement_independent(SPItem const *item)
+{
+    if (item->getMaskObject() || dynamic_cast<SPAnchor const *>(item)) {
+        return false;
+    }
+    SPClipPath const *clip_path = item->getClipObject();
+    if (clip_path && clip_path->clipPathUnits == SP_CONTENT_UNITS_OBJECTBOUNDINGBOX) {
+        return false;
+    }
+    if (SPStyle const *style = item->style) {
+        if (style->filter.set || (style->mix_blend_mode.set && style->mix_blend_mode.value != SP_CSS_BLEND_NORMAL)) {
+            return false;
+        }
+        for (SPPaintServer const *server : {style->getFillPaintServer(), style->getStrokePaintServer()}) {
+            if (dynamic_cast<SPPattern const *>(server) || dynamic_cast<SPHatch const *>(server)) {
+                return false;
+            }
+        }
+    }
+
+    if (auto use = dynamic_cast<SPUse const *>(item)) {
+        return !use->child || sp_item_is_placement_independent(use->child);
+    }
+    if (auto shape = dynamic_cast<SPShape const *>(item)) {
+        for (auto marker : shape->_marker) {
+            if (marker && !sp_item_is_placement_independent(marker)) {
+                return false;
+            }
+        }
+    }
+    for (auto &child : item->children) {
+        auto child_item = dynamic_cast<SPItem const *>(&child);
+        if (child_item && !sp_item_is_placement_independent(child_item)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void sp_style_key_paint(std::ostringstream &key, SPIPaint const &paint)
+{
+    key << ' ' << paint.paintOrigin;
+    if (paint.isPaintserver()) {
+        key << 's' << paint.value.href->getObject();
+    } else if (paint.isColor()) {
+        key << 'c' << paint.value.color.toRGBA32(0);
+    }
+}
+
+/**
+ * The computed values of all inherited properties, which is what the child of a clone takes
+ * from the clone.
+ */
+static std::string sp_style_render_key(SPStyle const *style)
+{
+    std::ostringstream key;
+    key.imbue(std::locale::classic());
+    key << std::setprecision(9);
+
+    auto const properties = style->properties();
+    for (size_t i = 0; i < properties.size(); ++i) {
+        if (!properties[i]->inherits) {
+            continue;
+        }
+        // A property set to 'inherit' holds its parent's value, but writes only the keyword.
+        SPIBase const *property = properties[i];
+        SPObject const *object = style->object;
+        while (property->inherit && object && object->parent && object->parent->style) {
+            object = object->parent;
+            property = object->style->properties()[i];
+        }
+        key << ' ' << property->get_value();
+    }
+
+    // Paint servers, relative font weights and stretches, and lengths relative to the font size
+    // are not told apart by their values.
+    sp_style_key_paint(key, style->fill);
+    sp_style_key_paint(key, style->stroke);
+    key << ' ' << style->font_weight.computed << ' ' << style->font_stretch.computed
+        << ' ' << style->font_size.computed << ' ' << style->stroke_width.computed
+        << ' ' << style->stroke_dashoffset.computed << ' ' << style->line_height.computed
+        << ' ' << style->letter_spacing.computed << ' ' << style->word_spacing.computed;
+    for (auto const &dash : style->stroke_dasharray.values) {
+        key << ',' << dash.computed;
+    }
+    return key.str();
+}
+
+/**
+ * Renders the child of a clone from a recording shared by all clones of the same original
+ * with the same style, so that PDF output holds the original only once. Returns false if the
+ * child has to be rendered the usual way.
+ */
+static bool sp_use_render_shared(SPUse *use, CairoRenderContext *ctx)
+{
+    SPItem *original = use->get_original();
+    if (!original || original->hrefcount < 2 || !ctx->canShareRecordings()) {
+        return false;
+    }
+
+    // The child inherits the style of the clone, and a symbol is scaled to its size.
+    std::string key = std::to_string(reinterpret_cast<uintptr_t>(use->child->getRepr()));
+    key += ' ' + std::to_string(use->width.computed) + ' ' + std::to_string(use->height.computed);
+    key += sp_style_render_key(use->style);
+
+    if (ctx->paintRecording(key)) {
+        return true;
+    }
+    if (!sp_item_is_placement_independent(use->child)) {
+        return false;
+    }
+
+    ctx->beginRecording();
+    ctx->getRenderer()->renderItem(ctx, use->child);
+    ctx->endRecording(key);
+    ctx->paintRecording(key);
+    return true;
+}
+
 static void sp_use_render(SPUse *use, CairoRenderContext *ctx)
 {
     bool translated = false;
@@ -377,7 +508,7 @@ static void sp_use_render(SPUse *use, CairoRenderContext *ctx)
         translated = true;
     }
 
-    if (use->child) {
+    if (use->child && !sp_use_render_shared(use, ctx)) {
         renderer->renderItem(ctx, use->child);
     }
 
@@ -501,82 +632,197 @@ static void sp_root_render(SPRoot *root, CairoRenderContext *ctx)
 }
 
 /**
-    This function converts the item to a raster image and includes the image into the cairo renderer.
-    It is only used for filters and then only when rendering filters as bitmaps is requested.
-*/
-static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
+ * The pixels covered by the bitmap of an item, in the document scaled to the resolution res.
+ * Bitmaps are aligned to the pixels of the whole document, so that neighbouring ones line up.
+ */
+static Geom::OptIntRect sp_asbitmap_area(SPItem *item, double res)
 {
-
-    // The code was adapted from sp_selection_create_bitmap_copy in selection-chemistry.cpp
-
-    // Calculate resolution
-    double res;
-    /** @TODO reimplement the resolution stuff   (WHY?)
-    */
-    res = ctx->getBitmapResolution();
-    if(res == 0) {
-        res = Inkscape::Util::Quantity::convert(1, "in", "px");
-    }
-    TRACE(("sp_asbitmap_render: resolution: %f\n", res ));
-
     // Get the bounding box of the selection in desktop coordinates.
     Geom::OptRect bbox = item->documentVisualBounds();
 
-    // no bbox, e.g. empty group
-    if (!bbox) {
-        return;
-    }
-
     Geom::Rect docrect(Geom::Rect(Geom::Point(0, 0), item->document->getDimensions()));
     bbox &= docrect;
 
     // no bbox, e.g. empty group
     if (!bbox) {
-        return;
+        return Geom::OptIntRect();
     }
 
-    // The width and height of the bitmap in pixels
-    unsigned width =  ceil(bbox->width() * Inkscape::Util::Quantity::convert(res, "px", "in"));
-    unsigned height = ceil(bbox->height() * Inkscape::Util::Quantity::convert(res, "px", "in"));
+    Geom::Scale scale(Inkscape::Util::Quantity::convert(res, "px", "in"));
+    Geom::IntRect area = (*bbox * scale).roundOutwards();
+    if (area.hasZeroArea()) {
+        return Geom::OptIntRect();
+    }
+    return area;
+}
 
-    if (width == 0 || height == 0) return;
+/**
+ * Collects the items below o that are rendered as bitmaps, each with its path in the object
+ * tree, for rasterizing them all at once.
+ */
+static void sp_asbitmap_collect(SPObject *o, std::string const &path, double res,
+                                std::vector<SPItemBitmapJob> &jobs, std::vector<std::string> &paths)
+{
+    int index = 0;
+    for (auto &child : o->children) {
+        std::string child_path = path + '/' + std::to_string(index++);
+        SPItem *item = dynamic_cast<SPItem *>(&child);
+        if (!item || item->isHidden()) {
+            continue;
+        }
+        SPSymbol *symbol = dynamic_cast<SPSymbol *>(item);
+        if (symbol && !symbol->cloned) {
+            continue;
+        }
+        if (!item->style || !item->style->filter.set) {
+            sp_asbitmap_collect(item, child_path, res, jobs, paths);
+            continue;
+        }
+        SPFilter *filt = item->style->getFilter();
+        if (filt && g_strcmp0(filt->getId(), "selectable_hidder_filter") == 0) {
+            continue;
+        }
+        if (Geom::OptIntRect area = sp_asbitmap_area(item, res)) {
+            jobs.push_back({item, *area, nullptr});
+            paths.push_back(child_path);
+        }
+    }
+}
+
+/**
+ * Identifies the bitmaps of the filtered items of a document at a resolution, for as long as
+ * the document is not modified.
+ */
+static std::string sp_asbitmap_key(SPDocument *doc, double res)
+{
+    return std::to_string(doc->serial()) + ' ' + std::to_string(doc->modificationCount()) + ' ' +
+           std::to_string(res);
+}
+
+namespace {
+
+/// Bitmaps of filtered items by their path in the object tree.
+struct FilterBitmaps {
+    std::string key;
+    std::map<std::string, std::shared_ptr<Inkscape::Pixbuf>> bitmaps;
+    size_t size = 0;
+};
 
-    // Scale to exactly fit integer bitmap inside bounding box
-    double scale_x = bbox->width() / width;
-    double scale_y = bbox->height() / height;
+/// Most recently made first, kept for exporting the same document again, e.g. to another format.
+std::list<FilterBitmaps> filter_bitmap_cache;
+size_t const FILTER_BITMAP_CACHE_SIZE = 64 << 20;
 
-    // Location of bounding box in document coordinates.
-    double shift_x = bbox->min()[Geom::X];
-    double shift_y = bbox->top();
+} // namespace
 
-    // For default 96 dpi, snap bitmap to pixel grid
-    if (res == Inkscape::Util::Quantity::convert(1, "in", "px")) {
-        shift_x = round (shift_x);
-        shift_y = round (shift_y);
+void CairoRenderer::rasterizeFilters(SPDocument *doc, double res)
+{
+    _filter_bitmaps.clear();
+    _filter_bitmaps_res = res;
+
+    std::vector<SPItemBitmapJob> jobs;
+    std::vector<std::string> paths;
+    sp_asbitmap_collect(doc->getRoot(), "", res, jobs, paths);
+    if (jobs.empty()) {
+        return;
     }
 
-    // Calculate the matrix that will be applied to the image so that it exactly overlaps the source objects
+    std::string key = sp_asbitmap_key(doc, res);
+    auto cached = std::find_if(filter_bitmap_cache.begin(), filter_bitmap_cache.end(),
+                               [&key](FilterBitmaps const &entry) { return entry.key == key; });
+    if (cached != filter_bitmap_cache.end()) {
+        filter_bitmap_cache.splice(filter_bitmap_cache.begin(), filter_bitmap_cache, cached);
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            auto it = cached->bitmaps.find(paths[i]);
+            if (it != cached->bitmaps.end()) {
+                _filter_bitmaps[jobs[i].item] = it->second;
+            }
+        }
+        return;
+    }
 
-    // Matrix to put bitmap in correct place on document
-    Geom::Affine t_on_document = (Geom::Affine)(Geom::Scale (scale_x, scale_y)) *
-                                 (Geom::Affine)(Geom::Translate (shift_x, shift_y));
+    sp_generate_internal_bitmaps(doc, res, jobs);
 
-    // ctx matrix already includes item transformation. We must substract.
-    Geom::Affine t_item =  item->i2doc_affine();
-    Geom::Affine t = t_on_document * t_item.inverse();
+    FilterBitmaps entry;
+    entry.key = key;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        std::shared_ptr<Inkscape::Pixbuf> pb(jobs[i].pixbuf.release());
+        if (pb) {
+            _filter_bitmaps[jobs[i].item] = pb;
+            entry.bitmaps[paths[i]] = pb;
+            entry.size += 4 * static_cast<size_t>(pb->width()) * pb->height();
+        }
+    }
+    if (entry.size > FILTER_BITMAP_CACHE_SIZE) {
+        // It would push out everything else and still not fit.
+        return;
+    }
+    filter_bitmap_cache.push_front(std::move(entry));
+
+    size_t total = 0;
+    for (auto const &cached_entry : filter_bitmap_cache) {
+        total += cached_entry.size;
+    }
+    while (total > FILTER_BITMAP_CACHE_SIZE) {
+        total -= filter_bitmap_cache.back().size;
+        filter_bitmap_cache.pop_back();
+    }
+}
+
+Inkscape::Pixbuf *CairoRenderer::getFilterBitmap(SPItem *item, double res)
+{
+    if (!_filters_rasterized || _filter_bitmaps_res != res) {
+        _filters_rasterized = true;
+        rasterizeFilters(item->document, res);
+    }
+
+    auto it = _filter_bitmaps.find(item);
+    if (it == _filter_bitmaps.end()) {
+        // Not reached by sp_asbitmap_collect(), e.g. in a marker or mask.
+        Geom::OptIntRect area = sp_asbitmap_area(item, res);
+        if (!area) {
+            return nullptr;
+        }
+        std::vector<SPItemBitmapJob> jobs;
+        jobs.push_back({item, *area, nullptr});
+        sp_generate_internal_bitmaps(item->document, res, jobs);
+        it = _filter_bitmaps.emplace(item, std::shared_ptr<Inkscape::Pixbuf>(jobs[0].pixbuf.release())).first;
+    }
+    return it->second.get();
+}
 
-    // Do the export
-    SPDocument *document = item->document;
+/**
+    This function converts the item to a raster image and includes the image into the cairo renderer.
+    It is only used for filters and then only when rendering filters as bitmaps is requested.
+    The bitmaps of all filtered items of a document are made together, see CairoRenderer::getFilterBitmap().
+*/
+static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
+{
+    // Calculate resolution
+    double res;
+    /** @TODO reimplement the resolution stuff   (WHY?)
+    */
+    res = ctx->getBitmapResolution();
+    if(res == 0) {
+        res = Inkscape::Util::Quantity::convert(1, "in", "px");
+    }
+    TRACE(("sp_asbitmap_render: resolution: %f\n", res ));
 
-    std::unique_ptr<Inkscape::Pixbuf> pb(
-        sp_generate_internal_bitmap(document, nullptr,
-            bbox->min()[Geom::X], bbox->min()[Geom::Y], bbox->max()[Geom::X], bbox->max()[Geom::Y],
-            width, height, res, res, (guint32) 0xffffff00, item ));
+    Geom::OptIntRect area = sp_asbitmap_area(item, res);
+    if (!area) {
+        return;
+    }
 
+    Inkscape::Pixbuf *pb = ctx->getRenderer()->getFilterBitmap(item, res);
     if (pb) {
-        //TEST(gdk_pixbuf_save( pb, "bitmap.png", "png", NULL, NULL ));
+        // Matrix to put bitmap in correct place on document
+        Geom::Affine t_on_document = Geom::Translate(area->min()) *
+                                     Geom::Scale(Inkscape::Util::Quantity::convert(1, "in", "px") / res);
+
+        // ctx matrix already includes item transformation. We must substract.
+        Geom::Affine t_item =  item->i2doc_affine();
+        Geom::Affine t = t_on_document * t_item.inverse();
 
-        ctx->renderImage(pb.get(), t, item->style);
+        ctx->renderImage(pb, t, item->style);
     }
 }
 
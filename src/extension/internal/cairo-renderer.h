@@ -16,6 +16,8 @@
  */
 
 #include "extension/extension.h"
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
 
@@ -28,6 +30,8 @@ class SPMask;
 class SPHatchPath;
 
 namespace Inkscape {
+class Pixbuf;
+
 namespace Extension {
 namespace Internal {
 
@@ -56,9 +60,21 @@ public:
     void renderItem(CairoRenderContext *ctx, SPItem *item);
     void renderHatchPath(CairoRenderContext *ctx, SPHatchPath const &hatchPath, unsigned key);
 
+    /** Returns the bitmap of a filtered item at the given resolution, for rendering filters
+    as bitmaps. The first call rasterizes all filtered items of the document at once. */
+    Inkscape::Pixbuf *getFilterBitmap(SPItem *item, double res);
+
 private:
     /** Extract metadata from doc and set it on ctx. */
     void setMetadata(CairoRenderContext *ctx, SPDocument *doc);
+
+    /** Rasterizes all filtered items of doc, or takes them from an earlier export of the same
+    document. */
+    void rasterizeFilters(SPDocument *doc, double res);
+
+    std::map<SPItem *, std::shared_ptr<Inkscape::Pixbuf>> _filter_bitmaps;
+    double _filter_bitmaps_res = 0;
+    bool _filters_rasterized = false;
 };
 
 // FIXME: this should be a static method of CairoRenderer
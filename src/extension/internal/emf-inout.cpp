@@ -46,6 +46,7 @@
 #include "svg/css-ostringstream.h"
 #include "svg/svg.h"
 #include "util/units.h"
+#include "xml/repr.h"
 
 #include "emf-print.h"
 
@@ -1643,12 +1644,10 @@ int Emf::myEnhMetaFileProc(char *contents, unsigned int length, PEMF_CALLBACK_DA
     // code for end user debugging
     int  eDbgRecord=0;
     int  eDbgComment=0;
-    int  eDbgFinal=0;
     char const* eDbgString = getenv( "INKSCAPE_DBG_EMF" );
     if ( eDbgString != nullptr ) {
         if(strstr(eDbgString,"RECORD")){  eDbgRecord  = 1; }
         if(strstr(eDbgString,"COMMENT")){ eDbgComment = 1; }
-        if(strstr(eDbgString,"FINAL")){   eDbgFinal   = 1; }
     }
 
     /* initialize the tsp for text reassembly */
@@ -1810,12 +1809,12 @@ std::cout << "BEFORE DRAW"
         {
             dbg_str << "<!-- U_EMR_HEADER -->\n";
 
-            d->outdef += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+            d->outsvg += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
 
             if (d->pDesc) {
-                d->outdef += "<!-- ";
-                d->outdef += d->pDesc;
-                d->outdef += " -->\n";
+                d->outsvg += "<!-- ";
+                d->outsvg += d->pDesc;
+                d->outsvg += " -->\n";
             }
 
             PU_EMRHEADER pEmr = (PU_EMRHEADER) lpEMFR;
@@ -1876,8 +1875,8 @@ std::cout << "BEFORE DRAW"
             tmp_outdef <<
                 "  width=\"" << d->MMX << "mm\"\n" <<
                 "  height=\"" << d->MMY << "mm\">\n";
-            d->outdef += tmp_outdef.str().c_str();
-            d->outdef += "<defs>";                           // temporary end of header
+            d->outsvg += tmp_outdef.str().c_str();
+            d->outsvg += "<defs>";                           // temporary end of header
 
             // d->defs holds any defines which are read in.
 
@@ -2146,7 +2145,6 @@ std::cout << "BEFORE DRAW"
             dbg_str << "<!-- U_EMR_EOF -->\n";
 
             tmp_outsvg << "</svg>\n";
-            d->outsvg = d->outdef + d->defs + d->outsvg;
             OK=0;
             break;
         }
@@ -3523,12 +3521,12 @@ std::cout << "BEFORE DRAW"
     d->outsvg += tmp_outsvg.str().c_str();
     d->path += tmp_path.str().c_str();
 
+    // The path is kept until it is drawn, everything else is read into the document right away.
+    d->builder.addBody(d->outsvg);
+    d->builder.addDefs(d->outdef);
+    d->builder.addDefs(d->defs);
+
     }  //end of while
-//  At run time define environment variable INKSCAPE_DBG_EMF to include string FINAL
-//  Users may employ this to to show the final SVG derived from the EMF
-    if(eDbgFinal){
-       std::cout << d->outsvg << std::endl;
-    }
     (void) emr_properties(U_EMR_INVALID);  // force the release of the lookup table memory, returned value is irrelevant
 
     return(file_status);
@@ -3584,16 +3582,29 @@ Emf::open( Inkscape::Extension::Input * /*mod*/, const gchar *uri )
       FT_LOAD_NO_SCALE | FT_LOAD_NO_HINTING  | FT_LOAD_NO_BITMAP,
       FT_KERNING_UNSCALED);
 
+    gint64 start = g_get_monotonic_time();
     int good = myEnhMetaFileProc(contents,length, &d);
     free(contents);
 
     if (d.pDesc){ free( d.pDesc ); }
 
-//    std::cout << "SVG Output: " << std::endl << d.outsvg << std::endl;
-
     SPDocument *doc = nullptr;
     if (good) {
-        doc = SPDocument::createNewDocFromMem(d.outsvg.c_str(), strlen(d.outsvg.c_str()), TRUE);
+        doc = d.builder.finish();
+    }
+
+//  At run time define environment variable INKSCAPE_DBG_EMF to include string FINAL
+//  Users may employ this to to show the final SVG derived from the EMF,
+//  and string TIME to show how long the import took.
+    char const* eDbgString = getenv( "INKSCAPE_DBG_EMF" );
+    if (doc && eDbgString != nullptr) {
+        if(strstr(eDbgString,"FINAL")){
+           std::cout << sp_repr_save_buf(doc->getReprDoc()) << std::endl;
+        }
+        if(strstr(eDbgString,"TIME")){
+           std::cout << "EMF import: " << length << " bytes read, " << d.builder.svgLength()
+                     << " bytes of SVG, " << (g_get_monotonic_time() - start) / 1000 << " ms" << std::endl;
+        }
     }
 
     free_emf_strings(d.hatches);
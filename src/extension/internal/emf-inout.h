@@ -107,6 +107,7 @@ using PEMF_DEVICE_CONTEXT = EMF_DEVICE_CONTEXT *;
 struct EMF_CALLBACK_DATA {
 
     EMF_CALLBACK_DATA() :
+        builder("emf"),
         // dc: array, structure w/ constructor
         level(0),
         E2IdirY(1.0),
@@ -128,10 +129,12 @@ struct EMF_CALLBACK_DATA {
         // emf_obj;
     {};
 
+    // The SVG of the current record, handed to builder once the record is done
     Glib::ustring outsvg;
     Glib::ustring path;
     Glib::ustring outdef;
     Glib::ustring defs;
+    MetafileDocumentBuilder builder;
 
     EMF_DEVICE_CONTEXT dc[EMF_MAX_DC+1]; // FIXME: This should be dynamic..
     int level;
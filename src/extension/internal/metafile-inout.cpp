@@ -28,6 +28,9 @@
 #include "object/sp-root.h"
 #include "object/sp-namedview.h"
 #include "svg/stringstream.h"
+#include "xml/document.h"
+#include "xml/node.h"
+#include "xml/repr.h"
 
 namespace Inkscape {
 namespace Extension {
@@ -38,6 +41,103 @@ Metafile::~Metafile()
     return;
 }
 
+namespace {
+
+/// Counts the elements below node by their style attribute.
+void count_styles(Inkscape::XML::Node *node, std::map<std::string, unsigned> &counts)
+{
+    for (auto child = node->firstChild(); child; child = child->next()) {
+        if (child->type() == Inkscape::XML::NodeType::ELEMENT_NODE) {
+            if (char const *style = child->attribute("style")) {
+                counts[style]++;
+            }
+            count_styles(child, counts);
+        }
+    }
+}
+
+/// Moves the styles that several elements below node have into classes.
+void share_styles(Inkscape::XML::Node *node, std::map<std::string, unsigned> const &counts,
+                  StyleClasses &classes)
+{
+    for (auto child = node->firstChild(); child; child = child->next()) {
+        if (child->type() == Inkscape::XML::NodeType::ELEMENT_NODE) {
+            char const *style = child->attribute("style");
+            if (style && counts.at(style) > 1) {
+                std::string name = classes.get(style);
+                if (char const *existing = child->attribute("class")) {
+                    name = std::string(existing) + " " + name;
+                }
+                child->setAttribute("class", name);
+                child->removeAttribute("style");
+            }
+            share_styles(child, counts, classes);
+        }
+    }
+}
+
+} // namespace
+
+MetafileDocumentBuilder::MetafileDocumentBuilder(char const *class_prefix)
+    : _body(SP_SVG_NS_URI)
+    , _defs(SP_SVG_NS_URI)
+    , _classes(class_prefix)
+{
+    // The same namespaces as the header of the drawing.
+    _defs.write(std::string("<defs xmlns=\"http://www.w3.org/2000/svg\""
+                            " xmlns:xlink=\"http://www.w3.org/1999/xlink\""
+                            " xmlns:sodipodi=\"http://sodipodi.sourceforge.net/DTD/sodipodi-0.dtd\">"));
+}
+
+void MetafileDocumentBuilder::addBody(Glib::ustring &svg)
+{
+    _svg_length += svg.bytes();
+    _body.write(svg.raw());
+    svg.clear();
+}
+
+void MetafileDocumentBuilder::addDefs(Glib::ustring &svg)
+{
+    _svg_length += svg.bytes();
+    _defs.write(svg.raw());
+    svg.clear();
+}
+
+SPDocument *MetafileDocumentBuilder::finish()
+{
+    _defs.write(std::string("</defs>"));
+    Inkscape::XML::Document *rdoc = _body.finish();
+    Inkscape::XML::Document *defs_doc = _defs.finish();
+    if (rdoc) {
+        Inkscape::XML::Node *defs = sp_repr_lookup_name(rdoc->root(), "svg:defs", 1);
+        if (!defs) {
+            defs = rdoc->createElement("svg:defs");
+            rdoc->root()->addChild(defs, nullptr);
+            Inkscape::GC::release(defs);
+        }
+        if (defs_doc) {
+            for (auto child = defs_doc->root()->firstChild(); child; child = child->next()) {
+                Inkscape::XML::Node *copy = child->duplicate(rdoc);
+                defs->appendChild(copy);
+                Inkscape::GC::release(copy);
+            }
+        }
+
+        // Like the compact mode of the PDF import, only on request: it makes the file smaller,
+        // but a document with classes is not known to load faster.
+        if (Inkscape::Preferences::get()->getBool("/options/metafileimport/styleclasses")) {
+            std::map<std::string, unsigned> counts;
+            count_styles(rdoc->root(), counts);
+            share_styles(rdoc->root(), counts, _classes);
+            StyleClasses::addRules(defs, _classes.rules().c_str());
+        }
+    }
+    if (defs_doc) {
+        Inkscape::GC::release(defs_doc);
+    }
+    return rdoc ? SPDocument::createNewDocFromRepr(rdoc, true) : nullptr;
+}
+
 /** Construct a PNG in memory from an RGB from the EMF file
 
 from:
@@ -25,6 +25,8 @@
 #include <2geom/pathvector.h>
 
 #include "extension/implementation/implementation.h"
+#include "extension/internal/style-classes.h"
+#include "xml/push-reader.h"
 
 class SPObject;
 
@@ -56,6 +58,42 @@ struct MEMPNG {
 };
 using PMEMPNG = MEMPNG *;
 
+/**
+ * Builds the document from the SVG text that the records of a metafile are converted to, while
+ * the records are read, so that the text of the whole drawing is never held.
+ *
+ * Definitions come up along the way but belong in <defs>, so they are read separately and
+ * moved there when the document is finished. With "/options/metafileimport/styleclasses" set,
+ * styles that several elements have are then moved into classes, as the compact mode of the PDF
+ * import does.
+ */
+class MetafileDocumentBuilder
+{
+public:
+    /// The names of the style classes start with class_prefix.
+    explicit MetafileDocumentBuilder(char const *class_prefix);
+
+    /// Reads and clears the SVG of the drawing converted so far.
+    void addBody(Glib::ustring &svg);
+    /// Reads and clears the SVG of the definitions found so far.
+    void addDefs(Glib::ustring &svg);
+
+    /**
+     * Reads the rest of the SVG and creates the document.
+     * @return The document, or nullptr if the SVG has no root element.
+     */
+    SPDocument *finish();
+
+    /// The length of the SVG read so far.
+    size_t svgLength() const { return _svg_length; }
+
+private:
+    Inkscape::XML::PushReader _body;
+    Inkscape::XML::PushReader _defs;
+    StyleClasses _classes;
+    size_t _svg_length = 0;
+};
+
 class Metafile
     : public Inkscape::Extension::Implementation::Implementation
 {
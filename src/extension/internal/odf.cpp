@@ -35,6 +35,7 @@
 //# Inkscape includes
 #include "clear-n_.h"
 #include "inkscape.h"
+#include "preferences.h"
 #include "display/curve.h"
 #include <2geom/pathvector.h>
 #include <2geom/curves.h>
@@ -2046,6 +2047,9 @@ void OdfOutput::save(Inkscape::Extension::Output */*mod*/, SPDocument *doc, gcha
     docBaseUri = Inkscape::URI::from_dirname(doc->getDocumentBase()).str();
 
     ZipFile zf;
+    // the same level as compressed SVG is saved with
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    zf.setCompressionLevel(prefs->getIntLimited("/options/svgoutput/compression_level", 6, 0, 9));
     preprocess(zf, doc->getReprRoot());
 
     if (!writeManifest(zf))
@@ -43,15 +43,29 @@
 #include <gtkmm/frame.h>
 #include <gtkmm/radiobutton.h>
 #include <gtkmm/scale.h>
+#include <algorithm>
+#include <sstream>
 #include <utility>
+#include <vector>
 
+#include <glib/gstdio.h>
+#include <glibmm/main.h>
+
+#include "debug/logger.h"
+#include "debug/simple-event.h"
 #include "document-undo.h"
 #include "extension/input.h"
+#include "extension/internal/style-classes.h"
 #include "extension/system.h"
+#include "id-clash.h"
 #include "inkscape.h"
+#include "io/sys.h"
+#include "preferences.h"
+#include "object/sp-defs.h"
 #include "object/sp-root.h"
 #include "pdf-parser.h"
 #include "svg-builder.h"
+#include "svg/svg.h"
 #include "ui/dialog-events.h"
 #include "ui/widget/frame.h"
 #include "ui/widget/spinbutton.h"
@@ -71,6 +85,75 @@ void sanitize_page_number(int &page_num, const int num_pages) {
     }
 }
 
+/**
+ * Returns the number of elements in the subtree of node.
+ */
+unsigned count_elements(Inkscape::XML::Node const *node) {
+    unsigned count = node->type() == Inkscape::XML::NodeType::ELEMENT_NODE ? 1 : 0;
+    for (auto child = node->firstChild(); child; child = child->next()) {
+        count += count_elements(child);
+    }
+    return count;
+}
+
+using Inkscape::Debug::Event;
+using Inkscape::Debug::SimpleEvent;
+
+/// What the compact mode made of a page, reported through the debug logger.
+class CompactPageEvent : public SimpleEvent<Event::EXTENSION> {
+public:
+    CompactPageEvent(int page_num, Inkscape::XML::Node const *layer, unsigned merged_paths,
+                     unsigned elided_clips)
+    : SimpleEvent<Event::EXTENSION>("pdf-compact-page")
+    {
+        _addProperty("page", page_num);
+        _addProperty("elements", layer ? count_elements(layer) : 0);
+        _addProperty("merged-paths", merged_paths);
+        _addProperty("elided-clips", elided_clips);
+    }
+};
+
+/**
+ * Returns the page number in text, or 0 if it is not one.
+ */
+int parse_page_number(std::string const &text) {
+    gchar *end = nullptr;
+    gint64 page_num = g_ascii_strtoll(text.c_str(), &end, 10);
+    if (text.empty() || *end || page_num < 1 || page_num > G_MAXINT) {
+        return 0;
+    }
+    return page_num;
+}
+
+/**
+ * Returns the pages listed in a range like "1-3,7,10-" or "all", leaving out those that are
+ * not in the document.
+ */
+std::vector<int> parse_page_range(std::string const &range, const int num_pages) {
+    std::vector<int> pages;
+    std::istringstream parts(range == "all" ? "1-" : range);
+    std::string part;
+    while (std::getline(parts, part, ',')) {
+        auto dash = part.find('-');
+        std::string from = part.substr(0, dash);
+        std::string to = dash == std::string::npos ? from : part.substr(dash + 1);
+        // A range without an end, as in "10-", goes on to the last page.
+        int first = from.empty() ? 1 : parse_page_number(from);
+        int last = to.empty() ? num_pages : parse_page_number(to);
+        if (!first || !last) {
+            std::cerr << "Inkscape::Extension::Internal::PdfInput::open: Bad page range "
+                      << part
+                      << "."
+                      << std::endl;
+            continue;
+        }
+        for (int page_num = first; page_num <= std::min(last, num_pages); ++page_num) {
+            pages.push_back(page_num);
+        }
+    }
+    return pages;
+}
+
 }
 
 namespace Inkscape {
@@ -163,6 +246,7 @@ PdfImportDialog::PdfImportDialog(std::shared_ptr<PDFDoc> doc, const gchar */*uri
     _localFontsCheck = Gtk::manage(new class Gtk::CheckButton(_("Replace PDF fonts by closest-named installed fonts")));
 
     _embedImagesCheck = Gtk::manage(new class Gtk::CheckButton(_("Embed images")));
+    _compactPathsCheck = Gtk::manage(new class Gtk::CheckButton(_("Merge lines of the same style (for large technical drawings)")));
     vbox3 = Gtk::manage(new class Gtk::Box(Gtk::ORIENTATION_VERTICAL, 4));
     _importSettingsFrame = Gtk::manage(new class Inkscape::UI::Widget::Frame(_("Import settings")));
     vbox1 = Gtk::manage(new class Gtk::Box(Gtk::ORIENTATION_VERTICAL, 4));
@@ -277,6 +361,10 @@ PdfImportDialog::PdfImportDialog(std::shared_ptr<PDFDoc> doc, const gchar */*uri
     _embedImagesCheck->set_relief(Gtk::RELIEF_NORMAL);
     _embedImagesCheck->set_mode(true);
     _embedImagesCheck->set_active(true);
+    _compactPathsCheck->set_can_focus();
+    _compactPathsCheck->set_relief(Gtk::RELIEF_NORMAL);
+    _compactPathsCheck->set_mode(true);
+    _compactPathsCheck->set_active(Inkscape::Preferences::get()->getBool("/options/pdfimport/compactpaths"));
 #ifdef HAVE_POPPLER_CAIRO
     vbox3->pack_start(*_importViaPoppler,  Gtk::PACK_SHRINK, 0);
     vbox3->pack_start(*_labelViaPoppler,  Gtk::PACK_SHRINK, 0);
@@ -285,6 +373,7 @@ PdfImportDialog::PdfImportDialog(std::shared_ptr<PDFDoc> doc, const gchar */*uri
 #endif    
     vbox3->pack_start(*_localFontsCheck, Gtk::PACK_SHRINK, 0);
     vbox3->pack_start(*_embedImagesCheck, Gtk::PACK_SHRINK, 0);
+    vbox3->pack_start(*_compactPathsCheck, Gtk::PACK_SHRINK, 0);
     vbox3->pack_start(*_labelPrecision, Gtk::PACK_SHRINK, 0);
     vbox3->pack_start(*hbox6, Gtk::PACK_SHRINK, 0);
     vbox3->pack_start(*_labelPrecisionWarning, Gtk::PACK_SHRINK, 0);
@@ -422,6 +511,11 @@ void PdfImportDialog::getImportSettings(Inkscape::XML::Node *prefs) {
     } else {
         prefs->setAttribute("embedImages", "0");
     }
+    if (_compactPathsCheck->get_active()) {
+        prefs->setAttribute("compactPaths", "1");
+    } else {
+        prefs->setAttribute("compactPaths", "0");
+    }
 #ifdef HAVE_POPPLER_CAIRO
     if (_importViaPoppler->get_active()) {
         prefs->setAttribute("importviapoppler", "1");
@@ -469,11 +563,13 @@ void PdfImportDialog::_onToggleImport() {
         hbox3->set_sensitive(false);
         _localFontsCheck->set_sensitive(false);
         _embedImagesCheck->set_sensitive(false);
+        _compactPathsCheck->set_sensitive(false);
         hbox6->set_sensitive(false);
     } else {
         hbox3->set_sensitive();
         _localFontsCheck->set_sensitive();
         _embedImagesCheck->set_sensitive();
+        _compactPathsCheck->set_sensitive();
         hbox6->set_sensitive();
     }
 }
@@ -651,7 +747,279 @@ static cairo_status_t
 #endif
 
 /**
- * Parses the selected page of the given PDF document using PdfParser.
+ * Parses one page of the PDF document into a new layer of doc using PdfParser.
+ * @return The layer, or nullptr if there is no such page.
+ */
+static Inkscape::XML::Node *import_native_page(PDFDoc *pdf_doc, SPDocument *doc, gchar *docname,
+                                                int page_num, PdfImportDialog *dlg)
+{
+    Page *page = pdf_doc->getCatalog()->getPage(page_num);
+    if (!page) {
+        return nullptr;
+    }
+    Inkscape::XML::Node *root = doc->getReprRoot();
+    Inkscape::XML::Node *last = root->lastChild();
+
+    // Create builder
+    SvgBuilder *builder = new SvgBuilder(doc, docname, pdf_doc->getXRef());
+
+    // Get preferences
+    Inkscape::XML::Node *prefs = builder->getPreferences();
+    bool compact = Inkscape::Preferences::get()->getBool("/options/pdfimport/compactpaths");
+    prefs->setAttribute("compactPaths", compact ? "1" : "0");
+    if (dlg)
+        dlg->getImportSettings(prefs);
+
+    // Apply crop settings
+    _POPPLER_CONST PDFRectangle *clipToBox = nullptr;
+    double crop_setting = -1.0;
+    sp_repr_get_double(prefs, "cropTo", &crop_setting);
+
+    if ( crop_setting >= 0.0 ) {    // Do page clipping
+        int crop_choice = (int)crop_setting;
+        switch (crop_choice) {
+            case 0: // Media box
+                clipToBox = page->getMediaBox();
+                break;
+            case 1: // Crop box
+                clipToBox = page->getCropBox();
+                break;
+            case 2: // Bleed box
+                clipToBox = page->getBleedBox();
+                break;
+            case 3: // Trim box
+                clipToBox = page->getTrimBox();
+                break;
+            case 4: // Art box
+                clipToBox = page->getArtBox();
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Create parser  (extension/internal/pdfinput/pdf-parser.h)
+    PdfParser *pdf_parser = new PdfParser(pdf_doc->getXRef(), builder, page_num-1, page->getRotate(),
+                                          page->getResourceDict(), page->getCropBox(), clipToBox);
+
+    // Set up approximation precision for parser. Used for converting Mesh Gradients into tiles.
+    double color_delta = 2.0;
+    sp_repr_get_double(prefs, "approximationPrecision", &color_delta);
+    if ( color_delta <= 0.0 ) {
+        color_delta = 1.0 / 2.0;
+    } else {
+        color_delta = 1.0 / color_delta;
+    }
+    for ( int i = 1 ; i <= pdfNumShadingTypes ; i++ ) {
+        pdf_parser->setApproximationPrecision(i, color_delta, 6);
+    }
+
+    // Parse the document structure
+#if defined(POPPLER_NEW_OBJECT_API)
+    Object obj = page->getContents();
+#else
+    Object obj;
+    page->getContents(&obj);
+#endif
+    if (!obj.isNull()) {
+        pdf_parser->parse(&obj);
+    }
+
+    // Cleanup
+#if !defined(POPPLER_NEW_OBJECT_API)
+    obj.free();
+#endif
+    delete pdf_parser;
+    compact = !g_strcmp0(prefs->attribute("compactPaths"), "1");
+    unsigned merged_paths = builder->getMergedPaths();
+    unsigned elided_clips = builder->getElidedClips();
+    delete builder;
+
+    // The parser starts the page with a top level group, which the builder makes a layer.
+    Inkscape::XML::Node *layer = last ? last->next() : root->firstChild();
+    while (layer && !layer->attribute("inkscape:groupmode")) {
+        layer = layer->next();
+    }
+    if (compact) {
+        Inkscape::Debug::Logger::write<CompactPageEvent>(page_num, layer, merged_paths, elided_clips);
+    }
+    return layer;
+}
+
+/**
+ * Imports pages one below the other, each into a layer of its own, starting at offset.
+ * @return The width of the widest page and the height of all pages.
+ */
+static Geom::Point import_native_run(PDFDoc *pdf_doc, SPDocument *doc, gchar *docname,
+                                     std::vector<int> const &pages, double offset)
+{
+    Inkscape::XML::Node *root = doc->getReprRoot();
+    Geom::Point size(0, 0);
+    for (int page_num : pages) {
+        Inkscape::XML::Node *layer = import_native_page(pdf_doc, doc, docname, page_num, nullptr);
+        if (!layer) {
+            std::cerr << "PDFInput::open: error opening page " << page_num << std::endl;
+            continue;
+        }
+        Geom::Affine transform;
+        sp_svg_transform_read(layer->attribute("transform"), &transform);
+        layer->setAttributeOrRemoveIfEmpty("transform",
+                                           sp_svg_transform_write(transform * Geom::Translate(0, offset + size.y())));
+        gchar *label = g_strdup_printf(_("Page %d"), page_num);
+        layer->setAttribute("inkscape:label", label);
+        g_free(label);
+
+        // The builder sets the document size to that of the page.
+        double width = 0;
+        double height = 0;
+        sp_repr_get_double(root, "width", &width);
+        sp_repr_get_double(root, "height", &height);
+        size = Geom::Point(std::max(size.x(), width), size.y() + height);
+    }
+    return size;
+}
+
+/**
+ * Moves the layers and definitions of a document imported by a worker into doc, below offset.
+ * @return The size of the imported pages.
+ */
+static Geom::Point merge_native_run(SPDocument *part, SPDocument *doc, double offset)
+{
+    prevent_id_clashes(part, doc);
+
+    Inkscape::XML::Document *xml_doc = doc->getReprDoc();
+    Inkscape::XML::Node *root = doc->getReprRoot();
+    Inkscape::XML::Node *defs = doc->getDefs()->getRepr();
+    for (auto child = part->getReprRoot()->firstChild(); child; child = child->next()) {
+        if (!g_strcmp0(child->name(), "svg:defs")) {
+            for (auto def = child->firstChild(); def; def = def->next()) {
+                if (!g_strcmp0(def->name(), "svg:style")) {
+                    // The style classes of the compact mode go into the one style sheet.
+                    StyleClasses::addRules(defs, def->firstChild() ? def->firstChild()->content() : nullptr);
+                    continue;
+                }
+                Inkscape::XML::Node *copy = def->duplicate(xml_doc);
+                defs->appendChild(copy);
+                Inkscape::GC::release(copy);
+            }
+        } else if (child->attribute("inkscape:groupmode")) {
+            Inkscape::XML::Node *copy = child->duplicate(xml_doc);
+            Geom::Affine transform;
+            sp_svg_transform_read(copy->attribute("transform"), &transform);
+            copy->setAttributeOrRemoveIfEmpty("transform",
+                                              sp_svg_transform_write(transform * Geom::Translate(0, offset)));
+            root->appendChild(copy);
+            Inkscape::GC::release(copy);
+        }
+    }
+
+    double width = 0;
+    double height = 0;
+    sp_repr_get_double(part->getReprRoot(), "width", &width);
+    sp_repr_get_double(part->getReprRoot(), "height", &height);
+    return Geom::Point(width, height);
+}
+
+/**
+ * Imports a list of pages one below the other, each into a layer of its own.
+ *
+ * Documents are not thread safe, so the pages are split into runs and all but the first run
+ * are parsed by worker processes. A worker is this program run with '--pdf-pages=<run>
+ * --pdf-jobs=1', which hands its pages back as an SVG file. A run is parsed in this process if
+ * its worker can't be started or fails.
+ */
+static void import_native_pages(PDFDoc *pdf_doc, SPDocument *doc, gchar const *uri, gchar *docname,
+                                std::vector<int> const &pages)
+{
+    if (pages.empty()) {
+        std::cerr << "PDFInput::open: no pages to import" << std::endl;
+        return;
+    }
+
+    size_t workers = INKSCAPE.get_pdf_jobs();
+    if (workers == 0) {
+        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+        workers = prefs->getIntLimited("/options/threading/numthreads", g_get_num_processors(), 1, 256);
+    }
+    workers = std::min(workers, pages.size());
+
+    struct Run
+    {
+        std::vector<int> pages;
+        std::string filename;
+        bool running = false;
+        bool ok = false;
+    };
+    std::vector<Run> runs(workers);
+    for (size_t i = 0; i < pages.size(); ++i) {
+        runs[i * workers / pages.size()].pages.push_back(pages[i]);
+    }
+
+    auto context = Glib::MainContext::create();
+    for (size_t i = 1; i < runs.size(); ++i) {
+        auto &run = runs[i];
+        gchar *filename = nullptr;
+        int fd = g_file_open_tmp("ink_pdf_pages_XXXXXX.svg", &filename, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        g_close(fd, nullptr);
+        run.filename = filename;
+        g_free(filename);
+
+        std::string list;
+        for (int page_num : run.pages) {
+            list += (list.empty() ? "" : ",") + std::to_string(page_num);
+        }
+        Glib::Pid pid{};
+        if (!Inkscape::IO::spawn_worker({"--pdf-pages=" + list, "--pdf-jobs=1", "--export-type=svg",
+                                         "--export-filename=" + run.filename, uri},
+                                        &pid, nullptr, nullptr)) {
+            g_unlink(run.filename.c_str());
+            break; // The others would fail alike.
+        }
+        run.running = true;
+        context->signal_child_watch().connect(
+            [&run](Glib::Pid exited, int status) {
+                run.ok = g_spawn_check_exit_status(status, nullptr);
+                run.running = false;
+                Glib::spawn_close_pid(exited);
+            },
+            pid);
+    }
+
+    Geom::Point size(0, 0);
+    for (auto &run : runs) {
+        Geom::Point run_size;
+        bool merged = false;
+        if (run.running) {
+            while (run.running) {
+                context->iteration(true);
+            }
+            if (run.ok) {
+                std::unique_ptr<SPDocument> part(SPDocument::createNewDoc(run.filename.c_str(), false));
+                if (part) {
+                    run_size = merge_native_run(part.get(), doc, size.y());
+                    merged = true;
+                }
+            }
+            g_unlink(run.filename.c_str());
+        }
+        if (!merged) {
+            if (!run.filename.empty()) {
+                std::cerr << "PDFInput::open: worker failed, importing its pages in this process" << std::endl;
+            }
+            run_size = import_native_run(pdf_doc, doc, docname, run.pages, size.y());
+        }
+        size = Geom::Point(std::max(size.x(), run_size.x()), size.y() + run_size.y());
+    }
+
+    sp_repr_set_svg_double(doc->getReprRoot(), "width", size.x());
+    sp_repr_set_svg_double(doc->getReprRoot(), "height", size.y());
+}
+
+/**
+ * Parses the selected page, or the pages given with --pdf-pages, of the given PDF document using PdfParser.
  */
 SPDocument *
 PdfInput::open(::Inkscape::Extension::Input * /*mod*/, const gchar * uri) {
@@ -711,6 +1079,7 @@ PdfInput::open(::Inkscape::Extension::Input * /*mod*/, const gchar * uri) {
 
     // Get options
     int page_num = 1;
+    std::string pages;
     bool is_importvia_poppler = false;
     if (dlg) {
         page_num = dlg->getSelectedPage();
@@ -720,8 +1089,15 @@ PdfInput::open(::Inkscape::Extension::Input * /*mod*/, const gchar * uri) {
 #endif
     } else {
         page_num = INKSCAPE.get_pdf_page();
+        pages = INKSCAPE.get_pdf_pages();
 #ifdef HAVE_POPPLER_CAIRO
         is_importvia_poppler = INKSCAPE.get_pdf_poppler();
+        if (is_importvia_poppler && !pages.empty()) {
+            auto range = parse_page_range(pages, pdf_doc->getCatalog()->getNumPages());
+            std::cerr << "PDFInput::open: --pdf-pages needs the internal import, "
+                      << "importing the first page of the range." << std::endl;
+            page_num = range.empty() ? 1 : range.front();
+        }
 #endif
     }
 
@@ -732,95 +1108,29 @@ PdfInput::open(::Inkscape::Extension::Input * /*mod*/, const gchar * uri) {
     {
         // native importer
 
-        // Check page exists
-        Catalog *catalog = pdf_doc->getCatalog();
-        int const num_pages = catalog->getNumPages();
-        sanitize_page_number(page_num, num_pages);
-        Page *page = catalog->getPage(page_num);
-        if (!page) {
-            std::cerr << "PDFInput::open: error opening page " << page_num << std::endl;
-            return nullptr;
-        }
-
         // Create document
         doc = SPDocument::createNewDoc(nullptr, true, true);
         saved = DocumentUndo::getUndoSensitive(doc);
         DocumentUndo::setUndoSensitive(doc, false); // No need to undo in this temporary document
 
-        // Create builder
         gchar *docname = g_path_get_basename(uri);
         gchar *dot = g_strrstr(docname, ".");
         if (dot) {
             *dot = 0;
         }
-        SvgBuilder *builder = new SvgBuilder(doc, docname, pdf_doc->getXRef());
-
-        // Get preferences
-        Inkscape::XML::Node *prefs = builder->getPreferences();
-        if (dlg)
-            dlg->getImportSettings(prefs);
-
-        // Apply crop settings
-        _POPPLER_CONST PDFRectangle *clipToBox = nullptr;
-        double crop_setting = -1.0;
-        sp_repr_get_double(prefs, "cropTo", &crop_setting);
-
-        if ( crop_setting >= 0.0 ) {    // Do page clipping
-            int crop_choice = (int)crop_setting;
-            switch (crop_choice) {
-                case 0: // Media box
-                    clipToBox = page->getMediaBox();
-                    break;
-                case 1: // Crop box
-                    clipToBox = page->getCropBox();
-                    break;
-                case 2: // Bleed box
-                    clipToBox = page->getBleedBox();
-                    break;
-                case 3: // Trim box
-                    clipToBox = page->getTrimBox();
-                    break;
-                case 4: // Art box
-                    clipToBox = page->getArtBox();
-                    break;
-                default:
-                    break;
-            }
-        }
 
-        // Create parser  (extension/internal/pdfinput/pdf-parser.h)
-        PdfParser *pdf_parser = new PdfParser(pdf_doc->getXRef(), builder, page_num-1, page->getRotate(),
-                                              page->getResourceDict(), page->getCropBox(), clipToBox);
-
-        // Set up approximation precision for parser. Used for converting Mesh Gradients into tiles.
-        double color_delta = 2.0;
-        sp_repr_get_double(prefs, "approximationPrecision", &color_delta);
-        if ( color_delta <= 0.0 ) {
-            color_delta = 1.0 / 2.0;
+        int const num_pages = pdf_doc->getCatalog()->getNumPages();
+        if (pages.empty()) {
+            sanitize_page_number(page_num, num_pages);
+            if (!import_native_page(pdf_doc.get(), doc, docname, page_num, dlg.get())) {
+                std::cerr << "PDFInput::open: error opening page " << page_num << std::endl;
+                g_free(docname);
+                delete doc;
+                return nullptr;
+            }
         } else {
-            color_delta = 1.0 / color_delta;
-        }
-        for ( int i = 1 ; i <= pdfNumShadingTypes ; i++ ) {
-            pdf_parser->setApproximationPrecision(i, color_delta, 6);
+            import_native_pages(pdf_doc.get(), doc, uri, docname, parse_page_range(pages, num_pages));
         }
-
-        // Parse the document structure
-#if defined(POPPLER_NEW_OBJECT_API)
-        Object obj = page->getContents();
-#else
-        Object obj;
-        page->getContents(&obj);
-#endif
-        if (!obj.isNull()) {
-            pdf_parser->parse(&obj);
-        }
-
-        // Cleanup
-#if !defined(POPPLER_NEW_OBJECT_API)
-        obj.free();
-#endif
-        delete pdf_parser;
-        delete builder;
         g_free(docname);
     }
     else
@@ -113,6 +113,7 @@ private:
 #endif
     class Gtk::CheckButton * _localFontsCheck;
     class Gtk::CheckButton * _embedImagesCheck;
+    class Gtk::CheckButton * _compactPathsCheck;
     class Gtk::Box * vbox3;
     class Inkscape::UI::Widget::Frame * _importSettingsFrame;
     class Gtk::Box * vbox1;
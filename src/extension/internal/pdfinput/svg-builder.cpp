@@ -21,6 +21,7 @@
 #ifdef HAVE_POPPLER
 
 #include "svg-builder.h"
+#include "extension/internal/style-classes.h"
 #include "pdf-parser.h"
 
 #include "document.h"
@@ -71,6 +72,17 @@ struct SvgTransparencyGroup {
     SvgTransparencyGroup *next;
 };
 
+/**
+ * \struct SvgCompactState
+ * \brief Holds the style classes and statistics of the compact mode
+ * Shared by a builder and the builders of its patterns.
+ */
+struct SvgCompactState {
+    StyleClasses classes{"pdf"};
+    unsigned merged_paths = 0;
+    unsigned elided_clips = 0;
+};
+
 /**
  * \class SvgBuilder
  * 
@@ -85,6 +97,7 @@ SvgBuilder::SvgBuilder(SPDocument *document, gchar *docname, XRef *xref)
     _xml_doc = _doc->getReprDoc();
     _container = _root = _doc->getReprRoot();
     _root->setAttribute("xml:space", "preserve");
+    _compact = std::make_shared<SvgCompactState>();
     _init();
 
     // Set default preference settings
@@ -101,10 +114,24 @@ SvgBuilder::SvgBuilder(SvgBuilder *parent, Inkscape::XML::Node *root) {
     _xml_doc = parent->_xml_doc;
     _preferences = parent->_preferences;
     _container = this->_root = root;
+    _compact = parent->_compact;
     _init();
 }
 
-SvgBuilder::~SvgBuilder() = default;
+SvgBuilder::~SvgBuilder() {
+    _flushPath();
+    if (_is_top_level) {
+        StyleClasses::addRules(_doc->getDefs()->getRepr(), _compact->classes.rules().c_str());
+    }
+}
+
+unsigned SvgBuilder::getMergedPaths() const {
+    return _compact->merged_paths;
+}
+
+unsigned SvgBuilder::getElidedClips() const {
+    return _compact->elided_clips;
+}
 
 void SvgBuilder::_init() {
     _font_style = nullptr;
@@ -452,6 +479,44 @@ SPCSSAttr *SvgBuilder::_setStyle(GfxState *state, bool fill, bool stroke, bool e
  * \param even_odd whether the even-odd rule should be used when filling the path
  */
 void SvgBuilder::addPath(GfxState *state, bool fill, bool stroke, bool even_odd) {
+    if (_isCompact()) {
+        gchar *pathtext = svgInterpretPath(state->getPath());
+        SPCSSAttr *css = _setStyle(state, fill, stroke, even_odd);
+        GfxBlendMode blendmode = state->getBlendMode();
+        if (blendmode) {
+            sp_repr_css_set_property(css, "mix-blend-mode", enum_blend_mode[blendmode].key);
+        }
+        std::string const &style_class = _getStyleClass(css);
+        sp_repr_css_attr_unref(css);
+
+        // Opaque strokes look the same whether they are drawn one by one or as one path.
+        bool mergeable = !fill && stroke && !blendmode && state->getStrokeOpacity() == 1.0 &&
+                         state->getStrokeColorSpace()->getMode() != csPattern;
+        if (mergeable && _merge_path && _container->lastChild() == _merge_path &&
+            _merge_class == style_class) {
+            _merge_data += " ";
+            _merge_data += pathtext;
+            _compact->merged_paths++;
+            g_free(pathtext);
+            return;
+        }
+
+        _flushPath();
+        Inkscape::XML::Node *path = _xml_doc->createElement("svg:path");
+        path->setAttribute("class", style_class);
+        if (mergeable) {
+            _merge_path = path;
+            _merge_class = style_class;
+            _merge_data = pathtext;
+        } else {
+            path->setAttribute("d", pathtext);
+        }
+        g_free(pathtext);
+        _container->appendChild(path);
+        Inkscape::GC::release(path);
+        return;
+    }
+
     Inkscape::XML::Node *path = _xml_doc->createElement("svg:path");
     gchar *pathtext = svgInterpretPath(state->getPath());
     path->setAttribute("d", pathtext);
@@ -466,6 +531,35 @@ void SvgBuilder::addPath(GfxState *state, bool fill, bool stroke, bool even_odd)
     Inkscape::GC::release(path);
 }
 
+/**
+ * \brief Whether paths are merged and styled through classes, and redundant clips left out
+ * Set by the "compactPaths" preference.
+ */
+bool SvgBuilder::_isCompact() const {
+    gchar const *compact = _preferences->attribute("compactPaths");
+    return compact && !strcmp(compact, "1");
+}
+
+/**
+ * \brief Returns the name of the class with the given style, adding the class if needed
+ */
+std::string const &SvgBuilder::_getStyleClass(SPCSSAttr *css) {
+    Glib::ustring style;
+    sp_repr_css_write_string(css, style);
+    return _compact->classes.get(style.raw());
+}
+
+/**
+ * \brief Writes the data of the merged path into its node
+ */
+void SvgBuilder::_flushPath() {
+    if (_merge_path) {
+        _merge_path->setAttribute("d", _merge_data);
+        _merge_path = nullptr;
+        _merge_data.clear();
+    }
+}
+
 /**
  * \brief Emits the current path in poppler's GfxState data structure
  * The path is set to be filled with the given shading.
@@ -530,10 +624,44 @@ void SvgBuilder::addShadedFill(GfxShading *shading, double *matrix, GfxPath *pat
  * \param even_odd whether the even-odd rule should be applied
  */
 void SvgBuilder::clip(GfxState *state, bool even_odd) {
+    if (_isCompact()) {
+        gchar *pathtext = svgInterpretPath(state->getPath());
+        bool redundant = _isClipRedundant(pathtext, even_odd);
+        g_free(pathtext);
+        if (redundant) {
+            _compact->elided_clips++;
+            return;
+        }
+    }
     pushGroup();
     setClipPath(state, even_odd);
 }
 
+/**
+ * \brief Checks whether the content of the current container is already clipped to the path
+ * PDF files often set the same clip again for every object they draw.
+ */
+bool SvgBuilder::_isClipRedundant(gchar const *pathtext, bool even_odd) {
+    for (Inkscape::XML::Node *node = _container; node; node = node->parent()) {
+        gchar const *clip_path_url = node->attribute("clip-path");
+        if (clip_path_url) {
+            if (!g_str_has_prefix(clip_path_url, "url(#") || !g_str_has_suffix(clip_path_url, ")")) {
+                return false;
+            }
+            std::string clip_path_id(clip_path_url + 5, strlen(clip_path_url) - 6);
+            SPObject *clip_obj = _doc->getObjectById(clip_path_id.c_str());
+            Inkscape::XML::Node *path = clip_obj ? clip_obj->getRepr()->firstChild() : nullptr;
+            return path && !path->next() && !g_strcmp0(path->attribute("d"), pathtext) &&
+                   even_odd == !g_strcmp0(path->attribute("clip-rule"), "evenodd");
+        }
+        // Clips above a transform are in other coordinates.
+        if (node->attribute("transform") || node == _root) {
+            return false;
+        }
+    }
+    return false;
+}
+
 void SvgBuilder::setClipPath(GfxState *state, bool even_odd) {
     // Create the clipPath repr
     Inkscape::XML::Node *clip_path = _xml_doc->createElement("svg:clipPath");
@@ -47,6 +47,8 @@ class XRef;
 
 class SPCSSAttr;
 
+#include <memory>
+#include <string>
 #include <vector>
 #include <glib.h>
 
@@ -55,6 +57,7 @@ namespace Extension {
 namespace Internal {
 
 struct SvgTransparencyGroup;
+struct SvgCompactState;
 
 /**
  * Holds information about the current softmask and group depth for use of libpoppler.
@@ -102,6 +105,10 @@ public:
         return _preferences;
     }
 
+    // Statistics of the compact mode, see the "compactPaths" preference
+    unsigned getMergedPaths() const;
+    unsigned getElidedClips() const;
+
     // Handling the node stack
     Inkscape::XML::Node *pushGroup();
     Inkscape::XML::Node *popGroup();
@@ -192,6 +199,12 @@ private:
     void _setBlendMode(Inkscape::XML::Node *node, GfxState *state);
     void _flushText();    // Write buffered text into doc
 
+    // Compact mode
+    bool _isCompact() const;
+    std::string const &_getStyleClass(SPCSSAttr *css);
+    void _flushPath();    // Write the merged path data into doc
+    bool _isClipRedundant(gchar const *pathtext, bool even_odd);
+
     std::string _BestMatchingFont(std::string PDFname);
 
     // Handling of node stack
@@ -227,6 +240,11 @@ private:
     double _height;       // Document size in px
     double _ttm[6]; ///< temporary transform matrix
     bool _ttm_is_set;
+
+    std::shared_ptr<SvgCompactState> _compact; // Shared with the child builders
+    Inkscape::XML::Node *_merge_path = nullptr;  // Path that the following paths can be merged into
+    std::string _merge_class;   // Style class of _merge_path
+    std::string _merge_data;    // Path data of _merge_path, written by _flushPath()
 };
 
 
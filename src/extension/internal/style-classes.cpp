@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Style classes that imports share repeated styles through
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "extension/internal/style-classes.h"
+
+#include <set>
+#include <sstream>
+
+#include <glib.h>
+
+#include "xml/document.h"
+#include "xml/node.h"
+
+namespace Inkscape {
+namespace Extension {
+namespace Internal {
+
+std::string const &StyleClasses::get(std::string const &style)
+{
+    auto found = _classes.find(style);
+    if (found != _classes.end()) {
+        return found->second;
+    }
+
+    gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, style.c_str(), -1);
+    std::string name = _prefix + std::string(checksum, 12);
+    g_free(checksum);
+    _rules += "." + name + "{" + style + "}\n";
+    return _classes.emplace(style, name).first->second;
+}
+
+void StyleClasses::addRules(Inkscape::XML::Node *defs, char const *rules)
+{
+    if (!rules || !*rules) {
+        return;
+    }
+    Inkscape::XML::Document *xml_doc = defs->document();
+    Inkscape::XML::Node *style = defs->firstChild();
+    while (style && g_strcmp0(style->name(), "svg:style")) {
+        style = style->next();
+    }
+    if (!style) {
+        style = xml_doc->createElement("svg:style");
+        defs->appendChild(style);
+        Inkscape::GC::release(style);
+    }
+    Inkscape::XML::Node *text = style->firstChild();
+    if (!text) {
+        text = xml_doc->createTextNode("");
+        style->appendChild(text);
+        Inkscape::GC::release(text);
+    }
+
+    std::string sheet = text->content() ? text->content() : "";
+    std::set<std::string> known;
+    std::istringstream known_lines(sheet);
+    for (std::string line; std::getline(known_lines, line);) {
+        known.insert(line);
+    }
+    if (!sheet.empty() && sheet.back() != '\n') {
+        sheet += '\n';
+    }
+    bool changed = false;
+    std::istringstream lines(rules);
+    for (std::string line; std::getline(lines, line);) {
+        if (!line.empty() && known.insert(line).second) {
+            sheet += line + "\n";
+            changed = true;
+        }
+    }
+    if (changed) {
+        text->setContent(sheet.c_str());
+    }
+}
+
+} // namespace Internal
+} // namespace Extension
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Style classes that imports share repeated styles through
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_EXTENSION_INTERNAL_STYLE_CLASSES_H
+#define SEEN_EXTENSION_INTERNAL_STYLE_CLASSES_H
+
+#include <map>
+#include <string>
+
+namespace Inkscape {
+namespace XML {
+class Node;
+}
+
+namespace Extension {
+namespace Internal {
+
+/**
+ * The classes of the styles an import writes, and the style sheet that defines them.
+ *
+ * A class is named after its style, so that documents imported separately, like the pages of
+ * a PDF, agree on the names and can share one style sheet.
+ */
+class StyleClasses
+{
+public:
+    /// The names of the classes start with prefix, which tells the imports apart.
+    explicit StyleClasses(char const *prefix) : _prefix(prefix) {}
+
+    /// The name of the class with the given style, adding the class if needed.
+    std::string const &get(std::string const &style);
+
+    /// The rules of the classes added so far, one per line.
+    std::string const &rules() const { return _rules; }
+
+    /**
+     * Adds rules to the style sheet in defs, which is the first style element in it. Rules that
+     * are already there are left out.
+     */
+    static void addRules(Inkscape::XML::Node *defs, char const *rules);
+
+private:
+    std::string _prefix;
+    std::map<std::string, std::string> _classes; // Class name by style
+    std::string _rules;
+};
+
+} // namespace Internal
+} // namespace Extension
+} // namespace Inkscape
+
+#endif // SEEN_EXTENSION_INTERNAL_STYLE_CLASSES_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
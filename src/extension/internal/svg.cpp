@@ -29,6 +29,7 @@
 #include "file.h"
 #include "svg.h"
 #include "file.h"
+#include "debug/timing-report.h"
 #include "display/cairo-utils.h"
 #include "extension/system.h"
 #include "extension/output.h"
@@ -1027,10 +1028,13 @@ Svg::save(Inkscape::Extension::Output *mod, SPDocument *doc, gchar const *filena
         rdoc = new_rdoc;
     }
 
-    if (!sp_repr_save_rebased_file(rdoc, filename, SP_SVG_NS_URI,
-                                   doc->getDocumentBase(), //
-                                   m_detachbase ? nullptr : filename)) {
-        throw Inkscape::Extension::Output::save_failed();
+    {
+        Inkscape::Debug::PhaseTracker tracker("encoding");
+        if (!sp_repr_save_rebased_file(rdoc, filename, SP_SVG_NS_URI,
+                                       doc->getDocumentBase(), //
+                                       m_detachbase ? nullptr : filename)) {
+            throw Inkscape::Extension::Output::save_failed();
+        }
     }
 
     if (createNewDoc) {
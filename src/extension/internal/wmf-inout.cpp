@@ -45,6 +45,7 @@
 #include "svg/svg.h"
 #include "util/units.h" // even though it is included indirectly by wmf-inout.h
 #include "inkscape.h" // even though it is included indirectly by wmf-inout.h
+#include "xml/repr.h"
 
 
 #include "wmf-inout.h"
@@ -1544,12 +1545,10 @@ int Wmf::myMetaFileProc(const char *contents, unsigned int length, PWMF_CALLBACK
     // code for end user debugging
     int  wDbgRecord=0;
     int  wDbgComment=0;
-    int  wDbgFinal=0;
     char const* wDbgString = getenv( "INKSCAPE_DBG_WMF" );
     if ( wDbgString != nullptr ) {
         if(strstr(wDbgString,"RECORD")){  wDbgRecord  = 1; }
         if(strstr(wDbgString,"COMMENT")){ wDbgComment = 1; }
-        if(strstr(wDbgString,"FINAL")){   wDbgFinal   = 1; }
     }
 
     /* initialize the tsp for text reassembly */
@@ -1671,7 +1670,7 @@ int Wmf::myMetaFileProc(const char *contents, unsigned int length, PWMF_CALLBACK
         d->dc[0].style.stroke_width.value =  pix_to_abs_size( d, 1 ); // This could not be set until the size of the WMF was known
         dbg_str << "<!-- U_WMR_HEADER -->\n";
 
-        d->outdef += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+        d->outsvg += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
 
         SVGOStringStream tmp_outdef;
         tmp_outdef << "<svg\n";
@@ -1684,8 +1683,8 @@ int Wmf::myMetaFileProc(const char *contents, unsigned int length, PWMF_CALLBACK
         tmp_outdef <<
             "  width=\"" << Inkscape::Util::Quantity::convert(d->PixelsOutX, "px", "mm") << "mm\"\n" <<
             "  height=\"" << Inkscape::Util::Quantity::convert(d->PixelsOutY, "px", "mm")  << "mm\">\n";
-        d->outdef += tmp_outdef.str().c_str();
-        d->outdef += "<defs>";                           // temporary end of header
+        d->outsvg += tmp_outdef.str().c_str();
+        d->outsvg += "<defs>\n</defs>\n\n";               // d->defs is moved in when the document is finished
 
         // d->defs holds any defines which are read in.
 
@@ -1826,7 +1825,7 @@ std::cout << "BEFORE DRAW"
         {
             dbg_str << "<!-- U_WMR_EOF -->\n";
 
-            d->outsvg = d->outdef + d->defs + "\n</defs>\n\n" + d->outsvg + "</svg>\n";
+            d->outsvg += "</svg>\n";
             OK=0;
             break;
         }
@@ -3079,17 +3078,18 @@ std::cout << "BEFORE DRAW"
        d->outsvg += dbg_str.str().c_str();
     }
     d->path   += tmp_path.str().c_str();
+
+    // The path is kept until it is drawn, everything else is read into the document right away.
+    d->builder.addBody(d->outsvg);
+    d->builder.addDefs(d->outdef);
+    d->builder.addDefs(d->defs);
+
     if(!nSize){ // There was some problem with the processing of this record, it is not safe to continue
         file_status = 0;
         break;
     } 
 
     }  //end of while on OK
-//  At run time define environment variable INKSCAPE_DBG_WMF to include string FINAL
-//  Users may employ this to to show the final SVG derived from the WMF
-    if(wDbgFinal){
-       std::cout << d->outsvg << std::endl;
-    }
     (void) U_wmr_properties(U_WMR_INVALID);  // force the release of the lookup table memory, returned value is irrelevant
 
     return(file_status);
@@ -3165,14 +3165,27 @@ Wmf::open( Inkscape::Extension::Input * /*mod*/, const gchar *uri )
       FT_LOAD_NO_SCALE | FT_LOAD_NO_HINTING  | FT_LOAD_NO_BITMAP,
       FT_KERNING_UNSCALED);
 
+    gint64 start = g_get_monotonic_time();
     int good = myMetaFileProc(contents,length, &d);
     free(contents);
 
-//    std::cout << "SVG Output: " << std::endl << d.outsvg << std::endl;
-
     SPDocument *doc = nullptr;
     if (good) {
-        doc = SPDocument::createNewDocFromMem(d.outsvg.c_str(), strlen(d.outsvg.c_str()), TRUE);
+        doc = d.builder.finish();
+    }
+
+//  At run time define environment variable INKSCAPE_DBG_WMF to include string FINAL
+//  Users may employ this to to show the final SVG derived from the WMF,
+//  and string TIME to show how long the import took.
+    char const* wDbgString = getenv( "INKSCAPE_DBG_WMF" );
+    if (doc && wDbgString != nullptr) {
+        if(strstr(wDbgString,"FINAL")){
+           std::cout << sp_repr_save_buf(doc->getReprDoc()) << std::endl;
+        }
+        if(strstr(wDbgString,"TIME")){
+           std::cout << "WMF import: " << length << " bytes read, " << d.builder.svgLength()
+                     << " bytes of SVG, " << (g_get_monotonic_time() - start) / 1000 << " ms" << std::endl;
+        }
     }
 
     free_wmf_strings(d.hatches);
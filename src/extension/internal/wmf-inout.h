@@ -107,6 +107,7 @@ using PWMF_DEVICE_CONTEXT = WMF_DEVICE_CONTEXT *;
 struct WMF_CALLBACK_DATA {
 
     WMF_CALLBACK_DATA() :
+        builder("wmf"),
         // dc: array, structure w/ constructor
         level(0),
         E2IdirY(1.0),
@@ -126,10 +127,12 @@ struct WMF_CALLBACK_DATA {
         //wmf_obj
     {};
 
+    // The SVG of the current record, handed to builder once the record is done
     Glib::ustring outsvg;
     Glib::ustring path;
     Glib::ustring outdef;
     Glib::ustring defs;
+    MetafileDocumentBuilder builder;
 
     WMF_DEVICE_CONTEXT dc[WMF_MAX_DC+1]; // FIXME: This should be dynamic..
     int level;
@@ -12,6 +12,9 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <atomic>
+#include <thread>
+
 #include <2geom/transforms.h>
 
 #include "helper/png-write.h"
@@ -130,6 +133,81 @@ Inkscape::Pixbuf *sp_generate_internal_bitmap(SPDocument *doc, gchar const */*fi
     return inkpb;
 }
 
+/**
+ * Renders jobs, taking turns with the other threads through next.
+ */
+static void render_item_bitmaps(std::vector<SPItemBitmapJob> &jobs,
+                                std::vector<Inkscape::DrawingItem *> const &items, std::atomic<size_t> &next)
+{
+    for (size_t i = next++; i < jobs.size(); i = next++) {
+        auto &job = jobs[i];
+        if (!items[i]) {
+            continue;
+        }
+        cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, job.area.width(), job.area.height());
+        if (cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS) {
+            Inkscape::DrawingContext dc(surface, job.area.min());
+            items[i]->render(dc, job.area, Inkscape::DrawingItem::RENDER_BYPASS_CACHE);
+            job.pixbuf.reset(new Inkscape::Pixbuf(surface));
+        } else {
+            long long size = (long long) job.area.height() * (long long) cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, job.area.width());
+            g_warning("sp_generate_internal_bitmaps: not enough memory to create pixel buffer. Need %lld.", size);
+            cairo_surface_destroy(surface);
+        }
+    }
+}
+
+void sp_generate_internal_bitmaps(SPDocument *doc, double dpi, std::vector<SPItemBitmapJob> &jobs)
+{
+    if (jobs.empty()) return;
+
+    doc->ensureUpToDate();
+    int threads = sp_export_rendering_threads(doc, jobs.size());
+
+    // Showing the document changes its objects, so each thread's drawing is set up here.
+    Geom::Scale scale(Inkscape::Util::Quantity::convert(dpi, "px", "in"));
+    std::vector<std::unique_ptr<Inkscape::Drawing>> drawings;
+    std::vector<std::vector<Inkscape::DrawingItem *>> items(threads);
+    std::vector<unsigned> dkeys;
+    for (int i = 0; i < threads; ++i) {
+        auto drawing = std::make_unique<Inkscape::Drawing>();
+        drawing->setExact(true);
+        unsigned dkey = SPItem::display_key_new(1);
+        Inkscape::DrawingItem *root = doc->getRoot()->invoke_show(*drawing, dkey, SP_ITEM_SHOW_DISPLAY);
+        root->setTransform(scale);
+        drawing->setRoot(root);
+
+        // Each item is rendered on its own rather than with the others hidden, so the items
+        // around it do not have to be updated for every job.
+        for (auto &job : jobs) {
+            Inkscape::DrawingItem *item = job.item->get_arenaitem(dkey);
+            if (item) {
+                // The caller applies the opacity, as in sp_generate_internal_bitmap().
+                item->setOpacity(1.0);
+            }
+            items[i].push_back(item);
+        }
+        drawing->update();
+
+        drawings.push_back(std::move(drawing));
+        dkeys.push_back(dkey);
+    }
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(render_item_bitmaps, std::ref(jobs), std::cref(items[i]), std::ref(next));
+    }
+    render_item_bitmaps(jobs, items[0], next);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    for (auto dkey : dkeys) {
+        doc->getRoot()->invoke_hide(dkey);
+    }
+}
+
 /*
   Local Variables:
   mode:c++
@@ -13,7 +13,11 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <memory>
+#include <vector>
+
 #include <glib.h>
+#include <2geom/int-rect.h>
 
 class SPDocument;
 class SPItem;
@@ -24,4 +28,19 @@ Inkscape::Pixbuf *sp_generate_internal_bitmap(SPDocument *doc, gchar const *file
                    unsigned width, unsigned height, double xdpi, double ydpi,
                    unsigned long bgcolor, SPItem *item_only = nullptr);
 
+/**
+ * One item to render with sp_generate_internal_bitmaps().
+ */
+struct SPItemBitmapJob {
+    SPItem *item;
+    Geom::IntRect area; ///< In pixels of the document at the resolution of the bitmaps
+    std::unique_ptr<Inkscape::Pixbuf> pixbuf; ///< The bitmap, nullptr if it could not be made
+};
+
+/**
+ * Renders items into bitmaps, each on its own at full opacity. The document is shown once
+ * for all of them, and they are rendered on the threads set in the preferences.
+ */
+void sp_generate_internal_bitmaps(SPDocument *doc, double dpi, std::vector<SPItemBitmapJob> &jobs);
+
 #endif
@@ -15,6 +15,18 @@
  */
 
 
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #include <2geom/rect.h>
 #include <2geom/transforms.h>
 
@@ -26,6 +38,7 @@
 #include "preferences.h"
 #include "rdf.h"
 
+#include "debug/timing-report.h"
 #include "display/cairo-utils.h"
 #include "display/drawing-context.h"
 #include "display/drawing.h"
@@ -33,8 +46,14 @@
 #include "io/sys.h"
 
 #include "object/sp-defs.h"
+#include "object/sp-font.h"
+#include "object/sp-gradient.h"
+#include "object/sp-image.h"
 #include "object/sp-item.h"
+#include "object/sp-mesh-gradient.h"
+#include "object/sp-pattern.h"
 #include "object/sp-root.h"
+#include "object/filters/image.h"
 
 #include "ui/interface.h"
 #include "util/units.h"
@@ -51,13 +70,16 @@
  * working PNG reader/writer, see pngtest.c, included in this distribution.
  */
 
+class StripeRenderer;
+
 struct SPEBP {
     unsigned long int width, height, sheight;
+    unsigned long int tile_width; // rows are rendered in tiles this wide, or whole if 0
     guint32 background;
     Inkscape::Drawing *drawing; // it is assumed that all unneeded items are hidden
-    guchar *px;
     unsigned (*status)(float, void *);
     void *data;
+    StripeRenderer *renderer; // renders stripes ahead on other threads, if not null
 };
 
 /* write a png file */
@@ -320,60 +342,241 @@ sp_png_write_rgba_striped(SPDocument *doc,
 
 
 /**
+ * Renders num_rows rows starting at row into a new buffer in the format libpng is given,
+ * and points rows at them.
+ * @return The buffer, to be freed with g_free().
+ */
+static guchar const *
+sp_export_render_rows(guchar const **rows, Inkscape::Drawing &drawing, SPEBP const &ebp, int row, int num_rows, int color_type, int bit_depth, int antialiasing)
+{
+    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp.width);
+    unsigned char *px = g_new(guchar, num_rows * stride);
+
+    // Rendering goes through intermediate surfaces the size of the rendered area, for groups,
+    // clips, masks and filters. Rendering in tiles keeps those small for wide images.
+    unsigned long tile_width = ebp.tile_width ? ebp.tile_width : ebp.width;
+    for (unsigned long x = 0; x < ebp.width; x += tile_width) {
+        /* Set area of interest */
+        Geom::IntRect bbox = Geom::IntRect::from_xywh(x, row, std::min(tile_width, ebp.width - x), num_rows);
+
+        /* Update to renderable state */
+        drawing.update(bbox);
+
+        cairo_surface_t *s = cairo_image_surface_create_for_data(
+            px + 4 * x, CAIRO_FORMAT_ARGB32, bbox.width(), num_rows, stride);
+        Inkscape::DrawingContext dc(s, bbox.min());
+        dc.setSource(ebp.background);
+        dc.setOperator(CAIRO_OPERATOR_SOURCE);
+        dc.paint();
+        dc.setOperator(CAIRO_OPERATOR_OVER);
+
+        /* Render */
+        drawing.render(dc, bbox, 0, antialiasing);
+        cairo_surface_destroy(s);
+    }
+
+    // PNG stores data as unpremultiplied big-endian RGBA, which means
+    // it's identical to the GdkPixbuf format.
+    convert_pixels_argb32_to_pixbuf(px, ebp.width, num_rows, stride);
+    
+    // If a custom bit depth or color type is asked, then convert rgb to grayscale, etc.
+    const guchar* new_data = pixbuf_to_png(rows, px, num_rows, ebp.width, stride, color_type, bit_depth);
+    free(px);
+
+    return new_data;
+}
+
+/**
+ * Renders the stripes of an export ahead of the PNG encoder on several threads, and hands
+ * them out in order. Drawings cannot be rendered from several threads at once, so every
+ * thread renders its own copy. At most two stripes per thread are kept waiting.
  *
+ * Stripes are numbered across all passes of an interlaced image, each pass rendering the
+ * whole image again like the serial code does.
  */
-static int
-sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth, int antialiasing)
+class StripeRenderer
 {
-    struct SPEBP *ebp = (struct SPEBP *) data;
+public:
+    StripeRenderer(std::vector<Inkscape::Drawing *> const &drawings, SPEBP const &ebp, int passes,
+                   int color_type, int bit_depth, int antialiasing)
+        : _ebp(ebp)
+        , _stripes_per_pass((ebp.height + ebp.sheight - 1) / ebp.sheight)
+        , _total(_stripes_per_pass * passes)
+        , _lookahead(2 * drawings.size())
+        , _color_type(color_type)
+        , _bit_depth(bit_depth)
+        , _antialiasing(antialiasing)
+    {
+        for (auto drawing : drawings) {
+            _threads.emplace_back(&StripeRenderer::run, this, drawing);
+        }
+    }
 
-    if (ebp->status) {
-        if (!ebp->status((float) row / ebp->height, ebp->data)) return 0;
+    ~StripeRenderer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cancelled = true;
+        }
+        _cond.notify_all();
+        for (auto &thread : _threads) {
+            thread.join();
+        }
+        for (auto &done : _done) {
+            g_free(const_cast<guchar *>(done.second.data));
+        }
     }
 
-    num_rows = MIN(num_rows, static_cast<int>(ebp->sheight));
-    num_rows = MIN(num_rows, static_cast<int>(ebp->height - row));
+    StripeRenderer(StripeRenderer const &) = delete;
+    StripeRenderer &operator=(StripeRenderer const &) = delete;
 
-    /* Set area of interest */
-    // bbox is now set to the entire image to prevent discontinuities
-    // in the image when blur is used (the borders may still be a bit
-    // off, but that's less noticeable).
-    Geom::IntRect bbox = Geom::IntRect::from_xywh(0, row, ebp->width, num_rows);
+    /**
+     * Waits for the next stripe and points rows at it.
+     * @return The number of rows, 0 after the last stripe.
+     */
+    int next(guchar const **rows, void **to_free)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_handed_out == _total) {
+            return 0;
+        }
+        _cond.wait(lock, [this] { return _done.count(_handed_out) != 0; });
+        Stripe stripe = std::move(_done[_handed_out]);
+        _done.erase(_handed_out);
+        ++_handed_out;
+        lock.unlock();
+        _cond.notify_all();
+
+        std::copy(stripe.rows.begin(), stripe.rows.end(), rows);
+        *to_free = const_cast<guchar *>(stripe.data);
+        return stripe.rows.size();
+    }
 
-    /* Update to renderable state */
-    ebp->drawing->update(bbox);
+    /**
+     * Whether progress should be reported before the next stripe. Reporting needs pause(),
+     * which leaves the threads idle, so it is done once per lookahead of stripes.
+     */
+    bool reportDue() const { return _handed_out % _lookahead == 0; }
 
-    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp->width);
-    unsigned char *px = g_new(guchar, num_rows * stride);
+    /**
+     * Stops starting new stripes and waits for those being rendered, so that the calling
+     * thread can use things rendering also uses, like preferences. Call resume() after.
+     */
+    void pause()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _paused = true;
+        _cond.wait(lock, [this] { return _busy == 0; });
+    }
 
-    cairo_surface_t *s = cairo_image_surface_create_for_data(
-        px, CAIRO_FORMAT_ARGB32, ebp->width, num_rows, stride);
-    Inkscape::DrawingContext dc(s, bbox.min());
-    dc.setSource(ebp->background);
-    dc.setOperator(CAIRO_OPERATOR_SOURCE);
-    dc.paint();
-    dc.setOperator(CAIRO_OPERATOR_OVER);
+    void resume()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _paused = false;
+        }
+        _cond.notify_all();
+    }
 
-    /* Render */
-    ebp->drawing->render(dc, bbox, 0, antialiasing);
-    cairo_surface_destroy(s);
+private:
+    struct Stripe
+    {
+        std::vector<guchar const *> rows;
+        guchar const *data = nullptr;
+    };
 
-    // PNG stores data as unpremultiplied big-endian RGBA, which means
-    // it's identical to the GdkPixbuf format.
-    convert_pixels_argb32_to_pixbuf(px, ebp->width, num_rows, stride);
-    
-    // If a custom bit depth or color type is asked, then convert rgb to grayscale, etc.
-    const guchar* new_data = pixbuf_to_png(rows, px, num_rows, ebp->width, stride, color_type, bit_depth);
-    *to_free = (void*) new_data;
-    free(px);
+    void run(Inkscape::Drawing *drawing)
+    {
+        while (true) {
+            int number;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cond.wait(lock, [this] {
+                    return _cancelled || _started == _total ||
+                           (!_paused && _started < _handed_out + _lookahead);
+                });
+                if (_cancelled || _started == _total) {
+                    return;
+                }
+                number = _started++;
+                ++_busy;
+            }
+
+            int row = (number % _stripes_per_pass) * _ebp.sheight;
+            Stripe stripe;
+            stripe.rows.resize(std::min<unsigned long>(_ebp.sheight, _ebp.height - row));
+            stripe.data = sp_export_render_rows(stripe.rows.data(), *drawing, _ebp, row, stripe.rows.size(),
+                                                _color_type, _bit_depth, _antialiasing);
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _done.emplace(number, std::move(stripe));
+                --_busy;
+            }
+            _cond.notify_all();
+        }
+    }
+
+    SPEBP const &_ebp;
+    int const _stripes_per_pass;
+    int const _total;
+    int const _lookahead;
+    int const _color_type;
+    int const _bit_depth;
+    int const _antialiasing;
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::map<int, Stripe> _done; ///< Rendered stripes not handed out yet.
+    int _started = 0;
+    int _handed_out = 0;
+    int _busy = 0;
+    bool _paused = false;
+    bool _cancelled = false;
+    std::vector<std::thread> _threads;
+};
+
+/**
+ *
+ */
+static int
+sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth, int antialiasing)
+{
+    struct SPEBP *ebp = (struct SPEBP *) data;
+
+    if (ebp->status && (!ebp->renderer || ebp->renderer->reportDue())) {
+        // The callback may run the main loop, which must not run alongside rendering.
+        if (ebp->renderer) {
+            ebp->renderer->pause();
+        }
+        bool go_on = ebp->status((float) row / ebp->height, ebp->data);
+        if (ebp->renderer) {
+            ebp->renderer->resume();
+        }
+        if (!go_on) return 0;
+    }
+
+    // Waiting for the rendering threads counts as rendering too.
+    Inkscape::Debug::PhaseTracker tracker("rendering");
+
+    if (ebp->renderer) {
+        return ebp->renderer->next(rows, to_free);
+    }
+
+    num_rows = MIN(num_rows, static_cast<int>(ebp->sheight));
+    num_rows = MIN(num_rows, static_cast<int>(ebp->height - row));
+
+    *to_free = (void *) sp_export_render_rows(rows, *ebp->drawing, *ebp, row, num_rows, color_type, bit_depth, antialiasing);
 
     return num_rows;
 }
 
 /**
- * Hide all items that are not listed in list, recursively, skipping groups and defs.
+ * Hide all items that are not listed in list, recursively, skipping groups and defs. The
+ * hidden drawing items are added to hidden, for showing them again.
  */
-static void hide_other_items_recursively(SPObject *o, const std::vector<SPItem*> &list, unsigned dkey)
+static void hide_other_items_recursively(SPObject *o, const std::vector<SPItem*> &list, unsigned dkey,
+                                         std::vector<Inkscape::DrawingItem *> &hidden)
 {
     if ( SP_IS_ITEM(o)
          && !SP_IS_DEFS(o)
@@ -381,18 +584,207 @@ static void hide_other_items_recursively(SPObject *o, const std::vector<SPItem*>
          && !SP_IS_GROUP(o)
          && list.end()==find(list.begin(),list.end(),o))
     {
-        SP_ITEM(o)->invoke_hide(dkey);
+        Inkscape::DrawingItem *ai = SP_ITEM(o)->get_arenaitem(dkey);
+        if (ai && ai->visible()) {
+            ai->setVisible(false);
+            hidden.push_back(ai);
+        }
     }
 
     // recurse
     if (list.end()==find(list.begin(),list.end(),o)) {
         for (auto& child: o->children) {
-            hide_other_items_recursively(&child, list, dkey);
+            hide_other_items_recursively(&child, list, dkey, hidden);
         }
     }
 }
 
 
+/**
+ * A document shown for export on one drawing per rendering thread. Any number of areas,
+ * sizes and sets of items can be rendered from it without showing the document again.
+ */
+class ExportDrawings
+{
+public:
+    ExportDrawings(SPDocument *doc, int count)
+        : _doc(doc)
+    {
+        for (int i = 0; i < count; ++i) {
+            auto drawing = std::make_unique<Inkscape::Drawing>();
+            drawing->setExact(true); // export with maximum blur rendering quality
+            unsigned const dkey = SPItem::display_key_new(1);
+            drawing->setRoot(doc->getRoot()->invoke_show(*drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+            _drawings.push_back(std::move(drawing));
+            _dkeys.push_back(dkey);
+        }
+    }
+
+    ~ExportDrawings()
+    {
+        // Hide items, this releases arenaitem
+        for (auto dkey : _dkeys) {
+            _doc->getRoot()->invoke_hide(dkey);
+        }
+    }
+
+    ExportDrawings(ExportDrawings const &) = delete;
+    ExportDrawings &operator=(ExportDrawings const &) = delete;
+
+    std::vector<Inkscape::Drawing *> drawings() const
+    {
+        std::vector<Inkscape::Drawing *> drawings;
+        for (auto &drawing : _drawings) {
+            drawings.push_back(drawing.get());
+        }
+        return drawings;
+    }
+
+    /**
+     * Sets up all drawings to render with the given transform, showing only items_only unless
+     * it is empty.
+     */
+    void prepare(Geom::Affine const &affine, const std::vector<SPItem*> &items_only)
+    {
+        for (auto item : _hidden) {
+            item->setVisible(true);
+        }
+        _hidden.clear();
+
+        for (size_t i = 0; i < _drawings.size(); ++i) {
+            // We show all and then hide all items we don't want, instead of showing only requested items,
+            // because that would not work if the shown item references something in defs
+            if (!items_only.empty()) {
+                hide_other_items_recursively(_doc->getRoot(), items_only, _dkeys[i], _hidden);
+            }
+            _drawings[i]->root()->setTransform(affine);
+            // Bounding boxes of groups depend on which children are visible.
+            _drawings[i]->update(Geom::IntRect::infinite(), Inkscape::DrawingItem::STATE_ALL,
+                                 Inkscape::DrawingItem::STATE_ALL);
+        }
+    }
+
+private:
+    SPDocument *_doc;
+    std::vector<std::unique_ptr<Inkscape::Drawing>> _drawings;
+    std::vector<unsigned> _dkeys;
+    std::vector<Inkscape::DrawingItem *> _hidden;
+};
+
+/**
+ * Checks whether drawings of the subtree can be rendered on several threads at once, and
+ * does the work rendering would otherwise do lazily on shared objects: gradient vectors are
+ * built and images converted here. Patterns, feImage and SVG fonts show or read objects
+ * while rendering, so documents using them are rendered on one thread.
+ */
+static bool prepare_threaded_rendering(SPObject *o)
+{
+    if (SP_IS_PATTERN(o) || SP_IS_FEIMAGE(o) || SP_IS_FONT(o)) {
+        return false;
+    }
+    if (auto mesh = dynamic_cast<SPMeshGradient *>(o)) {
+        if (mesh->type_set && mesh->type == SP_MESH_TYPE_BICUBIC) {
+            return false;
+        }
+        mesh->ensureArray();
+    } else if (auto gradient = dynamic_cast<SPGradient *>(o)) {
+        gradient->ensureVector();
+    } else if (auto image = dynamic_cast<SPImage *>(o)) {
+        if (image->pixbuf) {
+            image->pixbuf->getSurfaceRaw();
+        }
+    }
+
+    for (auto &child : o->children) {
+        if (!prepare_threaded_rendering(&child)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Checks whether any item in the subtree has a filter, including items in defs that are drawn
+ * through clones, markers or patterns.
+ */
+static bool has_filtered_items(SPObject *o)
+{
+    auto item = dynamic_cast<SPItem *>(o);
+    if (item && item->isFiltered()) {
+        return true;
+    }
+    for (auto &child : o->children) {
+        if (has_filtered_items(&child)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int export_threads()
+{
+#if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    return prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    return 1;
+#endif
+}
+
+int sp_export_rendering_threads(SPDocument *doc, int max_threads)
+{
+    int threads = std::min(export_threads(), max_threads);
+    if (threads <= 1 || !prepare_threaded_rendering(doc->getRoot())) {
+        return 1;
+    }
+
+    // Rendering reads these; reading them once here caches them, so that the threads
+    // only look them up.
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    for (auto path : {"/options/rendering/imageinoutlinemode", "/options/threading/numthreads",
+                      "/options/filterquality/value", "/options/blurquality/value"}) {
+        prefs->getEntry(path);
+    }
+    return threads;
+}
+
+/**
+ * Chooses the stripe height, tile width and number of rendering threads of an export, so that
+ * its buffers stay within the "/options/export/memorylimit" preference, in MiB (0 for no
+ * limit). Only threads is lowered, never raised.
+ *
+ * Rows of filtered drawings are not split into tiles: a filter such as a blur reads pixels
+ * around the area being rendered, and its result at the edges of a tile is not known to match
+ * that of the whole row.
+ */
+static void plan_export_memory(unsigned long width, int bit_depth, bool filtered, int &threads,
+                               unsigned long &sheight, unsigned long &tile_width)
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    size_t const limit = static_cast<size_t>(prefs->getIntLimited("/options/export/memorylimit", 256, 0, 65536)) << 20;
+
+    sheight = 64;
+    tile_width = 0;
+    if (!limit) {
+        return;
+    }
+
+    // A stripe is rendered to ARGB and then converted to the PNG format.
+    size_t const bytes_per_row = width * (bit_depth == 16 ? 12 : 8);
+    while (true) {
+        // The stripe renderer keeps up to two stripes per thread, and one is being encoded.
+        size_t share = limit / (threads > 1 ? 2 * threads + 1 : 1);
+        // Three quarters for the stripe, the rest for intermediate surfaces while rendering it.
+        sheight = std::clamp<size_t>(share * 3 / 4 / bytes_per_row, 1, 64);
+        if (sheight >= 16 || threads == 1) {
+            size_t tile = share / 4 / (4 * sheight);
+            tile_width = tile < width && !filtered ? std::max<size_t>(tile, 256) : 0;
+            return;
+        }
+        --threads;
+    }
+}
+
 ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 double x0, double y0, double x1, double y1,
                                 unsigned long int width, unsigned long int height, double xdpi, double ydpi,
@@ -418,22 +810,31 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 void *data, bool force_overwrite,
                                 const std::vector<SPItem*> &items_only, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing)
 {
-    g_return_val_if_fail(doc != nullptr, EXPORT_ERROR);
     g_return_val_if_fail(filename != nullptr, EXPORT_ERROR);
-    g_return_val_if_fail(width >= 1, EXPORT_ERROR);
-    g_return_val_if_fail(height >= 1, EXPORT_ERROR);
-    g_return_val_if_fail(!area.hasZeroArea(), EXPORT_ERROR);
-
-
-    if (!force_overwrite && !sp_ui_overwrite_file(filename)) {
-        // aborted overwrite
-	return EXPORT_ABORTED;
-    }
 
-    doc->ensureUpToDate();
+    SPPngExportJob job;
+    job.filename = filename;
+    job.area = area;
+    job.width = width;
+    job.height = height;
+    job.xdpi = xdpi;
+    job.ydpi = ydpi;
+    job.items_only = items_only;
+    job.color_type = color_type;
+    job.bit_depth = bit_depth;
+
+    return sp_export_png_files(doc, {job}, bgcolor, status, data, force_overwrite, interlace, zlib, antialiasing)[0];
+}
 
+/**
+ * Exports one job from drawings that are already showing the document.
+ */
+static bool sp_export_png_job(SPDocument *doc, ExportDrawings &drawings, SPPngExportJob const &job,
+                              unsigned long bgcolor, unsigned (*status)(float, void *), void *data,
+                              bool threaded, bool filtered, bool interlace, int zlib, int antialiasing)
+{
     /* Calculate translation by transforming to document coordinates (flipping Y)*/
-    Geom::Point translation = -area.min();
+    Geom::Point translation = -job.area.min();
 
     /*  This calculation is only valid when assumed that (x0,y0)= area.corner(0) and (x1,y1) = area.corner(2)
      * 1) a[0] * x0 + a[2] * y1 + a[4] = 0.0
@@ -452,47 +853,93 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
      */
 
     Geom::Affine const affine(Geom::Translate(translation)
-                            * Geom::Scale(width / area.width(),
-                                        height / area.height()));
+                            * Geom::Scale(job.width / job.area.width(),
+                                        job.height / job.area.height()));
+
+    {
+        Inkscape::Debug::PhaseTracker tracker("rendering");
+        drawings.prepare(affine, job.items_only);
+    }
+    std::vector<Inkscape::Drawing *> thread_drawings = drawings.drawings();
 
     struct SPEBP ebp;
-    ebp.width  = width;
-    ebp.height = height;
+    ebp.width  = job.width;
+    ebp.height = job.height;
     ebp.background = bgcolor;
+    ebp.drawing = thread_drawings[0];
 
-    /* Create new drawing */
-    Inkscape::Drawing drawing;
-    drawing.setExact(true); // export with maximum blur rendering quality
-    unsigned const dkey = SPItem::display_key_new(1);
+    ebp.status = status;
+    ebp.data   = data;
+    ebp.renderer = nullptr;
+
+    int threads = threaded ? thread_drawings.size() : 1;
+    plan_export_memory(job.width, job.bit_depth, filtered, threads, ebp.sheight, ebp.tile_width);
+
+    // Render stripes on other threads while this one encodes.
+    threads = std::min<unsigned long>(threads, (job.height + ebp.sheight - 1) / ebp.sheight);
+    std::unique_ptr<StripeRenderer> renderer;
+    if (threads > 1) {
+        thread_drawings.resize(threads);
+        // Interlaced images are written in the 7 passes of Adam7.
+        renderer = std::make_unique<StripeRenderer>(thread_drawings, ebp, interlace ? 7 : 1, job.color_type,
+                                                    job.bit_depth, antialiasing);
+        ebp.renderer = renderer.get();
+    }
 
-    // Create ArenaItems and set transform
-    drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
-    drawing.root()->setTransform(affine);
-    ebp.drawing = &drawing;
+    // Writing the file is encoding, apart from waiting for the rows. Not timed within
+    // sp_png_write_rgba_striped(), which libpng errors leave with longjmp().
+    Inkscape::Debug::PhaseTracker tracker("encoding");
+    return sp_png_write_rgba_striped(doc, job.filename.c_str(), job.width, job.height, job.xdpi, job.ydpi,
+                                     sp_export_get_rows, &ebp, interlace, job.color_type, job.bit_depth, zlib,
+                                     antialiasing);
+}
 
-    // We show all and then hide all items we don't want, instead of showing only requested items,
-    // because that would not work if the shown item references something in defs
-    if (!items_only.empty()) {
-        hide_other_items_recursively(doc->getRoot(), items_only, dkey);
+std::vector<ExportResult> sp_export_png_files(SPDocument *doc, std::vector<SPPngExportJob> const &jobs,
+                                              unsigned long bgcolor, unsigned (*status)(float, void *),
+                                              void *data, bool force_overwrite, bool interlace, int zlib,
+                                              int antialiasing)
+{
+    std::vector<ExportResult> results(jobs.size(), EXPORT_ERROR);
+    g_return_val_if_fail(doc != nullptr, results);
+
+    std::vector<size_t> todo;
+    unsigned long max_height = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        auto const &job = jobs[i];
+        g_return_val_if_fail(job.width >= 1, results);
+        g_return_val_if_fail(job.height >= 1, results);
+        g_return_val_if_fail(!job.area.hasZeroArea(), results);
+
+        if (!force_overwrite && !sp_ui_overwrite_file(job.filename.c_str())) {
+            // aborted overwrite
+            results[i] = EXPORT_ABORTED;
+            continue;
+        }
+        todo.push_back(i);
+        max_height = std::max(max_height, job.height);
+    }
+    if (todo.empty()) {
+        return results;
     }
 
-    ebp.status = status;
-    ebp.data   = data;
-
-    bool write_status = false;;
+    doc->ensureUpToDate();
 
-    ebp.sheight = 64;
-    ebp.px = g_try_new(guchar, 4 * ebp.sheight * width);
+    // Every rendering thread needs a drawing of its own, so this costs memory for each extra
+    // thread.
+    int threads = sp_export_rendering_threads(doc, (max_height + 63) / 64);
+    bool threaded = threads > 1;
 
-    if (ebp.px) {
-        write_status = sp_png_write_rgba_striped(doc, filename, width, height, xdpi, ydpi, sp_export_get_rows, &ebp, interlace, color_type, bit_depth, zlib, antialiasing);
-        g_free(ebp.px);
-    }
+    bool filtered = has_filtered_items(doc->getRoot());
 
-    // Hide items, this releases arenaitem
-    doc->getRoot()->invoke_hide(dkey);
+    /* Show the document once for all jobs */
+    ExportDrawings drawings(doc, threaded ? threads : 1);
 
-    return write_status ? EXPORT_OK : EXPORT_ERROR;
+    for (auto i : todo) {
+        bool ok = sp_export_png_job(doc, drawings, jobs[i], bgcolor, status, data, threaded, filtered, interlace,
+                                    zlib, antialiasing);
+        results[i] = ok ? EXPORT_OK : EXPORT_ERROR;
+    }
+    return results;
 }
 
 
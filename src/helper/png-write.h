@@ -16,9 +16,11 @@
  */
 
 #include <glib.h> // Only for gchar.
+#include <string>
 #include <vector>
 
 #include <2geom/forward.h>
+#include <2geom/rect.h>
 
 class SPDocument;
 class SPItem;
@@ -48,4 +50,39 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false, const std::vector<SPItem*> &items_only = std::vector<SPItem*>(), 
                                 bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2);
 
+/**
+ * One PNG file to export with sp_export_png_files().
+ */
+struct SPPngExportJob {
+    std::string filename;
+    Geom::Rect area; ///< Area in document coordinates
+    unsigned long int width = 0;
+    unsigned long int height = 0;
+    double xdpi = 0;
+    double ydpi = 0;
+    std::vector<SPItem*> items_only; ///< If not empty, all other items are hidden
+    int color_type = 6;
+    int bit_depth = 8;
+};
+
+/**
+ * Export several areas of a document, each to its own PNG file. The document is shown for
+ * rendering only once for all of them, which is much faster than calling sp_export_png_file()
+ * for each file, e.g. for exporting many objects, or one object at several resolutions.
+ *
+ * @return The result of each job, as for sp_export_png_file().
+ */
+std::vector<ExportResult> sp_export_png_files(SPDocument *doc, std::vector<SPPngExportJob> const &jobs,
+                                              unsigned long bgcolor,
+                                              unsigned int (*status) (float, void *) = nullptr, void *data = nullptr,
+                                              bool force_overwrite = false, bool interlace = false, int zlib = 6,
+                                              int antialiasing = 2);
+
+/**
+ * Returns on how many threads, at most max_threads, the document can be rendered at once,
+ * each to a drawing of its own, and prepares the document for that. Documents using features
+ * that are not safe for threads are rendered on one thread.
+ */
+int sp_export_rendering_threads(SPDocument *doc, int max_threads);
+
 #endif // SEEN_SP_PNG_WRITE_H
@@ -10,7 +10,9 @@
 
 #include <iostream>
 #include <iomanip>
+#include <deque>
 #include <cerrno>  // History file
+#include <csignal>
 #include <regex>
 #include <numeric>
 
@@ -32,10 +34,12 @@
 
 #include "inkgc/gc-core.h"        // Garbage Collecting init
 #include "debug/logger.h"         // INKSCAPE_DEBUG_LOG support
+#include "debug/timing-report.h"  // --timing-report
 
 #include "io/file.h"              // File open (command line).
 #include "io/resource.h"          // TEMPLATE
 #include "io/resource-manager.h"  // Fix up references.
+#include "io/sys.h"               // Batch export workers
 
 #include "object/sp-root.h"       // Inkscape version.
 
@@ -70,6 +74,12 @@
 #include "helper/gettext.h"   // gettext init
 #endif // ENABLE_NLS
 
+#ifdef _WIN32
+#include <io.h>                   // Batch export, dup()
+#else
+#include <unistd.h>
+#endif
+
 #ifdef WITH_GNU_READLINE
 #include <readline/readline.h>
 #include <readline/history.h>
@@ -543,6 +553,9 @@ InkscapeApplication::_start_main_option_section(const Glib::ustring& section_nam
 
 InkscapeApplication::InkscapeApplication()
 {
+    // Start of the run, counted as startup by --timing-report
+    Inkscape::Debug::TimingReport::init();
+
     using T = Gio::Application;
 
     auto app_id = "org.inkscape.Inkscape";
@@ -622,6 +635,8 @@ InkscapeApplication::InkscapeApplication()
     _start_main_option_section(_("File import"));
     gapp->add_main_option_entry(T::OPTION_TYPE_BOOL,     "pipe",                    'p', N_("Read input file from standard input (stdin)"),                             "");
     gapp->add_main_option_entry(T::OPTION_TYPE_INT,      "pdf-page",               '\0', N_("PDF page number to import"),                                       N_("PAGE"));
+    gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "pdf-pages",              '\0', N_("PDF pages to import, each as a layer, e.g. 1-3,7 or all"),         N_("PAGES"));
+    gapp->add_main_option_entry(T::OPTION_TYPE_INT,      "pdf-jobs",               '\0', N_("Number of processes importing PDF pages at once; default is the number of threads"), N_("JOBS"));
     gapp->add_main_option_entry(T::OPTION_TYPE_BOOL,     "pdf-poppler",            '\0', N_("Use poppler when importing via commandline"),                              "");
     gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "convert-dpi-method",     '\0', N_("Method used to convert pre-0.92 document dpi, if needed: [none|scale-viewbox|scale-document]"), N_("METHOD"));
     gapp->add_main_option_entry(T::OPTION_TYPE_BOOL,     "no-convert-text-baseline-spacing", '\0', N_("Do not fix pre-0.92 document's text baseline spacing on opening"), "");
@@ -658,6 +673,9 @@ InkscapeApplication::InkscapeApplication()
     gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "export-background",      'b', N_("Background color for exported bitmaps (any SVG color string)"),         N_("COLOR")); // Bxx
     gapp->add_main_option_entry(T::OPTION_TYPE_DOUBLE,   "export-background-opacity", 'y', N_("Background opacity for exported bitmaps (0.0 to 1.0, or 1 to 255)"), N_("VALUE")); // Bxx
     gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "export-png-color-mode", '\0', N_("Color mode (bit depth and color type) for exported bitmaps (Gray_1/Gray_2/Gray_4/Gray_8/Gray_16/RGB_8/RGB_16/GrayAlpha_8/GrayAlpha_16/RGBA_8/RGBA_16)"), N_("COLOR-MODE")); // Bxx
+    gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "export-png-scales",     '\0', N_("Export bitmaps at several scales in one pass, e.g. '1;2;3'; other scales than 1 add '@2x' etc. to the file name"), N_("SCALE[;SCALE]*")); // Bxx
+    gapp->add_main_option_entry(T::OPTION_TYPE_FILENAME, "batch-export",          '\0', N_("Export the files listed in a manifest, one job per line of the form [--export-OPTION[=VALUE]]* FILENAME; use '-' to read jobs from stdin"), N_("MANIFEST"));
+    gapp->add_main_option_entry(T::OPTION_TYPE_INT,      "batch-jobs",            '\0', N_("Number of batch export jobs to run at once; default is the number of processors"), N_("JOBS"));
 
     // Query - Geometry
     _start_main_option_section(_("Query object/document geometry"));
@@ -672,6 +690,7 @@ InkscapeApplication::InkscapeApplication()
     _start_main_option_section(_("Advanced file processing"));
     gapp->add_main_option_entry(T::OPTION_TYPE_BOOL,     "vacuum-defs",           '\0', N_("Remove unused definitions from the <defs> section(s) of document"),        "");
     gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "select",                '\0', N_("Select objects: comma-separated list of IDs"),   N_("OBJECT-ID[,OBJECT-ID]*"));
+    gapp->add_main_option_entry(T::OPTION_TYPE_STRING,   "timing-report",         '\0', N_("Print the time spent in each phase of processing every document to stderr: [text|json]"), N_("FORMAT"));
 
     // Actions
     _start_main_option_section();
@@ -715,6 +734,7 @@ InkscapeApplication::on_startup2()
 {
     // This should be completely rewritten.
     Inkscape::Application::create(_with_gui);
+    Inkscape::Debug::TimingReport::finishStartup();
 
     if (!_with_gui) {
         return;
@@ -904,6 +924,16 @@ InkscapeApplication::destroy_all()
     }
 }
 
+/** The name of a document in the timing report: its file, if it has one.
+ */
+static std::string document_report_name(SPDocument *document)
+{
+    if (char const *uri = document->getDocumentURI()) {
+        return uri;
+    }
+    return document->getDocumentName() ? document->getDocumentName() : "";
+}
+
 /** Common processing for documents
  */
 void
@@ -945,6 +975,8 @@ InkscapeApplication::process_document(SPDocument* document, std::string output_p
         // Save... can't use action yet.
         _file_export.do_export(document, output_path);
     }
+
+    Inkscape::Debug::TimingReport::write(std::cerr, document_report_name(document));
 }
 
 
@@ -954,6 +986,11 @@ InkscapeApplication::on_activate()
 {
     on_startup2();
 
+    if (!_batch_manifest.empty()) {
+        batch_export();
+        return;
+    }
+
     std::string output;
 
     // Create new document, either from pipe or from template.
@@ -1003,6 +1040,18 @@ InkscapeApplication::on_open(const Gio::Application::type_vec_files& files, cons
         INKSCAPE.set_pdf_poppler(_pdf_poppler);
     if(_pdf_page)
         INKSCAPE.set_pdf_page(_pdf_page);
+    if (!_pdf_pages.empty())
+        INKSCAPE.set_pdf_pages(_pdf_pages);
+    if (_pdf_jobs)
+        INKSCAPE.set_pdf_jobs(_pdf_jobs);
+
+    if (!_batch_manifest.empty()) {
+        std::cerr << "InkscapeApplication::on_open: "
+                     "Input files can't be given together with '--batch-export'. "
+                     "Please list them in the manifest instead."
+                  << std::endl;
+        return;
+    }
 
     if (files.size() > 1 && !_file_export.export_filename.empty()) {
         std::cerr << "ConcreteInkscapeApplication<Gtk::Application>::on_open: "
@@ -1240,6 +1289,322 @@ InkscapeApplication::shell()
 }
 
 
+/** Opens one batch export job's document and exports it, returns 0 on success. Anything the
+ *  export writes to stdout goes to stderr, as stdout is kept for the report.
+ */
+int
+InkscapeApplication::batch_export_job(InkFileExportCmd &export_cmd, std::string const &input)
+{
+    std::cout.flush();
+    fflush(stdout);
+    int report_fd = dup(fileno(stdout));
+    dup2(fileno(stderr), fileno(stdout));
+
+    int status = 1;
+    if (SPDocument *document = document_open(Gio::File::create_for_path(input))) {
+        INKSCAPE.add_document(document);
+        document->ensureUpToDate();
+
+        status = export_cmd.do_export(document, input);
+        Inkscape::Debug::TimingReport::write(std::cerr, input);
+
+        INKSCAPE.remove_document(document);
+        document_close(document);
+    }
+
+    std::cout.flush();
+    fflush(stdout);
+    if (report_fd != -1) {
+        dup2(report_fd, fileno(stdout));
+        close(report_fd);
+    }
+    return status;
+}
+
+static std::string batch_json_string(std::string const &value)
+{
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            g_snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+static void batch_report(int line, std::string const &input, char const *status, gint64 start)
+{
+    std::cout << "{\"line\":" << line << ",\"input\":" << batch_json_string(input)
+              << ",\"status\":\"" << status << "\",\"seconds\":" << std::fixed << std::setprecision(3)
+              << (g_get_monotonic_time() - start) / 1e6 << "}" << std::endl;
+}
+
+/** Reads the options and the input file of one line of a batch export manifest into export_cmd
+ *  and input, returns false if the line is not a valid job.
+ */
+static bool batch_parse_job(std::string const &text, int line, InkFileExportCmd &export_cmd, std::string &input)
+{
+    gchar **argv = nullptr;
+    if (!g_shell_parse_argv(text.c_str(), nullptr, &argv, nullptr)) {
+        std::cerr << "InkscapeApplication::batch_export: Can't parse line " << line << std::endl;
+        return false;
+    }
+
+    bool valid = true;
+    for (gchar **arg = argv; *arg; ++arg) {
+        std::string word = *arg;
+        if (word.compare(0, 2, "--") == 0) {
+            auto equals = word.find('=');
+            std::string name = word.substr(2, equals == std::string::npos ? std::string::npos : equals - 2);
+            std::string value = equals == std::string::npos ? "" : word.substr(equals + 1);
+            if (!export_cmd.set_option(name, value)) {
+                std::cerr << "InkscapeApplication::batch_export: Invalid option on line " << line
+                          << ": " << word << std::endl;
+                valid = false;
+            }
+        } else if (input.empty()) {
+            input = word;
+        } else {
+            std::cerr << "InkscapeApplication::batch_export: More than one input file on line " << line
+                      << std::endl;
+            valid = false;
+        }
+    }
+    g_strfreev(argv);
+    return valid && !input.empty();
+}
+
+/*
+ * Batch export: runs the export jobs listed in a manifest, one per line, e.g.
+ *   --export-type=png --export-dpi=300 drawing.svg
+ * The export options given on the command line apply to every job. Reports one line of JSON
+ * per finished job on stdout.
+ *
+ * Documents are not thread safe, so with more than one job at a time the jobs run in worker
+ * processes. Each worker is this program run with '--batch-export=- --batch-jobs=1', which is
+ * handed one job line at a time on its stdin and reports it on its stdout. Workers stay up for
+ * further jobs, so that fonts and extensions are only loaded once per worker. They are spawned
+ * rather than forked, as this process may already run GLib threads.
+ *
+ * The manifest is read as the jobs run, so that the jobs may be fed through a pipe by a long
+ * running producer. It is read without blocking, so a producer that waits for the report of a
+ * job before sending the next one is answered right away.
+ */
+void
+InkscapeApplication::batch_export()
+{
+    // The manifest is watched along with the workers, so that their reports go out while the
+    // next line is still on its way.
+    Glib::RefPtr<Glib::IOChannel> manifest;
+    try {
+        if (_batch_manifest == "-") {
+            manifest = Glib::IOChannel::create_from_fd(fileno(stdin));
+        } else {
+            manifest = Glib::IOChannel::create_from_file(_batch_manifest, "r");
+        }
+        manifest->set_encoding();
+        manifest->set_flags(Glib::IO_FLAG_NONBLOCK);
+    } catch (Glib::Error const &error) {
+        std::cerr << "InkscapeApplication::batch_export: Can't open " << _batch_manifest << ": "
+                  << error.what() << std::endl;
+        return;
+    }
+
+    int max_jobs = _batch_jobs > 0 ? _batch_jobs : g_get_num_processors();
+#ifndef _WIN32
+    // A worker that died is noticed by its output, not by writing to it.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    // Each worker starts from the options given on the command line.
+    std::vector<std::string> worker_arguments;
+    if (max_jobs > 1) {
+        worker_arguments = {"--batch-export=-", "--batch-jobs=1"};
+        for (auto const &argument : _file_export.get_arguments()) {
+            worker_arguments.push_back(argument);
+        }
+        if (Inkscape::Debug::TimingReport::enabled()) {
+            worker_arguments.emplace_back(Inkscape::Debug::TimingReport::format() == Inkscape::Debug::TimingReport::JSON
+                                              ? "--timing-report=json"
+                                              : "--timing-report=text");
+        }
+    }
+
+    struct Worker
+    {
+        Glib::RefPtr<Glib::IOChannel> in;
+        Glib::RefPtr<Glib::IOChannel> out;
+        sigc::connection connection;
+        bool busy = false;
+        bool dead = false;
+        int line = 0;
+        std::string input;
+        gint64 start = 0;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    auto context = Glib::MainContext::create();
+    int running = 0;
+    int failed = 0;
+
+    auto finish_job = [&](Worker &worker, bool ok) {
+        failed += ok ? 0 : 1;
+        batch_report(worker.line, worker.input, ok ? "ok" : "failed", worker.start);
+        worker.busy = false;
+        --running;
+    };
+
+    auto on_worker_output = [&](Glib::IOCondition condition, Worker *worker) {
+        Glib::ustring result;
+        try {
+            if ((condition & Glib::IO_IN) && worker->out->read_line(result) == Glib::IO_STATUS_NORMAL) {
+                // Anything but the report of the job is passed on.
+                if (worker->busy && result.find("{\"line\":") == 0) {
+                    finish_job(*worker, result.find("\"status\":\"ok\"") != Glib::ustring::npos);
+                } else {
+                    std::cerr << result;
+                }
+                return true;
+            }
+        } catch (Glib::Error const &) {
+        }
+        // The worker is gone.
+        if (worker->busy) {
+            finish_job(*worker, false);
+        }
+        worker->dead = true;
+        return false;
+    };
+
+    auto idle_worker = [&]() -> Worker * {
+        for (auto &worker : workers) {
+            if (!worker->busy && !worker->dead) {
+                return worker.get();
+            }
+        }
+        if (worker_arguments.empty()) {
+            return nullptr;
+        }
+        auto worker = std::make_unique<Worker>();
+        int in_fd = -1;
+        int out_fd = -1;
+        if (!Inkscape::IO::spawn_worker(worker_arguments, nullptr, &in_fd, &out_fd)) {
+            worker_arguments.clear();
+            return nullptr;
+        }
+        worker->in = Glib::IOChannel::create_from_fd(in_fd);
+        worker->in->set_close_on_unref(true);
+        worker->in->set_encoding();
+        worker->out = Glib::IOChannel::create_from_fd(out_fd);
+        worker->out->set_close_on_unref(true);
+        worker->out->set_encoding();
+        worker->connection = context->signal_io().connect(
+            [&on_worker_output, w = worker.get()](Glib::IOCondition condition) { return on_worker_output(condition, w); },
+            worker->out, Glib::IO_IN | Glib::IO_HUP | Glib::IO_ERR);
+        workers.push_back(std::move(worker));
+        return workers.back().get();
+    };
+
+    std::deque<std::string> lines;
+    bool more = true;
+    sigc::connection manifest_watch;
+    auto on_manifest_input = [&](Glib::IOCondition) {
+        Glib::ustring text;
+        try {
+            switch (manifest->read_line(text)) {
+                case Glib::IO_STATUS_NORMAL:
+                    lines.push_back(text.raw());
+                    if (!lines.back().empty() && lines.back().back() == '\n') {
+                        lines.back().pop_back();
+                    }
+                    return true;
+                case Glib::IO_STATUS_AGAIN:
+                    return true; // Only part of a line so far.
+                default:
+                    break;
+            }
+        } catch (Glib::Error const &error) {
+            std::cerr << "InkscapeApplication::batch_export: Can't read " << _batch_manifest << ": "
+                      << error.what() << std::endl;
+        }
+        more = false;
+        return false;
+    };
+
+    int line = 0;
+    while (true) {
+        while (!lines.empty() && running < max_jobs) {
+            std::string text = std::move(lines.front());
+            lines.pop_front();
+            ++line;
+            auto first = text.find_first_not_of(" \t\r");
+            if (first == std::string::npos || text[first] == '#') {
+                continue; // Blank line or comment.
+            }
+
+            // Each job starts from the options given on the command line.
+            InkFileExportCmd export_cmd = _file_export;
+            std::string input;
+            if (!batch_parse_job(text, line, export_cmd, input)) {
+                batch_report(line, input, "invalid", g_get_monotonic_time());
+                ++failed;
+                continue;
+            }
+
+            gint64 start = g_get_monotonic_time();
+            Worker *worker = idle_worker();
+            if (worker) {
+                try {
+                    gsize written = 0;
+                    worker->in->write((text + "\n").c_str(), text.size() + 1, written);
+                    worker->in->flush();
+                    worker->busy = true;
+                    worker->line = line;
+                    worker->input = input;
+                    worker->start = start;
+                    ++running;
+                    continue;
+                } catch (Glib::Error const &) {
+                    worker->dead = true;
+                }
+            }
+            int status = batch_export_job(export_cmd, input);
+            failed += status ? 1 : 0;
+            batch_report(line, input, status ? "failed" : "ok", start);
+        }
+        if (!more && lines.empty() && running == 0) {
+            break;
+        }
+
+        // Only read ahead when there is room for another job.
+        bool want_line = more && lines.empty() && running < max_jobs;
+        if (want_line && !manifest_watch.connected()) {
+            manifest_watch = context->signal_io().connect(on_manifest_input, manifest,
+                                                          Glib::IO_IN | Glib::IO_HUP | Glib::IO_ERR);
+        } else if (!want_line && manifest_watch.connected()) {
+            manifest_watch.disconnect();
+        }
+        context->iteration(true);
+    }
+    manifest_watch.disconnect();
+
+    // Closing their stdin ends the workers.
+    for (auto &worker : workers) {
+        worker->connection.disconnect();
+    }
+    workers.clear();
+
+    if (failed) {
+        std::cerr << "InkscapeApplication::batch_export: " << failed << " job(s) failed." << std::endl;
+    }
+}
+
 // ========================= Callbacks ==========================
 
 /*
@@ -1322,6 +1687,7 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
         options->contains("export-background")     ||
         options->contains("export-background-opacity") ||
         options->contains("export-text-to_path")   ||
+        options->contains("export-png-scales")     ||
 
         options->contains("query-id")              ||
         options->contains("query-x")               ||
@@ -1334,7 +1700,10 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
         options->contains("select")                ||
         options->contains("actions")               ||
         options->contains("verb")                  ||
-        options->contains("shell")
+        options->contains("shell")                 ||
+
+        options->contains("batch-export")          ||
+        options->contains("batch-jobs")
         ) {
         _with_gui = false;
     }
@@ -1379,6 +1748,14 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
         options->lookup_value("pdf-page", page);
         _pdf_page = page;
     }
+    if (options->contains("pdf-pages")) {
+        Glib::ustring pages;
+        options->lookup_value("pdf-pages", pages);
+        _pdf_pages = pages;
+    }
+    if (options->contains("pdf-jobs")) {
+        options->lookup_value("pdf-jobs", _pdf_jobs);
+    }
 
     if (options->contains("convert-dpi-method")) {
         Glib::ustring method;
@@ -1437,77 +1814,43 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
 
 
     // ==================== EXPORT =====================
-    if (options->contains("export-filename")) {
-        options->lookup_value("export-filename",  _file_export.export_filename);
-    }
-
-    if (options->contains("export-type")) {
-        options->lookup_value("export-type",      _file_export.export_type);
-    }
-    if (options->contains("export-extension")) {
-        options->lookup_value("export-extension", _file_export.export_extension);
-        _file_export.export_extension = _file_export.export_extension.lowercase();
-    }
-
-    if (options->contains("export-overwrite"))    _file_export.export_overwrite    = true;
-
-    // Export - Geometry
-    if (options->contains("export-area")) {
-        options->lookup_value("export-area",      _file_export.export_area);
-    }
-
-    if (options->contains("export-area-drawing")) _file_export.export_area_drawing = true;
-    if (options->contains("export-area-page"))    _file_export.export_area_page    = true;
-
-    if (options->contains("export-margin")) {
-        options->lookup_value("export-margin",    _file_export.export_margin);
-    }
-
-    if (options->contains("export-area-snap"))    _file_export.export_area_snap    = true;
-
-    if (options->contains("export-width")) {
-        options->lookup_value("export-width",     _file_export.export_width);
-    }
-
-    if (options->contains("export-height")) {
-        options->lookup_value("export-height",    _file_export.export_height);
-    }
-
-    // Export - Options
-    if (options->contains("export-id")) {
-        options->lookup_value("export-id",        _file_export.export_id);
-    }
-
-    if (options->contains("export-id-only"))      _file_export.export_id_only     = true;
-    if (options->contains("export-plain-svg"))    _file_export.export_plain_svg      = true;
-
-    if (options->contains("export-dpi")) {
-        options->lookup_value("export-dpi",       _file_export.export_dpi);
+    for (auto const &option : InkFileExportCmd::options()) {
+        if (!options->contains(option.name)) {
+            continue;
+        }
+        if (option.flag) {
+            _file_export.*option.flag = true;
+        } else if (option.integer) {
+            options->lookup_value(option.name, _file_export.*option.integer);
+        } else if (option.number) {
+            options->lookup_value(option.name, _file_export.*option.number);
+        } else if (option.text) {
+            options->lookup_value(option.name, _file_export.*option.text);
+        } else {
+            options->lookup_value(option.name, _file_export.*option.filename);
+        }
     }
 
-    if (options->contains("export-ignore-filters")) _file_export.export_ignore_filters = true;
-    if (options->contains("export-text-to-path"))   _file_export.export_text_to_path   = true;
-
-    if (options->contains("export-ps-level")) {
-        options->lookup_value("export-ps-level",  _file_export.export_ps_level);
+    // Batch export, the options above are the defaults for each job.
+    if (options->contains("batch-export")) {
+        options->lookup_value("batch-export", _batch_manifest);
     }
-
-    if (options->contains("export-pdf-version")) {
-        options->lookup_value("export-pdf-version", _file_export.export_pdf_level);
+    if (options->contains("batch-jobs")) {
+        options->lookup_value("batch-jobs", _batch_jobs);
     }
 
-    if (options->contains("export-latex"))        _file_export.export_latex       = true;
-    if (options->contains("export-use-hints"))    _file_export.export_use_hints   = true;
 
-    if (options->contains("export-background")) {
-        options->lookup_value("export-background",_file_export.export_background);
-    }
+    // ==================== TIMING =====================
 
-    if (options->contains("export-background-opacity")) {
-        options->lookup_value("export-background-opacity", _file_export.export_background_opacity);
-    }
-    if (options->contains("export-png-color-mode")) {
-        options->lookup_value("export-png-color-mode", _file_export.export_png_color_mode);
+    if (options->contains("timing-report")) {
+        Glib::ustring format;
+        options->lookup_value("timing-report", format);
+        if (format != "text" && format != "json") {
+            std::cerr << "InkscapeApplication::on_handle_local_options: "
+                         "Unknown timing report format '" << format << "', using 'text'." << std::endl;
+        }
+        Inkscape::Debug::TimingReport::enable(format == "json" ? Inkscape::Debug::TimingReport::JSON
+                                                               : Inkscape::Debug::TimingReport::TEXT);
     }
 
 
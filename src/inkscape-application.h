@@ -130,7 +130,11 @@ protected:
     bool _use_pipe    = false;
     bool _auto_export = false;
     int _pdf_page     = 1;
+    std::string _pdf_pages;
+    int _pdf_jobs     = 0;        // Processes importing _pdf_pages, 0 for the number of threads.
     int _pdf_poppler  = false;
+    std::string _batch_manifest;  // Jobs for batch_export(), "-" for stdin.
+    int _batch_jobs   = 0;        // Number of jobs run at once, 0 for the number of processors.
     InkscapeApplication();
 
     // Documents are owned by the application which is responsible for opening/saving/exporting. WIP
@@ -158,6 +162,8 @@ protected:
 
     void on_about();
     void shell();
+    void batch_export();
+    int batch_export_job(InkFileExportCmd &export_cmd, std::string const &input);
 
     void _start_main_option_section(const Glib::ustring& section_name = "");
 };
@@ -41,6 +41,7 @@
 
 #include "debug/simple-event.h"
 #include "debug/event-tracker.h"
+#include "debug/timing-report.h"
 
 #include "extension/db.h"
 #include "extension/init.h"
@@ -266,9 +267,13 @@ Application::Application(bool use_gui) :
     }
 
     /* Initialize the extensions */
-    Inkscape::Extension::init();
+    {
+        Inkscape::Debug::PhaseTracker tracker("extensions");
+        Inkscape::Extension::init();
+    }
 
     /* Initialize font factory */
+    Inkscape::Debug::PhaseTracker tracker("fonts");
     font_factory *factory = font_factory::Default();
     if (prefs->getBool("/options/font/use_fontsdir_system", true)) {
         char const *fontsdir = get_path(SYSTEM, FONTS);
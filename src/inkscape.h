@@ -21,6 +21,7 @@
 #include <gtkmm/cssprovider.h>
 #include <map>
 #include <sigc++/signal.h>
+#include <string>
 #include <vector>
 
 class SPDesktop;
@@ -195,6 +196,18 @@ public:
     gint get_pdf_page() {
         return _pdf_page;
     }
+    void set_pdf_pages(std::string const &pages) {
+        _pdf_pages = pages;
+    }
+    std::string const &get_pdf_pages() const {
+        return _pdf_pages;
+    }
+    void set_pdf_jobs(int jobs) {
+        _pdf_jobs = jobs;
+    }
+    int get_pdf_jobs() const {
+        return _pdf_jobs;
+    }
 
     void add_gtk_css(bool only_providers);
     void add_icon_theme();
@@ -220,6 +233,8 @@ public:
     static bool _crashIsHappening;
     bool _use_gui = false;
     gint _pdf_page = 1;
+    std::string _pdf_pages; // Page range for non-interactive import, overrides _pdf_page
+    int _pdf_jobs = 0; // Processes importing _pdf_pages, 0 for the number of threads
     bool _pdf_poppler = false;
 };
 
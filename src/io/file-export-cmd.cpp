@@ -15,6 +15,8 @@
 
 #include "file-export-cmd.h"
 
+#include <sstream>
+
 #include <boost/algorithm/string.hpp>
 #include <png.h> // PNG export
 
@@ -67,9 +69,12 @@ InkFileExportCmd::InkFileExportCmd()
 {
 }
 
-void
+int
 InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
 {
+    // Extension IDs are matched in lower case.
+    export_extension = export_extension.lowercase();
+
     std::string export_type_filename;
     std::vector<Glib::ustring> export_type_list;
 
@@ -81,7 +86,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 std::cerr << "InkFileExportCmd::do_export: No export type specified. "
                           << "Append a supported file extension to filename provided with --export-filename or "
                           << "provide one or more extensions separately using --export-type" << std::endl;
-                return;
+                return 1;
             } else {
                 // no extension is fine if --export-type is given
                 // explicitly stated extensions are handled later
@@ -105,7 +110,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         if (export_id.empty() && !export_area_drawing) {
             std::cerr << "InkFileExportCmd::do_export: "
                       << "--export-use-hints can only be used with --export-id or --export-area-drawing." << std::endl;
-            return;
+            return 1;
         }
         if (export_type_list.size() > 1 || (export_type_list.size() == 1 && export_type_list[0] != "png")) {
             std::cerr << "InkFileExportCmd::do_export: --export-use-hints can only be used with PNG export! "
@@ -129,7 +134,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 std::cerr << "InkFileExportCmd::do_export: "
                           << "The supplied --export-extension was not found. Specify a file extension "
                           << "to get a list of available extensions for this file type.";
-                return;
+                return 1;
             }
         } else {
             export_type_list.emplace_back("svg"); // fall-back to SVG by default
@@ -139,11 +144,12 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
     if (!export_extension.empty() && export_type_list.size() != 1) {
         std::cerr
             << "InkFileExportCmd::do_export: You may only specify one export type if --export-extension is supplied";
-        return;
+        return 1;
     }
     Inkscape::Extension::DB::OutputList extension_list;
     Inkscape::Extension::db.get_output_list(extension_list);
 
+    int result = 0;
     for (auto const &Type : export_type_list) {
         // use lowercase type for following comparisons
         auto type = Type.lowercase();
@@ -161,10 +167,11 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         // For PNG export, there is no extension, so the method below can not be used.
         if (type == "png") {
             if (!export_extension_forced) {
-                do_export_png(doc, filename_in);
+                result |= do_export_png(doc, filename_in);
             } else {
                 std::cerr << "InkFileExportCmd::do_export: "
                           << "The parameter --export-extension is invalid for PNG export" << std::endl;
+                result = 1;
             }
             continue;
         }
@@ -172,7 +179,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         // an extension ID was explicitly given. This makes handling of --export-plain-svg easier (which
         // should also work when multiple file types are given, unlike --export-extension)
         if (type == "svg" && !export_extension_forced) {
-            do_export_svg(doc, filename_in);
+            result |= do_export_svg(doc, filename_in);
             continue;
         }
 
@@ -194,15 +201,15 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 if (!export_extension_forced ||
                     (export_extension_forced && export_extension == Glib::ustring(oext->get_id()).lowercase())) {
                     if (type == "svg") {
-                        do_export_svg(doc, filename_in, *oext);
+                        result |= do_export_svg(doc, filename_in, *oext);
                     } else if (type == "ps") {
-                        do_export_ps_pdf(doc, filename_in, "image/x-postscript", *oext);
+                        result |= do_export_ps_pdf(doc, filename_in, "image/x-postscript", *oext);
                     } else if (type == "eps") {
-                        do_export_ps_pdf(doc, filename_in, "image/x-e-postscript", *oext);
+                        result |= do_export_ps_pdf(doc, filename_in, "image/x-e-postscript", *oext);
                     } else if (type == "pdf") {
-                        do_export_ps_pdf(doc, filename_in, "application/pdf", *oext);
+                        result |= do_export_ps_pdf(doc, filename_in, "application/pdf", *oext);
                     } else {
-                        do_export_extension(doc, filename_in, oext);
+                        result |= do_export_extension(doc, filename_in, oext);
                     }
                     exported = true;
                     break;
@@ -210,6 +217,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
             }
         }
         if (!exported) {
+            result = 1;
             if (export_extension_forced && extension_for_fn_exists) {
                 // the located extension for this file type did not match the provided --export-extension parameter
                 std::cerr << "InkFileExportCmd::do_export: "
@@ -228,6 +236,108 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
             }
         }
     }
+    return result;
+}
+
+std::vector<InkFileExportCmd::Option> const &
+InkFileExportCmd::options()
+{
+    using T = InkFileExportCmd;
+    auto flag     = [](char const *name, bool T::*member)          { Option option{name}; option.flag = member;     return option; };
+    auto integer  = [](char const *name, int T::*member)           { Option option{name}; option.integer = member;  return option; };
+    auto number   = [](char const *name, double T::*member)        { Option option{name}; option.number = member;   return option; };
+    auto text     = [](char const *name, Glib::ustring T::*member) { Option option{name}; option.text = member;     return option; };
+    auto filename = [](char const *name, std::string T::*member)   { Option option{name}; option.filename = member; return option; };
+
+    // clang-format off
+    static std::vector<Option> const table = {
+        filename("export-filename",           &T::export_filename),
+        text    ("export-type",               &T::export_type),
+        text    ("export-extension",          &T::export_extension),
+        flag    ("export-overwrite",          &T::export_overwrite),
+        text    ("export-area",               &T::export_area),
+        flag    ("export-area-drawing",       &T::export_area_drawing),
+        flag    ("export-area-page",          &T::export_area_page),
+        integer ("export-margin",             &T::export_margin),
+        flag    ("export-area-snap",          &T::export_area_snap),
+        integer ("export-width",              &T::export_width),
+        integer ("export-height",             &T::export_height),
+        text    ("export-id",                 &T::export_id),
+        flag    ("export-id-only",            &T::export_id_only),
+        flag    ("export-plain-svg",          &T::export_plain_svg),
+        number  ("export-dpi",                &T::export_dpi),
+        flag    ("export-ignore-filters",     &T::export_ignore_filters),
+        flag    ("export-text-to-path",       &T::export_text_to_path),
+        integer ("export-ps-level",           &T::export_ps_level),
+        text    ("export-pdf-version",        &T::export_pdf_level),
+        flag    ("export-latex",              &T::export_latex),
+        flag    ("export-use-hints",          &T::export_use_hints),
+        text    ("export-background",         &T::export_background),
+        number  ("export-background-opacity", &T::export_background_opacity),
+        text    ("export-png-color-mode",     &T::export_png_color_mode),
+        text    ("export-png-scales",         &T::export_png_scales),
+    };
+    // clang-format on
+    return table;
+}
+
+bool
+InkFileExportCmd::set_option(std::string const &name, std::string const &value)
+{
+    for (auto const &option : options()) {
+        if (name != option.name) {
+            continue;
+        }
+        if (option.flag) {
+            if (value.empty() || value == "true") {
+                this->*option.flag = true;
+            } else if (value == "false") {
+                this->*option.flag = false;
+            } else {
+                return false;
+            }
+        } else if (option.integer || option.number) {
+            char *end = nullptr;
+            double number = option.integer ? strtol(value.c_str(), &end, 10) : g_ascii_strtod(value.c_str(), &end);
+            if (value.empty() || *end != '\0') {
+                return false;
+            }
+            if (option.integer) {
+                this->*option.integer = static_cast<int>(number);
+            } else {
+                this->*option.number = number;
+            }
+        } else if (option.text) {
+            this->*option.text = value;
+        } else {
+            this->*option.filename = value;
+            return !value.empty();
+        }
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::string>
+InkFileExportCmd::get_arguments() const
+{
+    InkFileExportCmd const defaults;
+    std::vector<std::string> arguments;
+    for (auto const &option : options()) {
+        std::string argument = std::string("--") + option.name;
+        if (option.flag && this->*option.flag != defaults.*option.flag) {
+            arguments.push_back(argument + (this->*option.flag ? "" : "=false"));
+        } else if (option.integer && this->*option.integer != defaults.*option.integer) {
+            arguments.push_back(argument + "=" + std::to_string(this->*option.integer));
+        } else if (option.number && this->*option.number != defaults.*option.number) {
+            arguments.push_back(argument + "=" + Glib::Ascii::dtostr(this->*option.number));
+        } else if (option.text && this->*option.text != defaults.*option.text) {
+            arguments.push_back(argument + "=" + (this->*option.text).raw());
+        } else if (option.filename && this->*option.filename != defaults.*option.filename) {
+            arguments.push_back(argument + "=" + this->*option.filename);
+        }
+    }
+    return arguments;
 }
 
 // File names use std::string. HTML5 and presumably SVG 2 allows UTF-8 characters. Do we need to convert "object_id" here?
@@ -289,6 +399,20 @@ InkFileExportCmd::get_filename_out(std::string filename_in, std::string object_i
     //     }
     // }
 }
+
+// Inserts the scale before the extension: "icon.png" at 2 becomes "icon@2x.png".
+std::string
+InkFileExportCmd::get_filename_scaled(std::string const &filename, double scale)
+{
+    std::ostringstream suffix;
+    suffix << "@" << scale << "x";
+
+    std::string base = Glib::path_get_basename(filename);
+    auto dot = base.rfind('.');
+    size_t position = dot == std::string::npos || dot == 0 ? filename.size() : filename.size() - base.size() + dot;
+    return filename.substr(0, position) + suffix.str() + filename.substr(position);
+}
+
 /**
  *  Perform an SVG export
  *
@@ -456,6 +580,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
     bool filename_from_hint = false;
     gdouble dpi = 0.0;
     guint32 bgcolor = get_bgcolor(doc);
+    int result = 0;
 
     // Export each object in list (or root if empty).  Use ';' so in future it could be possible to selected multiple objects to export together.
     std::vector<Glib::ustring> objects = Glib::Regex::split_simple("\\s*;\\s*", export_id);
@@ -463,6 +588,26 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
         objects.emplace_back(); // So we do loop at least once for root.
     }
 
+    // Each object is exported at each scale, as in "1;2;3". Scales other than 1 are added to
+    // the file name, e.g. icon@2x.png.
+    std::vector<double> scales;
+    for (auto const &scale : Glib::Regex::split_simple("\\s*;\\s*", export_png_scales)) {
+        char *end = nullptr;
+        double value = g_ascii_strtod(scale.c_str(), &end);
+        if (scale.empty() || *end != '\0' || value <= 0.0) {
+            std::cerr << "InkFileExport::do_export_png: "
+                      << "Invalid scale " << scale << " in --export-png-scales." << std::endl;
+            return 1;
+        }
+        scales.push_back(value);
+    }
+    if (scales.empty()) {
+        scales.push_back(1.0);
+    }
+
+    // All files are rendered together at the end, so that the document is only shown once.
+    std::vector<SPPngExportJob> jobs;
+
     for (auto object_id : objects) {
 
         std::string filename_out = get_filename_out(filename_in, Glib::filename_from_utf8(object_id));
@@ -479,6 +624,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
             std::cerr << "InkFileExport::do_export_png: "
                       << "Object with id=\"" << object_id
                       << "\" was not found in the document. Skipping." << std::endl;
+            result = 1;
             continue;
         }
 
@@ -486,6 +632,7 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
             std::cerr << "InkFileExportCmd::do_export_png: "
                       << "Object with id=\"" << object_id
                       << "\" is not a visible item. Skipping." << std::endl;
+            result = 1;
             continue;
         }
 
@@ -688,25 +835,46 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
 
         // ----------------------  Generate the PNG -------------------------------
 
-        // Do we really need to print this?
-        std::cerr << "Background RRGGBBAA: " << std::hex << bgcolor << std::dec << std::endl;
-        std::cerr << "Area "
-                  << area[Geom::X][0] << ":" << area[Geom::Y][0] << ":"
-                  << area[Geom::X][1] << ":" << area[Geom::Y][1] << " exported to "
-                  << width << " x " << height << " pixels (" << dpi << " dpi)" << std::endl;
-
         reverse(items.begin(),items.end()); // But there was only one item!
 
-        if( sp_export_png_file(doc, filename_out.c_str(), area, width, height, xdpi, ydpi,
-                               bgcolor, nullptr, nullptr, true, export_id_only ? items : std::vector<SPItem*>(),
-                               false, color_type, bit_depth) == 1 ) {
-        } else {
-            std::cerr << "InkFileExport::do_export_png: Failed to export to " << filename_out << std::endl;
-            continue;
+        for (auto scale : scales) {
+            SPPngExportJob job;
+            job.filename = scale == 1.0 ? filename_out : get_filename_scaled(filename_out, scale);
+            job.area = area;
+            job.width = (unsigned long int) (width * scale + 0.5);
+            job.height = (unsigned long int) (height * scale + 0.5);
+            job.xdpi = xdpi * scale;
+            job.ydpi = ydpi * scale;
+            job.items_only = export_id_only ? items : std::vector<SPItem*>();
+            job.color_type = color_type;
+            job.bit_depth = bit_depth;
+
+            if ((job.width < 1) || (job.height < 1) || (job.width > PNG_UINT_31_MAX) || (job.height > PNG_UINT_31_MAX)) {
+                std::cerr << "InkFileExport::do_export_png: Dimensions " << job.width << "x" << job.height << " are out of range (1 to " << PNG_UINT_31_MAX << ")." << std::endl;
+                result = 1;
+                continue;
+            }
+
+            // Do we really need to print this?
+            std::cerr << "Background RRGGBBAA: " << std::hex << bgcolor << std::dec << std::endl;
+            std::cerr << "Area "
+                      << area[Geom::X][0] << ":" << area[Geom::Y][0] << ":"
+                      << area[Geom::X][1] << ":" << area[Geom::Y][1] << " exported to "
+                      << job.width << " x " << job.height << " pixels (" << dpi * scale << " dpi)" << std::endl;
+
+            jobs.push_back(job);
         }
 
     } // End loop over objects.
-    return 0;
+
+    std::vector<ExportResult> results = sp_export_png_files(doc, jobs, bgcolor, nullptr, nullptr, true);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (results[i] != EXPORT_OK) {
+            std::cerr << "InkFileExport::do_export_png: Failed to export to " << jobs[i].filename << std::endl;
+            result = 1;
+        }
+    }
+    return result;
 }
 
 
@@ -13,6 +13,7 @@
 #define INK_FILE_EXPORT_CMD_H
 
 #include <iostream>
+#include <vector>
 #include <glibmm.h>
 
 class SPDocument;
@@ -27,11 +28,31 @@ class InkFileExportCmd {
 public:
     InkFileExportCmd();
 
-    void do_export(SPDocument* doc, std::string filename_in="");
+    int do_export(SPDocument* doc, std::string filename_in="");
+
+    // An export option by its command line name (without the leading "--"), and the member
+    // it sets. Exactly one of the member pointers is set, by the type of the option.
+    struct Option {
+        char const *name;
+        bool          InkFileExportCmd::*flag;
+        int           InkFileExportCmd::*integer;
+        double        InkFileExportCmd::*number;
+        Glib::ustring InkFileExportCmd::*text;
+        std::string   InkFileExportCmd::*filename;
+    };
+    static std::vector<Option> const &options();
+
+    // Sets the option with the given command line name (without the leading "--"). Flags take
+    // an empty value, "true" or "false". Returns false for unknown options and bad values.
+    bool set_option(std::string const &name, std::string const &value);
+
+    // The options that differ from the defaults, as command line arguments.
+    std::vector<std::string> get_arguments() const;
 
 private:
     guint32 get_bgcolor(SPDocument *doc);
     std::string get_filename_out(std::string filename_in = "", std::string object_id = "");
+    std::string get_filename_scaled(std::string const &filename, double scale);
     int do_export_svg(SPDocument *doc, std::string const &filename_in);
     int do_export_svg(SPDocument *doc, std::string const &filename_in, Inkscape::Extension::Output &extension);
     int do_export_png(SPDocument *doc, std::string const &filename_in);
@@ -71,6 +92,7 @@ public:
     Glib::ustring export_background;
     double        export_background_opacity;
     Glib::ustring export_png_color_mode;
+    Glib::ustring export_png_scales;
     bool          export_plain_svg;
 };
 
@@ -16,12 +16,23 @@
  * for gzip input and output.
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
 #include "gzipstream.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
 
+#include <glib.h>
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
 namespace Inkscape
 {
 namespace IO
@@ -286,13 +297,101 @@ int GzipInputStream::fetchMore()
 //# G Z I P   O U T P U T    S T R E A M
 //#########################################################################
 
+namespace {
+
+/// Amount of input compressed as one independent block.
+size_t const DEFLATE_BLOCK_SIZE = 128 * 1024;
+
+/// Largest distance a deflate match can reach back.
+size_t const DEFLATE_WINDOW = 32 * 1024;
+
+/**
+ * Compresses one block into out, primed with the dictionary before it.
+ */
+bool deflateBlock(std::vector<unsigned char> &out,
+                  unsigned char const *dict, size_t dictLen,
+                  unsigned char const *data, size_t len,
+                  bool last, int level)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    if (dictLen && deflateSetDictionary(&zs, dict, dictLen) != Z_OK) {
+        deflateEnd(&zs);
+        return false;
+    }
+
+    // deflateBound() covers Z_FINISH; a sync flush adds at most a few bytes more.
+    out.resize(deflateBound(&zs, len) + 16);
+    zs.next_in   = const_cast<Bytef *>(data);
+    zs.avail_in  = len;
+    zs.next_out  = out.data();
+    zs.avail_out = out.size();
+
+    int zerr = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+    bool ok = last ? zerr == Z_STREAM_END : (zerr == Z_OK && zs.avail_in == 0 && zs.avail_out > 0);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return ok;
+}
+
+} // namespace
+
+bool deflateBlocks(std::vector<unsigned char> &dest,
+                   unsigned char const *data, size_t len, size_t history,
+                   bool last, int level, int threads, unsigned long &crc)
+{
+    if (!len && !last) {
+        return true;
+    }
+
+    int const count = std::max<size_t>(1, (len + DEFLATE_BLOCK_SIZE - 1) / DEFLATE_BLOCK_SIZE);
+    std::vector<std::vector<unsigned char>> blocks(count);
+    std::vector<uLong> crcs(count);
+    std::vector<char> ok(count);
+
+#ifdef HAVE_OPENMP
+    if (threads <= 0) {
+        threads = omp_get_num_procs();
+    }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads) if (count > 1)
+#endif
+    for (int i = 0; i < count; ++i) {
+        size_t const start = i * DEFLATE_BLOCK_SIZE;
+        size_t const blockLen = std::min(DEFLATE_BLOCK_SIZE, len - start);
+        size_t const dictLen = std::min(DEFLATE_WINDOW, start + history);
+        ok[i] = deflateBlock(blocks[i], data + start - dictLen, dictLen, data + start, blockLen,
+                             last && i == count - 1, level);
+        crcs[i] = crc32(0L, data + start, blockLen);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (!ok[i]) {
+            return false;
+        }
+        size_t const blockLen = std::min(DEFLATE_BLOCK_SIZE, len - i * DEFLATE_BLOCK_SIZE);
+        crc = crc32_combine(crc, crcs[i], blockLen);
+        dest.insert(dest.end(), blocks[i].begin(), blocks[i].end());
+    }
+    return true;
+}
+
 /**
  *
  */ 
-GzipOutputStream::GzipOutputStream(OutputStream &destinationStream)
+GzipOutputStream::GzipOutputStream(OutputStream &destinationStream, int level, int threads)
                      : BasicOutputStream(destinationStream)
 {
 
+    historyLen      = 0;
+    this->level     = level;
+#ifdef HAVE_OPENMP
+    this->threads   = threads > 0 ? threads : omp_get_num_procs();
+#else
+    this->threads   = 1;
+#endif
     totalIn         = 0;
     totalOut        = 0;
     crc             = crc32(0L, Z_NULL, 0);
@@ -340,7 +439,7 @@ void GzipOutputStream::close()
     if (closed)
         return;
 
-    flush();
+    compressBuffer(true);
 
     //# Send the CRC
     uLong outlong = crc;
@@ -367,51 +466,42 @@ void GzipOutputStream::close()
  */ 
 void GzipOutputStream::flush()
 {
-    if (closed || inputBuf.empty())
+    if (closed || inputBuf.size() == historyLen)
 	{
         return;
     }
-	
-    uLong srclen = inputBuf.size();
-    Bytef *srcbuf = new (std::nothrow) Bytef [srclen];
-    if (!srcbuf)
-        {
-        return;
-        }
-        
-    uLong destlen = srclen;
-    Bytef *destbuf = new (std::nothrow) Bytef [(destlen + (srclen/100) + 13)];
-    if (!destbuf)
-        {
-        delete[] srcbuf;
-        return;
-        }
-        
-    std::vector<unsigned char>::iterator iter;
-    Bytef *p = srcbuf;
-    for (iter=inputBuf.begin() ; iter != inputBuf.end() ; ++iter)
-        *p++ = *iter;
-        
-    crc = crc32(crc, const_cast<const Bytef *>(srcbuf), srclen);
-    
-    int zerr = compress(destbuf, static_cast<uLongf *>(&destlen), srcbuf, srclen);
-    if (zerr != Z_OK)
+
+    compressBuffer(false);
+    destination.flush();
+}
+
+/**
+ * Compresses the buffered data and sends it on.  Unless this is the
+ * last of the data, the deflate stream is left open and the tail of
+ * the data is kept for the following blocks to refer back to.
+ */
+void GzipOutputStream::compressBuffer(bool last)
+{
+    std::vector<unsigned char> compressed;
+    if (!deflateBlocks(compressed, inputBuf.data() + historyLen, inputBuf.size() - historyLen, historyLen,
+                       last, level, threads, crc))
         {
-        printf("Some kind of problem\n");
+        g_warning("GzipOutputStream: compression failed");
         }
 
-    totalOut += destlen;
-    //skip the redundant zlib header and checksum
-    for (uLong i=2; i<destlen-4 ; i++)
+    totalOut += compressed.size();
+    destination.write(reinterpret_cast<char const *>(compressed.data()), compressed.size());
+
+    if (last)
         {
-        destination.put((int)destbuf[i]);
+        inputBuf.clear();
+        historyLen = 0;
+        return;
         }
-        
-    destination.flush();
 
-    inputBuf.clear();
-    delete[] srcbuf;
-    delete[] destbuf;
+    size_t const keep = std::min(inputBuf.size(), DEFLATE_WINDOW);
+    inputBuf.erase(inputBuf.begin(), inputBuf.end() - keep);
+    historyLen = keep;
 }
 
 
@@ -431,9 +521,32 @@ int GzipOutputStream::put(char ch)
     //Add char to buffer
     inputBuf.push_back(ch);
     totalIn++;
+    if (inputBuf.size() - historyLen >= threads * DEFLATE_BLOCK_SIZE)
+        {
+        compressBuffer(false);
+        }
     return 1;
 }
 
+/**
+ * Writes a block of bytes to this output stream.
+ */
+int GzipOutputStream::write(char const *data, size_t len)
+{
+    if (closed)
+        {
+        return -1;
+        }
+
+    inputBuf.insert(inputBuf.end(), data, data + len);
+    totalIn += len;
+    if (inputBuf.size() - historyLen >= threads * DEFLATE_BLOCK_SIZE)
+        {
+        compressBuffer(false);
+        }
+    return len;
+}
+
 
 
 } // namespace IO
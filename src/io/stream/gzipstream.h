@@ -81,13 +81,21 @@ private:
  * This class is for gzip-compressing data going to the
  * destination OutputStream
  *
+ * The data is compressed pigz-style: it is cut into blocks that are
+ * deflated independently, on several threads if asked to, and then
+ * concatenated into a single gzip member that any gzip reader accepts.
  */
 class GzipOutputStream : public BasicOutputStream
 {
 
 public:
 
-    GzipOutputStream(OutputStream &destinationStream);
+    /**
+     * @param level    zlib compression level, 0 to 9, or Z_DEFAULT_COMPRESSION
+     * @param threads  number of threads to compress with; 0 for one per processor
+     */
+    GzipOutputStream(OutputStream &destinationStream,
+                     int level = Z_DEFAULT_COMPRESSION, int threads = 1);
     
     ~GzipOutputStream() override;
     
@@ -97,9 +105,18 @@ public:
     
     int put(char ch) override;
 
+    int write(char const *data, size_t len) override;
+
 private:
 
+    void compressBuffer(bool last);
+
+    /// The last 32 KiB already compressed, followed by the data still to be compressed.
     std::vector<unsigned char> inputBuf;
+    size_t historyLen;
+
+    int level;
+    int threads;
 
     long totalIn;
     long totalOut;
@@ -108,6 +125,22 @@ private:
 }; // class GzipOutputStream
 
 
+/**
+ * Compresses len bytes at data into raw deflate blocks appended to dest,
+ * without a zlib or gzip wrapper.  The data is cut into blocks that are
+ * compressed independently on up to threads threads (0 for one per
+ * processor), each block primed with the 32 KiB before it, as pigz does.
+ * Unless last is set, the output ends on a byte boundary with the stream
+ * left open so that more blocks can follow.
+ *
+ * @param history  number of bytes before data that blocks may refer back to
+ * @param crc      updated with the CRC-32 of the data
+ */
+bool deflateBlocks(std::vector<unsigned char> &dest,
+                   unsigned char const *data, size_t len, size_t history,
+                   bool last, int level, int threads, unsigned long &crc);
+
+
 
 
 
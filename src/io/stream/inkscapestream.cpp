@@ -13,6 +13,7 @@
  */
 
 #include <cstdlib>
+#include <cstring>
 #include "inkscapestream.h"
 
 namespace Inkscape
@@ -91,6 +92,19 @@ int BasicInputStream::get()
 //# B A S I C    O U T P U T    S T R E A M
 //#########################################################################
 
+/**
+ * Writes a block of bytes to this output stream, one at a time.
+ */
+int OutputStream::write(char const *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (put(data[i]) < 0) {
+            return -1;
+        }
+    }
+    return len;
+}
+
 /**
  *
  */ 
@@ -740,6 +754,26 @@ void OutputStreamWriter::put(char ch)
     outputStream.put(ch);
 }
 
+/**
+ * Writes the specified standard string to the OutputStream in one block.
+ */
+Writer &OutputStreamWriter::writeStdString(const std::string &str)
+{
+    outputStream.write(str.data(), str.size());
+    return *this;
+}
+
+/**
+ * Writes the specified character string to the OutputStream in one block.
+ */
+Writer &OutputStreamWriter::writeString(const char *str)
+{
+    if (!str)
+        str = "null";
+    outputStream.write(str, strlen(str));
+    return *this;
+}
+
 //#########################################################################
 //# S T D    W R I T E R
 //#########################################################################
@@ -190,6 +190,13 @@ public:
      */
     virtual int put(char ch) = 0;
 
+    /**
+     * Send len bytes to the destination stream.  The default
+     * implementation calls put() for each byte; streams that can
+     * take a whole block at once should override this.
+     */
+    virtual int write(char const *data, size_t len);
+
 
 }; // class OutputStream
 
@@ -616,6 +623,11 @@ public:
     
     void put(char ch) override;
 
+    /* Pass whole strings on to the OutputStream as one block */
+    Writer& writeStdString(const std::string &val) override;
+
+    Writer& writeString(const char *str) override;
+
 
 private:
 
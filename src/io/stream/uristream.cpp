@@ -156,6 +156,20 @@ int FileOutputStream::put(char ch)
     return 1;
 }
 
+/**
+ * Writes a block of bytes to this output stream.
+ */
+int FileOutputStream::write(char const *data, size_t len)
+{
+    if (!outf)
+        return -1;
+    if (fwrite(data, 1, len, outf) != len) {
+        Glib::ustring err = "ERROR writing to file ";
+        throw StreamException(err);
+    }
+    return len;
+}
+
 
 
 
@@ -13,6 +13,7 @@
 
 
 #include <fstream>
+#include <iostream>
 #ifdef _WIN32
 #include <fcntl.h>
 #include <io.h>
@@ -22,6 +23,7 @@
 #include <glib/gstdio.h>
 #include <glibmm/ustring.h>
 
+#include "path-prefix.h"
 #include "preferences.h"
 #include "sys.h"
 
@@ -309,6 +311,28 @@ Inkscape::IO::spawn_async_with_pipes( const std::string& working_directory,
                                  standard_error);
 }
 
+bool
+Inkscape::IO::spawn_worker(std::vector<std::string> const &arguments,
+                           Glib::Pid *child_pid,
+                           int *standard_input,
+                           int *standard_output)
+{
+    if (!get_program_name()) {
+        std::cerr << "Inkscape::IO::spawn_worker: Can't start a worker: program name unknown" << std::endl;
+        return false;
+    }
+    std::vector<std::string> argv{get_program_name()};
+    argv.insert(argv.end(), arguments.begin(), arguments.end());
+    try {
+        Glib::spawn_async_with_pipes("", argv,
+                                     child_pid ? Glib::SPAWN_DO_NOT_REAP_CHILD : static_cast<Glib::SpawnFlags>(0),
+                                     sigc::slot<void>(), child_pid, standard_input, standard_output, nullptr);
+    } catch (Glib::Error const &error) {
+        std::cerr << "Inkscape::IO::spawn_worker: Can't start a worker: " << error.what() << std::endl;
+        return false;
+    }
+    return true;
+}
 
 gchar* Inkscape::IO::sanitizeString( gchar const * str )
 {
@@ -61,6 +61,17 @@ void spawn_async_with_pipes (const std::string& working_directory,
                              int* standard_output,
                              int* standard_error);
 
+/**
+ * Runs this program again with the given arguments, for work that can't share this process,
+ * such as documents handled in parallel. With child_pid, the worker is not reaped and the
+ * caller has to watch for its exit. The other parameters are those of spawn_async_with_pipes().
+ * @return false if the worker could not be started, after saying why on stderr.
+ */
+bool spawn_worker(std::vector<std::string> const &arguments,
+                  Glib::Pid *child_pid,
+                  int *standard_input,
+                  int *standard_output);
+
 Glib::ustring get_file_extension(Glib::ustring path);
 
 }
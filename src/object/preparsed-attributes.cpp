@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Attribute values parsed ahead of object construction
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
+#include "preparsed-attributes.h"
+
+#include <cstring>
+#include <vector>
+
+#include <2geom/path-sink.h>
+#include <2geom/svg-path-parser.h>
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#include "preferences.h"
+#endif
+
+#include "svg/svg.h"
+#include "xml/node.h"
+
+namespace Inkscape {
+
+namespace {
+
+struct Job {
+    XML::Node const *repr;
+    char const *value;
+    bool is_path;
+    bool ok;
+    Geom::PathVector pathv;
+    Geom::Affine transform;
+};
+
+void collect(XML::Node const *repr, std::vector<Job> &jobs)
+{
+    if (repr->type() != XML::NodeType::ELEMENT_NODE) {
+        return;
+    }
+    if (!std::strcmp(repr->name(), "svg:path")) {
+        if (char const *d = repr->attribute("d")) {
+            jobs.push_back({repr, d, true, false, {}, {}});
+        }
+    }
+    if (char const *t = repr->attribute("transform")) {
+        jobs.push_back({repr, t, false, false, {}, {}});
+    }
+    for (auto child = repr->firstChild(); child; child = child->next()) {
+        collect(child, jobs);
+    }
+}
+
+/**
+ * Same as sp_svg_read_pathv(), minus the warning for malformed data, which needs the
+ * preferences. Such paths are left to the main thread.
+ */
+bool parse_path(char const *str, Geom::PathVector &pathv)
+{
+    Geom::PathBuilder builder(pathv);
+    Geom::SVGPathParser parser(builder);
+    parser.setZSnapThreshold(Geom::EPSILON);
+
+    try {
+        parser.parse(str);
+    } catch (Geom::SVGPathParseError &) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int PreparsedAttributes::threads()
+{
+#ifdef HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    return prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    return 1;
+#endif
+}
+
+void PreparsedAttributes::parse(XML::Node const *root)
+{
+    std::vector<Job> jobs;
+    collect(root, jobs);
+
+    int const count = jobs.size();
+    int numOfThreads = threads();
+    if (numOfThreads){} // inform compiler we are using it.
+
+    #ifdef HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(numOfThreads)
+    #endif
+    for (int i = 0; i < count; ++i) {
+        auto &job = jobs[i];
+        if (job.is_path) {
+            job.ok = parse_path(job.value, job.pathv);
+        } else {
+            job.ok = sp_svg_transform_read(job.value, &job.transform);
+        }
+    }
+
+    for (auto &job : jobs) {
+        if (!job.ok) {
+            continue;
+        }
+        if (job.is_path) {
+            _paths.emplace(job.repr, Entry<Geom::PathVector>{job.value, std::move(job.pathv)});
+        } else {
+            _transforms.emplace(job.repr, Entry<Geom::Affine>{job.value, job.transform});
+        }
+    }
+}
+
+bool PreparsedAttributes::takePath(XML::Node const *repr, char const *value, Geom::PathVector &pathv)
+{
+    auto it = _paths.find(repr);
+    if (it == _paths.end()) {
+        return false;
+    }
+    bool match = matches(it->second, value);
+    if (match) {
+        pathv = std::move(it->second.result);
+    }
+    _paths.erase(it);
+    return match;
+}
+
+bool PreparsedAttributes::takeTransform(XML::Node const *repr, char const *value, Geom::Affine &transform)
+{
+    auto it = _transforms.find(repr);
+    if (it == _transforms.end()) {
+        return false;
+    }
+    bool match = matches(it->second, value);
+    if (match) {
+        transform = it->second.result;
+    }
+    _transforms.erase(it);
+    return match;
+}
+
+void PreparsedAttributes::addPath(XML::Node const *repr, Geom::PathVector pathv)
+{
+    if (char const *d = repr->attribute("d")) {
+        _paths[repr] = Entry<Geom::PathVector>{d, std::move(pathv)};
+    }
+}
+
+void PreparsedAttributes::addTransform(XML::Node const *repr, Geom::Affine const &transform)
+{
+    if (char const *t = repr->attribute("transform")) {
+        _transforms[repr] = Entry<Geom::Affine>{t, transform};
+    }
+}
+
+Geom::PathVector const *PreparsedAttributes::findPath(XML::Node const *repr) const
+{
+    auto it = _paths.find(repr);
+    if (it == _paths.end() || !matches(it->second, repr->attribute("d"))) {
+        return nullptr;
+    }
+    return &it->second.result;
+}
+
+Geom::Affine const *PreparsedAttributes::findTransform(XML::Node const *repr) const
+{
+    auto it = _transforms.find(repr);
+    if (it == _transforms.end() || !matches(it->second, repr->attribute("transform"))) {
+        return nullptr;
+    }
+    return &it->second.result;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
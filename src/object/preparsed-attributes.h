@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Attribute values parsed ahead of object construction
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_OBJECT_PREPARSED_ATTRIBUTES_H
+#define SEEN_INKSCAPE_OBJECT_PREPARSED_ATTRIBUTES_H
+
+#include <string>
+#include <unordered_map>
+
+#include <2geom/affine.h>
+#include <2geom/pathvector.h>
+
+namespace Inkscape {
+
+namespace XML {
+class Node;
+}
+
+/**
+ * Path data and transforms of a whole XML tree, parsed on all cores before the object
+ * tree is built on the main thread.
+ *
+ * Parsing these values depends on nothing but the string itself, unlike styles, which need
+ * the cascade, the preferences and libcroco. The building objects pick the results up
+ * with take*() instead of parsing the value themselves; a result is only handed out if
+ * the attribute still has the text that was parsed.
+ */
+class PreparsedAttributes
+{
+public:
+    /// Number of threads parse() would use, 1 if built without OpenMP.
+    static int threads();
+
+    /// Collect and parse the attributes of \a root and all its descendants.
+    void parse(XML::Node const *root);
+
+    bool takePath(XML::Node const *repr, char const *value, Geom::PathVector &pathv);
+    bool takeTransform(XML::Node const *repr, char const *value, Geom::Affine &transform);
+
+    /// Add results parsed elsewhere, e.g. read from the document cache, for the current
+    /// "d" or "transform" attribute of \a repr.
+    void addPath(XML::Node const *repr, Geom::PathVector pathv);
+    void addTransform(XML::Node const *repr, Geom::Affine const &transform);
+
+    /// The result for \a repr without taking it, or nullptr if the attribute has changed.
+    Geom::PathVector const *findPath(XML::Node const *repr) const;
+    Geom::Affine const *findTransform(XML::Node const *repr) const;
+
+    std::size_t size() const { return _paths.size() + _transforms.size(); }
+
+private:
+    template <typename T>
+    struct Entry {
+        std::string value; // A copy, as the attribute's string may be freed and its address reused
+        T result;
+    };
+
+    template <typename T>
+    static bool matches(Entry<T> const &entry, char const *value)
+    {
+        return value && entry.value == value;
+    }
+
+    std::unordered_map<XML::Node const *, Entry<Geom::PathVector>> _paths;
+    std::unordered_map<XML::Node const *, Entry<Geom::Affine>> _transforms;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_OBJECT_PREPARSED_ATTRIBUTES_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -31,6 +31,7 @@
 #include "conditions.h"
 #include "filter-chemistry.h"
 
+#include "preparsed-attributes.h"
 #include "sp-clippath.h"
 #include "sp-desc.h"
 #include "sp-guide.h"
@@ -67,6 +68,7 @@
 static SPItemView*          sp_item_view_list_remove(SPItemView     *list,
                                                      SPItemView     *view);
 
+SPItem::BBoxCacheStats SPItem::_bbox_cache_stats;
 
 SPItem::SPItem() : SPObject() {
 
@@ -83,7 +85,6 @@ SPItem::SPItem() : SPObject() {
     _evaluated_status = StatusUnknown;
 
     transform = Geom::identity();
-    // doc_bbox = Geom::OptRect();
 
     display = nullptr;
 
@@ -463,7 +464,10 @@ void SPItem::set(SPAttr key, gchar const* value) {
     switch (key) {
         case SPAttr::TRANSFORM: {
             Geom::Affine t;
-            if (value && sp_svg_transform_read(value, &t)) {
+            auto preparsed = document->getPreparsedAttributes();
+            if (value && preparsed && preparsed->takeTransform(getRepr(), value, t)) {
+                item->set_item_transform(t);
+            } else if (value && sp_svg_transform_read(value, &t)) {
                 item->set_item_transform(t);
             } else {
                 item->set_item_transform(Geom::identity());
@@ -793,16 +797,52 @@ Geom::OptRect SPItem::bbox(Geom::Affine const & /*transform*/, SPItem::BBoxType
 	return Geom::OptRect();
 }
 
-Geom::OptRect SPItem::geometricBounds(Geom::Affine const &transform) const
+/**
+ * Call the subclass bbox() method, reusing the result of an earlier call with the same
+ * transform and type if nothing changed in between.
+ *
+ * The cache is dropped when bbox_valid is cleared, which SPItem::update() does for every
+ * modification of the item or its descendants. While update or modified flags are still
+ * pending, or the document is being updated, descendants may be out of date, so nothing is
+ * cached. An update driven by the parent leaves the flags of this item clear before its
+ * update() has run.
+ */
+Geom::OptRect SPItem::_cachedBBox(Geom::Affine const &transform, BBoxType type) const
 {
-    Geom::OptRect bbox;
+    if (uflags || mflags || (document && document->update_in_progress)) {
+        _bbox_cache_stats.misses++;
+        return const_cast<SPItem*>(this)->bbox(transform, type);
+    }
+
+    if (!bbox_valid) {
+        for (auto &slots : _bbox_cache) {
+            for (auto &entry : slots) {
+                entry.valid = false;
+            }
+        }
+        bbox_valid = TRUE;
+        _bbox_cache_stats.invalidations++;
+    }
 
-    // call the subclass method
-    // CPPIFY
-    //bbox = this->bbox(transform, SPItem::GEOMETRIC_BBOX);
-    bbox = const_cast<SPItem*>(this)->bbox(transform, SPItem::GEOMETRIC_BBOX);
+    for (auto &entry : _bbox_cache[type]) {
+        if (entry.valid && entry.transform == transform) {
+            _bbox_cache_stats.hits++;
+            return entry.bbox;
+        }
+    }
 
-    return bbox;
+    _bbox_cache_stats.misses++;
+    auto &entry = _bbox_cache[type][_bbox_cache_next[type]];
+    _bbox_cache_next[type] = (_bbox_cache_next[type] + 1) % BBOX_CACHE_SLOTS;
+    entry.bbox = const_cast<SPItem*>(this)->bbox(transform, type);
+    entry.transform = transform;
+    entry.valid = true;
+    return entry.bbox;
+}
+
+Geom::OptRect SPItem::geometricBounds(Geom::Affine const &transform) const
+{
+    return _cachedBBox(transform, SPItem::GEOMETRIC_BBOX);
 }
 
 Geom::OptRect SPItem::visualBounds(Geom::Affine const &transform, bool wfilter, bool wclip, bool wmask) const
@@ -816,9 +856,7 @@ Geom::OptRect SPItem::visualBounds(Geom::Affine const &transform, bool wfilter,
     SPFilter *filter = style ? style->getFilter() : nullptr;
     if (filter && wfilter) {
         // call the subclass method
-    	// CPPIFY
-    	//bbox = this->bbox(Geom::identity(), SPItem::VISUAL_BBOX);
-    	bbox = const_cast<SPItem*>(this)->bbox(Geom::identity(), SPItem::GEOMETRIC_BBOX); // see LP Bug 1229971
+    	bbox = _cachedBBox(Geom::identity(), SPItem::GEOMETRIC_BBOX); // see LP Bug 1229971
 
         // default filer area per the SVG spec:
         SVGLength x, y, w, h;
@@ -861,18 +899,13 @@ Geom::OptRect SPItem::visualBounds(Geom::Affine const &transform, bool wfilter,
         *bbox *= transform;
     } else {
         // call the subclass method
-    	// CPPIFY
-    	//bbox = this->bbox(transform, SPItem::VISUAL_BBOX);
-    	bbox = const_cast<SPItem*>(this)->bbox(transform, SPItem::VISUAL_BBOX);
+    	bbox = _cachedBBox(transform, SPItem::VISUAL_BBOX);
     }
+    // Clip and mask live outside of this item's subtree and are not covered by the cache
     if (clip_ref && clip_ref->getObject() && wclip) {
-        SPItem *ownerItem = dynamic_cast<SPItem *>(clip_ref->getOwner());
-        g_assert(ownerItem != nullptr);
-        ownerItem->bbox_valid = FALSE;  // LP Bug 1349018
         bbox.intersectWith(clip_ref->getObject()->geometricBounds(transform));
     }
     if (mask_ref && mask_ref->getObject() && wmask) {
-        bbox_valid = false;  // LP Bug 1349018
         bbox.intersectWith(mask_ref->getObject()->visualBounds(transform));
     }
 
@@ -906,12 +939,9 @@ Geom::OptRect SPItem::documentGeometricBounds() const
 
 Geom::OptRect SPItem::documentVisualBounds() const
 {
-    if (!bbox_valid) {
-        doc_bbox = visualBounds(i2doc_affine());
-        bbox_valid = true;
-    }
-    return doc_bbox;
+    return visualBounds(i2doc_affine());
 }
+
 Geom::OptRect SPItem::documentBounds(BBoxType type) const
 {
     if (type == GEOMETRIC_BBOX) {
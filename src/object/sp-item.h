@@ -147,15 +147,28 @@ public:
 
     unsigned int sensitive : 1;
     unsigned int stop_paint: 1;
+    /** Cleared whenever the geometry of the item or of its descendants may have changed;
+     *  invalidates the bounding box cache. */
     mutable unsigned bbox_valid : 1;
     double transform_center_x;
     double transform_center_y;
     bool freeze_stroke_width;
 
     Geom::Affine transform;
-    mutable Geom::OptRect doc_bbox;
     Geom::Rect viewport;  // Cache viewport information
 
+    /**
+     * Counters of the per-item bounding box cache, summed over all items.
+     * hits are recomputations avoided, misses are bbox() calls actually made.
+     */
+    struct BBoxCacheStats {
+        unsigned long hits = 0;
+        unsigned long misses = 0;
+        unsigned long invalidations = 0;
+    };
+    static BBoxCacheStats const &bboxCacheStats() { return _bbox_cache_stats; }
+    static void resetBBoxCacheStats() { _bbox_cache_stats = BBoxCacheStats(); }
+
     SPClipPath *getClipObject() const;
     SPMask *getMaskObject() const;
 
@@ -407,6 +420,23 @@ private:
     mutable bool _is_evaluated;
     mutable EvaluatedStatus _evaluated_status;
 
+    /**
+     * Bounding boxes returned by the subclass bbox() method, for the last few transforms
+     * asked for (typically identity, i2doc and i2dt). Filter, clip and mask adjustments
+     * depend on other objects and are applied on top, uncached.
+     */
+    struct BBoxCacheEntry {
+        Geom::Affine transform;
+        Geom::OptRect bbox;
+        bool valid = false;
+    };
+    static constexpr unsigned BBOX_CACHE_SLOTS = 3;
+    mutable BBoxCacheEntry _bbox_cache[VISUAL_BBOX + 1][BBOX_CACHE_SLOTS];
+    mutable unsigned _bbox_cache_next[VISUAL_BBOX + 1] = {};
+    static BBoxCacheStats _bbox_cache_stats;
+
+    Geom::OptRect _cachedBBox(Geom::Affine const &transform, BBoxType type) const;
+
     static SPItemView *sp_item_view_new_prepend(SPItemView *list, SPItem *item, unsigned flags, unsigned key, Inkscape::DrawingItem *arenaitem);
     static void clip_ref_changed(SPObject *old_clip, SPObject *clip, SPItem *item);
     static void mask_ref_changed(SPObject *old_clip, SPObject *clip, SPItem *item);
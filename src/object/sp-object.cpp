@@ -292,6 +292,11 @@ void SPObject::unhrefObject(SPObject* owner)
 }
 
 void SPObject::_updateTotalHRefCount(int increment) {
+    if (document && document->isDestroying()) {
+        // nothing is going to be collected as an orphan anymore
+        return;
+    }
+
     SPObject *topmost_collectable = nullptr;
     for ( SPObject *iter = this ; iter ; iter = iter->parent ) {
         iter->_total_hrefcount += increment;
@@ -411,6 +416,23 @@ std::vector<SPObject*> SPObject::childList(bool add_ref, Action) {
     return l;
 }
 
+std::vector<SPObject*> SPObject::cascadeChildList(unsigned int cascade_flags) {
+    if (!cascade_flags && document) {
+        if (auto dirty = document->getDirtyChildren(this)) {
+            std::vector<SPObject*> l;
+            for (auto child : *dirty) {
+                // children removed since the pass started are skipped
+                if (child->parent == this) {
+                    sp_object_ref(child);
+                    l.push_back(child);
+                }
+            }
+            return l;
+        }
+    }
+    return childList(true, ActionUpdate);
+}
+
 gchar const *SPObject::label() const {
     return _label;
 }
@@ -845,7 +867,8 @@ void SPObject::releaseReferences() {
     g_assert(this->hrefcount == 0);
 
     if (!cloned) {
-        if (this->id) {
+        // a document being destroyed clears its maps at once
+        if (this->id && !this->document->isDestroying()) {
             this->document->bindObjectToId(this->id, nullptr);
         }
         g_free(this->id);
@@ -854,7 +877,9 @@ void SPObject::releaseReferences() {
         g_free(this->_default_label);
         this->_default_label = nullptr;
 
-        this->document->bindObjectToRepr(this->repr, nullptr);
+        if (!this->document->isDestroying()) {
+            this->document->bindObjectToRepr(this->repr, nullptr);
+        }
 
         Inkscape::GC::release(this->repr);
     } else {
@@ -1068,6 +1093,11 @@ void SPObject::repr_attr_changed(Inkscape::XML::Node * /*repr*/, gchar const *ke
 {
     SPObject *object = SP_OBJECT(data);
 
+    if (!is_interactive && object->document && object->document->isBatching()) {
+        object->document->queueAttributeRead(object, key);
+        return;
+    }
+
     object->readAttr(key);
 
     // manual changes to extension attributes require the normal
@@ -1273,6 +1303,7 @@ void SPObject::requestDisplayUpdate(unsigned int flags)
      */
     if (already_propagated) {
         if(this->document) {
+            this->document->queueForUpdate(this);
             if (parent) {
                 parent->requestDisplayUpdate(SP_OBJECT_CHILD_MODIFIED_FLAG);
             } else {
@@ -1295,7 +1326,8 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
     objectTrace( "SPObject::updateDisplay" );
 #endif
 
-    assert(++(document->update_in_progress));
+    // Also counted in release builds, the bounding box cache of SPItem checks it.
+    ++document->update_in_progress;
 
 #ifdef SP_OBJECT_DEBUG_CASCADE
     g_print("Update %s:%s %x %x %x\n", g_type_name_from_instance((GTypeInstance *) this), getId(), flags, this->uflags, this->mflags);
@@ -1307,6 +1339,7 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
     this->mflags |= this->uflags;
     /* We have to clear flags here to allow rescheduling update */
     this->uflags = 0;
+    document->update_stats.updated++;
 
     // Merge style if we have good reasons to think that parent style is changed */
     /** \todo
@@ -1336,7 +1369,7 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
         g_warning("SPObject::updateDisplay(SPCtx *ctx, unsigned int flags) : throw in ((SPObjectClass *) G_OBJECT_GET_CLASS(this))->update(this, ctx, flags);");
     }
 
-    assert((document->update_in_progress)--);
+    --document->update_in_progress;
 
 #ifdef OBJECT_TRACE
     objectTrace( "SPObject::updateDisplay", false );
@@ -1365,6 +1398,7 @@ void SPObject::requestModified(unsigned int flags)
      * don't need to set CHILD_MODIFIED on our ancestors because it's already been done.
      */
     if (already_propagated) {
+        document->queueForUpdate(this);
         if (parent) {
             parent->requestModified(SP_OBJECT_CHILD_MODIFIED_FLAG);
         } else {
@@ -1394,6 +1428,9 @@ void SPObject::emitModified(unsigned int flags)
      * make changes and therefore queue new modification notifications
      * themselves. */
     this->mflags = 0;
+    if (document) {
+        document->update_stats.modified++;
+    }
 
     sp_object_ref(this);
 
@@ -307,6 +307,13 @@ public:
      */
     std::vector<SPObject*> childList(bool add_ref, Action action = ActionGeneral);
 
+    /**
+     * Retrieves the children an update or modified walk has to look at, ref'ed: all of
+     * them if \a cascade_flags propagate to every child, otherwise only those the
+     * document's update pass knows to be dirty or to have dirty descendants.
+     */
+    std::vector<SPObject*> cascadeChildList(unsigned int cascade_flags);
+
     /**
      * Append repr as child of this object.
      * \pre this is not a cloned object
@@ -33,6 +33,7 @@
 #include "attributes.h"
 
 #include "sp-path.h"
+#include "preparsed-attributes.h"
 #include "sp-guide.h"
 
 #include "document.h"
@@ -243,7 +244,11 @@ void SPPath::set(SPAttr key, const gchar* value) {
 
        case SPAttr::D:
             if (value) {
-                Geom::PathVector pv = sp_svg_read_pathv(value);
+                Geom::PathVector pv;
+                auto preparsed = document->getPreparsedAttributes();
+                if (!preparsed || !preparsed->takePath(getRepr(), value, pv)) {
+                    pv = sp_svg_read_pathv(value);
+                }
                 setCurve(std::make_unique<SPCurve>(pv));
             } else {
                 this->setCurve(nullptr);
@@ -1013,13 +1013,12 @@ sp_shape_marker_release (SPObject *marker, SPShape *shape)
 }
 
 /**
- * No-op.  Exists for handling 'modified' messages
+ * Handles 'modified' messages of markers: the visual bbox includes them.
  */
 static void
-sp_shape_marker_modified (SPObject */*marker*/, guint /*flags*/, SPItem */*item*/)
+sp_shape_marker_modified (SPObject */*marker*/, guint /*flags*/, SPItem *item)
 {
-    /* I think mask does update automagically */
-    /* g_warning ("Item %s mask %s modified", item->getId(), mask->getId()); */
+    item->bbox_valid = FALSE;
 }
 
 /**
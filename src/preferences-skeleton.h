@@ -329,6 +329,7 @@ static char const preferences_skeleton[] =
            minimumexponent="-8"
            inlineattrs="0"
            indent="2"
+           compression_level="6"
            pathstring_format="2"
            forcerepeatcommands="0"
            incorrect_attributes_warn="1"
@@ -341,13 +342,18 @@ static char const preferences_skeleton[] =
            check_on_editing="0"
            check_on_writing="0"
            sort_attributes="0"/>
+    <group id="svgload" cache="0" cache_minsize="1024" cache_max="10"/>
+    <group id="pdfimport" compactpaths="0"/>
+    <group id="metafileimport" styleclasses="0"/>
     <group id="externalresources">
       <group id="xml"
            allow_net_access="0"/>
     </group>
     <group id="forkgradientvectors" value="1"/>
     <group id="iconrender" named_nodelay="0"/>
-    <group id="autosave" enable="1" interval="10" path="" max="10"/>
+    <group id="autosave" enable="1" interval="10" path="" max="10" journal="0"/>
+    <group id="undo" memorylimit="256"/>
+    <group id="export" memorylimit="256"/>
     <group id="grids"
       no_emphasize_when_zoomedout="0">
       <group id="xy"
@@ -37,6 +37,8 @@
 
 #include "3rdparty/libcroco/cr-sel-eng.h"
 
+#include "debug/timing-report.h"
+
 #include "object/sp-paint-server.h"
 #include "object/uri-references.h"
 #include "object/uri.h"
@@ -502,7 +504,7 @@ SPStyle::~SPStyle() {
     // std::cout << "SPStyle::~SPStyle(): Exit\n" << std::endl;
 }
 
-const std::vector<SPIBase *> SPStyle::properties() { return this->_properties; }
+const std::vector<SPIBase *> SPStyle::properties() const { return this->_properties; }
 
 void
 SPStyle::clear(SPAttr id) {
@@ -566,6 +568,8 @@ SPStyle::read( SPObject *object, Inkscape::XML::Node *repr ) {
     g_assert(repr != nullptr);
     g_assert(!object || (object->getRepr() == repr));
 
+    Inkscape::Debug::PhaseTracker tracker("style-cascade");
+
     // // Uncomment to verify that we don't need to call clear.
     // std::cout << " Creating temp style for testing" << std::endl;
     // SPStyle *temp = new SPStyle();
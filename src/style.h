@@ -48,7 +48,7 @@ public:
 
     SPStyle(SPDocument *document = nullptr, SPObject *object = nullptr);// document is ignored if valid object given
     ~SPStyle();
-    const std::vector<SPIBase *> properties();
+    const std::vector<SPIBase *> properties() const;
     void clear();
     void clear(SPAttr id);
     void read(SPObject *object, Inkscape::XML::Node *repr);
@@ -8,7 +8,7 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 #include "svg/css-ostringstream.h"
-#include "svg/strip-trailing-zeros.h"
+#include "svg/svg.h"
 #include "preferences.h"
 
 Inkscape::CSSOStringStream::CSSOStringStream()
@@ -34,23 +34,14 @@ Inkscape::CSSOStringStream &Inkscape::CSSOStringStream::operator<<(double d)
         return *this;
     }
 
-    char buf[32];  // haven't thought about how much is really required.
-    switch (precision()) {
-        case 9: g_ascii_formatd(buf, sizeof(buf), "%.9f", d); break;
-        case 8: g_ascii_formatd(buf, sizeof(buf), "%.8f", d); break;
-        case 7: g_ascii_formatd(buf, sizeof(buf), "%.7f", d); break;
-        case 6: g_ascii_formatd(buf, sizeof(buf), "%.6f", d); break;
-        case 5: g_ascii_formatd(buf, sizeof(buf), "%.5f", d); break;
-        case 4: g_ascii_formatd(buf, sizeof(buf), "%.4f", d); break;
-        case 3: g_ascii_formatd(buf, sizeof(buf), "%.3f", d); break;
-        case 2: g_ascii_formatd(buf, sizeof(buf), "%.2f", d); break;
-        case 1: g_ascii_formatd(buf, sizeof(buf), "%.1f", d); break;
-        case 0: g_ascii_formatd(buf, sizeof(buf), "%.0f", d); break;
-        case 10: default: g_ascii_formatd(buf, sizeof(buf), "%.10f", d); break;
+    auto prec = precision();
+    if (prec < 0 || prec > 10) {
+        prec = 10;
     }
-    auto &os = *this;
-    os << strip_trailing_zeros(buf);
-    return os;
+    char buf[400]; // enough for any double in fixed notation
+    auto const len = sp_svg_number_format(buf, sizeof(buf), d, 'f', prec);
+    ostr.write(buf, len);
+    return *this;
 }
 
 
@@ -144,7 +144,7 @@ void Inkscape::SVG::PathString::State::appendRelative(Geom::Coord v, Geom::Coord
 }
 
 void Inkscape::SVG::PathString::State::appendNumber(double v, int precision, int minexp) {
-    size_t const reserve = precision+1+1+1+1+3; // Just large enough to hold the maximum number of digits plus a sign, a period, the letter 'e', another sign and three digits for the exponent
+    size_t const reserve = precision+1+1+1+1+3+1; // Just large enough to hold the maximum number of digits plus a sign, a period, the letter 'e', another sign, three digits for the exponent and the terminating null
     size_t const oldsize = str.size();
     str.append(reserve, (char)0);
     char* begin_of_num = const_cast<char*>(str.data()+oldsize); // Slightly evil, I know (but std::string should be storing its data in one big block of memory, so...)
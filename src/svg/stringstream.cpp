@@ -8,9 +8,10 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 #include "svg/stringstream.h"
-#include "svg/strip-trailing-zeros.h"
+#include "svg/svg.h"
 #include "preferences.h"
 #include <2geom/point.h>
+#include <algorithm>
 
 Inkscape::SVGOStringStream::SVGOStringStream()
 {
@@ -40,12 +41,13 @@ Inkscape::SVGOStringStream::operator<<(double d)
         }
     }
 
-    std::ostringstream s;
-    s.imbue(std::locale::classic());
-    s.flags(os.setf(std::ios::showpoint));
-    s.precision(os.precision());
-    s << d;
-    os << strip_trailing_zeros(s.str());
+    auto const flags = ostr.flags() & std::ios::floatfield;
+    char const conversion = flags == std::ios::fixed      ? 'f'
+                          : flags == std::ios::scientific ? 'e'
+                                                          : 'g';
+    char buf[400]; // enough for any double in fixed notation
+    auto const len = sp_svg_number_format(buf, sizeof(buf), d, conversion, std::clamp<std::streamsize>(precision(), 0, 40));
+    ostr.write(buf, len);
     return os;
 }
 
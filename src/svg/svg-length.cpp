@@ -11,7 +11,10 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 #include <glib.h>
@@ -95,79 +98,118 @@ static unsigned int sp_svg_number_write_i(gchar *buf, int bufLen, int val)
     return p;
 }
 
-// TODO unsafe code ignoring bufLen
-// rewrite using std::string?
-static unsigned sp_svg_number_write_d(gchar *buf, int bufLen, double val, unsigned int tprec, unsigned int fprec)
+unsigned int sp_svg_number_format(gchar *buf, int bufLen, double val, char conversion, int precision)
 {
-    /* Process sign */
-    int i = 0;
-    if (val < 0.0) {
-        buf[i++] = '-';
-        val = fabs(val);
-    }
-
-    /* Determine number of integral digits */
-    int idigits = 0;
-    if (val >= 1.0) {
-        idigits = (int) floor(log10(val)) + 1;
-    }
-
-    /* Determine the actual number of fractional digits */
-    fprec = MAX(static_cast<int>(fprec), static_cast<int>(tprec) - idigits);
-    /* Round value */
-    val += 0.5 / pow(10.0, fprec);
-    /* Extract integral and fractional parts */
-    double dival = floor(val);
-    double fval = val - dival;
-    /* Write integra */
-    if (idigits > (int)tprec) {
-        i += sp_svg_number_write_ui(buf + i, (unsigned int)floor(dival/pow(10.0, idigits-tprec) + .5));
-        for(unsigned int j=0; j<(unsigned int)idigits-tprec; j++) {
-            buf[i+j] = '0';
-        }
-        i += idigits-tprec;
+    g_return_val_if_fail(conversion == 'e' || conversion == 'f' || conversion == 'g', 0);
+
+    int len;
+#if __cpp_lib_to_chars >= 201611L
+    std::to_chars_result result;
+    if (conversion == 'g' && precision >= 17) {
+        // Beyond what a double holds: the shortest string reading back as the same value.
+        result = std::to_chars(buf, buf + bufLen - 1, val);
     } else {
-        i += sp_svg_number_write_ui(buf + i, (unsigned int)dival);
-    }
-    int end_i = i;
-    if (fprec > 0 && fval > 0.0) {
-        buf[i++] = '.';
-        do {
-            fval *= 10.0;
-            dival = floor(fval);
-            fval -= dival;
-            int const int_dival = (int) dival;
-            buf[i++] = '0' + int_dival;
-            if (int_dival != 0) {
-                end_i = i;
-            }
-            fprec -= 1;
-        } while(fprec > 0 && fval > 0.0);
+        auto const format = conversion == 'e' ? std::chars_format::scientific
+                          : conversion == 'f' ? std::chars_format::fixed
+                          : std::chars_format::general;
+        result = std::to_chars(buf, buf + bufLen - 1, val, format, precision);
+    }
+    if (result.ec != std::errc()) {
+        buf[0] = 0;
+        return 0;
+    }
+    len = result.ptr - buf;
+    buf[len] = 0;
+#else
+    char format[8];
+    g_snprintf(format, sizeof(format), "%%.%d%c", std::min(precision, 17), conversion);
+    g_ascii_formatd(buf, bufLen, format, val);
+    len = strlen(buf);
+#endif
+
+    if (conversion == 'g') {
+        return len; // %g drops trailing zeros itself
+    }
+
+    char *point = strchr(buf, '.');
+    if (!point) {
+        return len;
+    }
+    char *exp = strchr(point, 'e');
+    char *end = exp ? exp : buf + len;
+    char *last = end;
+    while (last[-1] == '0') {
+        --last;
+    }
+    if (last[-1] == '.') {
+        --last;
     }
-    buf[end_i] = 0;
-    return end_i;
+    memmove(last, end, buf + len - end + 1);
+    return len - (end - last);
 }
 
 unsigned int sp_svg_number_write_de(gchar *buf, int bufLen, double val, unsigned int tprec, int min_exp)
 {
+    if (val == 0.0 || !std::isfinite(val)) {
+        return sp_svg_number_write_ui(buf, 0);
+    }
     int eval = (int)floor(log10(fabs(val)));
-    if (val == 0.0 || eval < min_exp) {
+    if (eval < min_exp) {
         return sp_svg_number_write_ui(buf, 0);
     }
+    tprec = std::clamp(tprec, 1u, 17u);
+
     unsigned int maxnumdigitsWithoutExp = // This doesn't include the sign because it is included in either representation
         eval<0?tprec+(unsigned int)-eval+1:
         eval+1<(int)tprec?tprec+1:
         (unsigned int)eval+1;
     unsigned int maxnumdigitsWithExp = tprec + ( eval<0 ? 4 : 3 ); // It's not necessary to take larger exponents into account, because then maxnumdigitsWithoutExp is DEFINITELY larger
-    if (maxnumdigitsWithoutExp <= maxnumdigitsWithExp) {
-        return sp_svg_number_write_d(buf, bufLen, val, tprec, 0);
+    bool const use_exp = maxnumdigitsWithoutExp > maxnumdigitsWithExp;
+
+    if (!use_exp && eval < 0) {
+        // Numbers below one have always been written with tprec decimals.
+        return sp_svg_number_format(buf, bufLen, val, 'f', tprec);
+    }
+
+    // Round to tprec significant digits once, then lay the digits out with or without exponent.
+    char sci[40];
+    sp_svg_number_format(sci, sizeof(sci), val, 'e', tprec - 1);
+    char const *digits = sci[0] == '-' ? sci + 1 : sci;
+    char const *exp = strchr(digits, 'e');
+    eval = atoi(exp + 1); // one more than before if rounding carried over
+    char mantissa[20];
+    int ndigits = 0;
+    for (char const *c = digits; c != exp; ++c) {
+        if (*c != '.') {
+            mantissa[ndigits++] = *c;
+        }
+    }
+
+    int p = 0;
+    if (val < 0.0) {
+        buf[p++] = '-';
+    }
+    if (!use_exp) {
+        for (int i = 0; i <= eval; i++) {
+            buf[p++] = i < ndigits ? mantissa[i] : '0';
+        }
+        if (ndigits > eval + 1) {
+            buf[p++] = '.';
+            memcpy(buf + p, mantissa + eval + 1, ndigits - eval - 1);
+            p += ndigits - eval - 1;
+        }
+        buf[p] = 0;
     } else {
-        val = eval < 0 ? val * pow(10.0, -eval) : val / pow(10.0, eval);
-        int p = sp_svg_number_write_d(buf, bufLen, val, tprec, 0);
+        buf[p++] = mantissa[0];
+        if (ndigits > 1) {
+            buf[p++] = '.';
+            memcpy(buf + p, mantissa + 1, ndigits - 1);
+            p += ndigits - 1;
+        }
         buf[p++] = 'e';
         p += sp_svg_number_write_i(buf + p, bufLen - p, eval);
-        return p;
     }
+    return p;
 }
 
 SVGLength::SVGLength()
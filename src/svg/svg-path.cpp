@@ -16,6 +16,9 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <cctype>
+#include <charconv>
+#include <cmath>
 #include <cstring>
 #include <string>
 #include <glib.h> // g_assert()
@@ -29,12 +32,322 @@
 #include "svg/svg.h"
 #include "svg/path-string.h"
 
+namespace {
+
+/**
+ * Front end for the common subset of SVG path data (everything but arcs), used by
+ * sp_svg_read_pathv() ahead of Geom::SVGPathParser. It tokenizes in place without
+ * allocating or throwing and makes the same PathSink calls the general parser would,
+ * so the resulting PathVectors are identical. Whenever it meets something it does not
+ * reproduce exactly (arcs, malformed data, Z snapping) read() returns false and the
+ * caller reparses with the general parser.
+ */
+class FastPathReader
+{
+public:
+    FastPathReader(char const *str, Geom::PathSink &sink)
+        : _p(str)
+        , _sink(sink)
+    {}
+
+    bool read();
+
+private:
+    static bool isWsp(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+    static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+    static bool startsNumber(char c) { return isDigit(c) || c == '.' || c == '-' || c == '+'; }
+
+    void skipWsp()
+    {
+        while (isWsp(*_p)) {
+            ++_p;
+        }
+    }
+
+    bool readNumber(double &value);
+    bool readNumbers(double *values, int count);
+    double coord(double value, Geom::Dim2 axis) const { return _absolute ? value : value + _current[axis]; }
+    Geom::Point point(double const *values) const { return {coord(values[0], Geom::X), coord(values[1], Geom::Y)}; }
+
+    char const *_p;
+    Geom::PathSink &_sink;
+    bool _absolute = true;
+    Geom::Point _current;
+    Geom::Point _initial;
+    Geom::Point _cubic_tangent;
+    Geom::Point _quad_tangent;
+};
+
+/**
+ * Reads a number at the current position. Only the unambiguous forms of the SVG number
+ * grammar are accepted; anything else (e.g. "1." or "1e") is left to the general parser.
+ */
+bool FastPathReader::readNumber(double &value)
+{
+    char const *start = _p;
+    char const *q = _p;
+    if (*q == '+') {
+        start = ++q;
+    } else if (*q == '-') {
+        ++q;
+    }
+    char const *digits = q;
+    while (isDigit(*q)) {
+        ++q;
+    }
+    bool mantissa = q != digits;
+    if (*q == '.') {
+        digits = ++q;
+        while (isDigit(*q)) {
+            ++q;
+        }
+        if (q == digits) {
+            return false;
+        }
+        mantissa = true;
+    }
+    if (!mantissa) {
+        return false;
+    }
+    if (*q == 'e' || *q == 'E') {
+        ++q;
+        if (*q == '+' || *q == '-') {
+            ++q;
+        }
+        digits = q;
+        while (isDigit(*q)) {
+            ++q;
+        }
+        if (q == digits) {
+            return false;
+        }
+    }
+
+#if __cpp_lib_to_chars >= 201611L
+    // from_chars() does not accept a leading '+', which has been skipped above.
+    auto result = std::from_chars(start, q, value, std::chars_format::general);
+    if (result.ec != std::errc() || result.ptr != q) {
+        return false;
+    }
+#else
+    char *end = nullptr;
+    value = g_ascii_strtod(start, &end);
+    if (end != q || !std::isfinite(value)) {
+        return false;
+    }
+#endif
+    _p = q;
+    return true;
+}
+
+/// Reads one parameter group of a command, with the separators the SVG grammar allows between numbers.
+bool FastPathReader::readNumbers(double *values, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) {
+            skipWsp();
+            if (*_p == ',') {
+                ++_p;
+                skipWsp();
+            }
+        }
+        if (!readNumber(values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FastPathReader::read()
+{
+    skipWsp();
+    if (!*_p) {
+        return true;
+    }
+    if (*_p != 'M' && *_p != 'm') {
+        return false;
+    }
+
+    double v[6];
+    while (*_p) {
+        char const cmd = *_p++;
+        _absolute = cmd >= 'A' && cmd <= 'Z';
+        skipWsp();
+
+        if (cmd == 'Z' || cmd == 'z') {
+            // The general parser snaps the last point onto the start when they are merely
+            // near each other; that is rare enough to leave to it.
+            if (_current != _initial && Geom::are_near(_current, _initial, Geom::EPSILON)) {
+                return false;
+            }
+            _sink.closePath();
+            _quad_tangent = _cubic_tangent = _current = _initial;
+            if (*_p && !std::isalpha(static_cast<unsigned char>(*_p))) {
+                return false;
+            }
+            continue;
+        }
+
+        bool first = true;
+        do {
+            switch (cmd) {
+                case 'M':
+                case 'm':
+                    if (!readNumbers(v, 2)) {
+                        return false;
+                    }
+                    if (first) {
+                        _sink.moveTo(_quad_tangent = _cubic_tangent = _current = _initial = point(v));
+                        break;
+                    }
+                    // Subsequent pairs are implicit lineto commands.
+                    _sink.lineTo(_quad_tangent = _cubic_tangent = _current = point(v));
+                    break;
+                case 'L':
+                case 'l':
+                    if (!readNumbers(v, 2)) {
+                        return false;
+                    }
+                    _sink.lineTo(_quad_tangent = _cubic_tangent = _current = point(v));
+                    break;
+                case 'H':
+                case 'h':
+                    if (!readNumbers(v, 1)) {
+                        return false;
+                    }
+                    _current = Geom::Point(coord(v[0], Geom::X), _current[Geom::Y]);
+                    _sink.lineTo(_quad_tangent = _cubic_tangent = _current);
+                    break;
+                case 'V':
+                case 'v':
+                    if (!readNumbers(v, 1)) {
+                        return false;
+                    }
+                    _current = Geom::Point(_current[Geom::X], coord(v[0], Geom::Y));
+                    _sink.lineTo(_quad_tangent = _cubic_tangent = _current);
+                    break;
+                case 'C':
+                case 'c': {
+                    if (!readNumbers(v, 6)) {
+                        return false;
+                    }
+                    Geom::Point c0 = point(v);
+                    Geom::Point c1 = point(v + 2);
+                    Geom::Point p = point(v + 4);
+                    _sink.curveTo(c0, c1, p);
+                    _quad_tangent = _current = p;
+                    _cubic_tangent = p + (p - c1);
+                    break;
+                }
+                case 'S':
+                case 's': {
+                    if (!readNumbers(v, 4)) {
+                        return false;
+                    }
+                    Geom::Point c1 = point(v);
+                    Geom::Point p = point(v + 2);
+                    _sink.curveTo(_cubic_tangent, c1, p);
+                    _quad_tangent = _current = p;
+                    _cubic_tangent = p + (p - c1);
+                    break;
+                }
+                case 'Q':
+                case 'q': {
+                    if (!readNumbers(v, 4)) {
+                        return false;
+                    }
+                    Geom::Point c = point(v);
+                    Geom::Point p = point(v + 2);
+                    _sink.quadTo(c, p);
+                    _cubic_tangent = _current = p;
+                    _quad_tangent = p + (p - c);
+                    break;
+                }
+                case 'T':
+                case 't': {
+                    if (!readNumbers(v, 2)) {
+                        return false;
+                    }
+                    Geom::Point c = _quad_tangent;
+                    Geom::Point p = point(v);
+                    _sink.quadTo(c, p);
+                    _cubic_tangent = _current = p;
+                    _quad_tangent = p + (p - c);
+                    break;
+                }
+                default:
+                    // Arcs and anything unknown.
+                    return false;
+            }
+            first = false;
+
+            skipWsp();
+            if (*_p == ',') {
+                ++_p;
+                skipWsp();
+                if (!startsNumber(*_p)) {
+                    return false;
+                }
+            }
+        } while (startsNumber(*_p));
+
+        if (*_p && !std::isalpha(static_cast<unsigned char>(*_p))) {
+            return false;
+        }
+    }
+    _sink.flush();
+    return true;
+}
+
+/// Counts the subpaths in str so their storage can be reserved; returns -1 if str contains arcs.
+int prescan_subpaths(char const *str)
+{
+    int subpaths = 0;
+    for (char const *p = str; *p; ++p) {
+        switch (*p) {
+            case 'M':
+            case 'm':
+                ++subpaths;
+                break;
+            case 'A':
+            case 'a':
+                return -1;
+            default:
+                break;
+        }
+    }
+    return subpaths;
+}
+
+} // namespace
+
 /*
  * Parses the path in str. When an error is found in the pathstring, this method
  * returns a truncated path up to where the error was found in the pathstring.
  * Returns an empty PathVector when str==NULL
  */
 Geom::PathVector sp_svg_read_pathv(char const * str)
+{
+    Geom::PathVector pathv;
+    if (!str)
+        return pathv;  // return empty pathvector when str == NULL
+
+    int subpaths = prescan_subpaths(str);
+    if (subpaths >= 0) {
+        pathv.reserve(subpaths);
+        Geom::PathBuilder builder(pathv);
+        if (FastPathReader(str, builder).read()) {
+            return pathv;
+        }
+    }
+
+    return sp_svg_read_pathv_generic(str);
+}
+
+/*
+ * Same as sp_svg_read_pathv(), but always goes through Geom::SVGPathParser.
+ */
+Geom::PathVector sp_svg_read_pathv_generic(char const * str)
 {
     Geom::PathVector pathv;
     if (!str)
@@ -37,6 +37,13 @@ unsigned int sp_svg_number_read_d( const char *str, double *val );
  */
 unsigned int sp_svg_number_write_de( char *buf, int bufLen, double val, unsigned int tprec, int min_exp );
 
+/*
+ * Locale independent equivalent of printf's %.<precision><conversion> for conversion 'e', 'f' or
+ * 'g', without trailing zeros. A 'g' precision of 17 or more gives the shortest string that reads
+ * back as val. Returns the length, or 0 if bufLen is too small.
+ */
+unsigned int sp_svg_number_format( char *buf, int bufLen, double val, char conversion, int precision );
+
 /* Length */
 
 /*
@@ -63,6 +70,8 @@ double sp_svg_read_percentage( const char * str, double def );
 /* NB! As paths can be long, we use here dynamic string */
 
 Geom::PathVector sp_svg_read_pathv( char const * str );
+/// Reads path data with Geom::SVGPathParser only; sp_svg_read_pathv() must give identical results.
+Geom::PathVector sp_svg_read_pathv_generic( char const * str );
 std::string sp_svg_write_path(Geom::PathVector const &p);
 std::string sp_svg_write_path(Geom::Path const &p);
 
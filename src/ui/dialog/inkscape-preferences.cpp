@@ -1983,6 +1983,14 @@ void InkscapePreferences::initPageIO()
     _page_io.add_line( false, "", _misc_default_metadata, "",
                            _("Add default metadata to new documents. Default metadata can be set from Document Properties->Metadata."), true);
 
+    _save_document_cache.init( _("Cache large documents for faster re-opening"), "/options/svgload/cache", false);
+    _page_io.add_line( false, "", _save_document_cache, "",
+                           _("Keep a parsed copy of recently opened large documents in the cache directory, so that opening an unchanged file again skips parsing."), true);
+
+    _metafile_style_classes.init( _("Share repeated styles of EMF and WMF imports through classes"), "/options/metafileimport/styleclasses", false);
+    _page_io.add_line( false, "", _metafile_style_classes, "",
+                           _("Move styles that several objects of an imported EMF or WMF file have into style classes, which makes the document smaller."), true);
+
     // Input devices options
     _mouse_sens.init ( "/options/cursortolerance/value", 0.0, 30.0, 1.0, 1.0, 8.0, true, false);
     _page_mouse.add_line( false, _("_Grab sensitivity:"), _mouse_sens, _("pixels (requires restart)"),
@@ -2012,6 +2020,9 @@ void InkscapePreferences::initPageIO()
     _svgoutput_indent.init("/options/svgoutput/indent", 0.0, 1000.0, 1.0, 2.0, 2.0, true, false);
     _page_svgoutput.add_line( true, _("_Indent, spaces:"), _svgoutput_indent, "", _("The number of spaces to use for indenting nested elements; set to 0 for no indentation"), false);
 
+    _svgoutput_compressionlevel.init("/options/svgoutput/compression_level", 0.0, 9.0, 1.0, 1.0, 6.0, true, false);
+    _page_svgoutput.add_line( true, _("Co_mpression level:"), _svgoutput_compressionlevel, "", _("How much to compress compressed SVG (.svgz) files, from 0 (no compression, fastest) to 9 (smallest files, slowest)"), false);
+
     _page_svgoutput.add_group_header( _("Path data"));
 
     int const numPathstringFormat = 3;
@@ -2216,6 +2227,8 @@ void InkscapePreferences::initPageIO()
     _page_autosave.add_line(false, _("_Interval (in minutes):"), _save_autosave_interval, "", _("Interval (in minutes) at which document will be autosaved"), false);
     _save_autosave_max.init("/options/autosave/max", 1.0, 100.0, 1.0, 10.0, 10.0, true, false);
     _page_autosave.add_line(false, _("_Maximum number of autosaves:"), _save_autosave_max, "", _("Maximum number of autosaved files; use this to limit the storage space used"), false);
+    _save_autosave_journal.init(_("Journal changes incrementally"), "/options/autosave/journal", false);
+    _page_autosave.add_line(false, "", _save_autosave_journal, "", _("Instead of saving whole copies, keep a journal of the changes to each document, written in the background. Journals of documents open when Inkscape crashed are recovered on the next start."), false);
 
     // When changing the interval or enabling/disabling the autosave function,
     // update our running configuration
@@ -2501,6 +2514,10 @@ void InkscapePreferences::initPageRendering()
     _rendering_cache_size.init("/options/renderingcache/size", 0.0, 4096.0, 1.0, 32.0, 64.0, true, false);
     _page_rendering.add_line( false, _("Rendering _cache size:"), _rendering_cache_size, C_("mebibyte (2^20 bytes) abbreviation","MiB"), _("Set the amount of memory per document which can be used to store rendered parts of the drawing for later reuse; set to zero to disable caching"), false);
 
+    // export memory limit
+    _rendering_export_memory.init("/options/export/memorylimit", 0.0, 65536.0, 16.0, 256.0, 256.0, true, false);
+    _page_rendering.add_line( false, _("Bitmap _export memory:"), _rendering_export_memory, C_("mebibyte (2^20 bytes) abbreviation","MiB"), _("Memory that exporting a bitmap may use for rendering; large images are rendered in thinner stripes and smaller tiles to stay below it (0 for no limit)"), false);
+
     // rendering tile multiplier
     _rendering_tile_multiplier.init("/options/rendering/tile-multiplier", 1.0, 512.0, 1.0, 16.0, 16.0, true, false);
     _page_rendering.add_line( false, _("Rendering tile multiplier:"), _rendering_tile_multiplier, "",
@@ -3295,6 +3312,9 @@ void InkscapePreferences::initPageSystem()
     _misc_namedicon_delay.init( _("Pre-render named icons"), "/options/iconrender/named_nodelay", false);
     _page_system.add_line( false, "", _misc_namedicon_delay, "",
                            _("When on, named icons will be rendered before displaying the ui. This is for working around bugs in GTK+ named icon notification"), true);
+    _misc_undo_memory.init("/options/undo/memorylimit", 0.0, 65536.0, 16.0, 256.0, 256.0, true, false);
+    _page_system.add_line( false, _("Undo history _memory (MiB):"), _misc_undo_memory, "",
+                           _("Memory the undo history of a document may use before its oldest steps are compacted and then moved to a temporary file (0 for no limit)"), false);
 
     _page_system.add_group_header( _("System info"));
 
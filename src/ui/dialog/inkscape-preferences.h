@@ -325,6 +325,7 @@ protected:
     UI::Widget::PrefCombo       _switcher_style;
     UI::Widget::PrefCheckButton _rendering_image_outline;
     UI::Widget::PrefSpinButton  _rendering_cache_size;
+    UI::Widget::PrefSpinButton  _rendering_export_memory;
     UI::Widget::PrefSpinButton  _rendering_tile_multiplier;
     UI::Widget::PrefSpinButton  _rendering_xray_radius;
     UI::Widget::PrefSpinButton  _rendering_outline_overlay_opacity;
@@ -377,6 +378,7 @@ protected:
 
     // System page
     UI::Widget::PrefSpinButton  _misc_latency_skew;
+    UI::Widget::PrefSpinButton  _misc_undo_memory;
     UI::Widget::PrefSpinButton  _misc_simpl;
     Gtk::Entry                  _sys_user_prefs;
     Gtk::Entry                  _sys_tmp_files;
@@ -439,6 +441,9 @@ protected:
     UI::Widget::PrefSpinButton  _save_autosave_interval;
     UI::Widget::PrefEntry       _save_autosave_path;
     UI::Widget::PrefSpinButton  _save_autosave_max;
+    UI::Widget::PrefCheckButton _save_autosave_journal;
+    UI::Widget::PrefCheckButton _save_document_cache;
+    UI::Widget::PrefCheckButton _metafile_style_classes;
 
     Gtk::ComboBoxText   _cms_display_profile;
     UI::Widget::PrefCheckButton     _cms_from_display;
@@ -485,6 +490,7 @@ protected:
     UI::Widget::PrefSpinButton    _svgoutput_minimumexponent;
     UI::Widget::PrefCheckButton   _svgoutput_inlineattrs;
     UI::Widget::PrefSpinButton    _svgoutput_indent;
+    UI::Widget::PrefSpinButton    _svgoutput_compressionlevel;
     UI::Widget::PrefCombo         _svgoutput_pathformat;
     UI::Widget::PrefCheckButton   _svgoutput_forcerepeatcommands;
 
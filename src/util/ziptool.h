@@ -153,6 +153,16 @@ public:
      */
     virtual void setFileName(const std::string &val);
 
+    /**
+     * The zlib compression level used by write()
+     */
+    virtual void setCompressionLevel(int val);
+
+    /**
+     *
+     */
+    virtual int getCompressionLevel();
+
 
     //######################
     //# U T I L I T Y
@@ -233,6 +243,7 @@ private:
     bool putLong(unsigned long val);
 
     int compressionMethod;
+    int compressionLevel;
 };
 
 
@@ -301,6 +312,16 @@ public:
      */
     virtual void setCompressionMethod(int val);
 
+    /**
+     * The zlib compression level used by finish(), from 0 to 9, or -1 for zlib's default
+     */
+    virtual int getCompressionLevel();
+
+    /**
+     *
+     */
+    virtual void setCompressionLevel(int val);
+
     /**
      *
      */
@@ -371,6 +392,7 @@ private:
     std::string comment;
 
     int compressionMethod;
+    int compressionLevel;
 
     std::vector<unsigned char> compressedData;
     std::vector<unsigned char> uncompressedData;
@@ -419,6 +441,16 @@ public:
      */
     virtual std::string getComment();
 
+    /**
+     * The compression level given to the entries added from now on
+     */
+    virtual void setCompressionLevel(int val);
+
+    /**
+     *
+     */
+    virtual int getCompressionLevel();
+
     /**
      * Return the list of entries currently in this file
      */
@@ -559,6 +591,8 @@ private:
     unsigned long fileBufPos;
 
     std::string comment;
+
+    int compressionLevel;
 };
 
 
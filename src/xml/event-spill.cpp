@@ -0,0 +1,360 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Temporary file holding event logs that are not needed in memory
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "xml/event-spill.h"
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "xml/event.h"
+#include "xml/event-fns.h"
+
+namespace Inkscape {
+namespace XML {
+
+namespace {
+
+/*
+ * A spilled log is its events, oldest first. Each event is a kind byte followed by its
+ * fields. Nodes are 32 bit numbers, 0 for none and n for SpilledLog::nodes[n - 1]. Strings
+ * are a byte telling whether there is one, then a 32 bit length and the bytes.
+ */
+
+class Writer
+{
+public:
+    Writer(SpilledLog &spilled)
+        : _spilled(spilled)
+    {}
+
+    std::string &data() { return _data; }
+
+    void u8(char value) { _data.push_back(value); }
+
+    void u32(uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i) {
+            _data.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    void node(Node *node)
+    {
+        if (!node) {
+            u32(0);
+            return;
+        }
+        auto it = _numbers.find(node);
+        if (it == _numbers.end()) {
+            _spilled.nodes.push_back(node);
+            it = _numbers.emplace(node, _spilled.nodes.size()).first;
+        }
+        u32(it->second);
+    }
+
+    void string(char const *value)
+    {
+        u8(value ? 1 : 0);
+        if (value) {
+            size_t len = strlen(value);
+            u32(len);
+            _data.append(value, len);
+        }
+    }
+
+    void quark(GQuark value) { string(g_quark_to_string(value)); }
+
+private:
+    SpilledLog &_spilled;
+    std::string _data;
+    std::unordered_map<Node *, uint32_t> _numbers;
+};
+
+class Reader
+{
+public:
+    Reader(SpilledLog const &spilled, std::string const &data)
+        : _spilled(spilled)
+        , _pos(data.data())
+        , _end(data.data() + data.size())
+    {}
+
+    bool ok() const { return _ok; }
+    bool atEnd() const { return _pos == _end; }
+    void fail() { _ok = false; }
+
+    char u8()
+    {
+        if (!_ok || _pos == _end) {
+            _ok = false;
+            return 0;
+        }
+        return *_pos++;
+    }
+
+    uint32_t u32()
+    {
+        if (!_ok || _end - _pos < 4) {
+            _ok = false;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(*_pos++)) << (8 * i);
+        }
+        return value;
+    }
+
+    Node *node()
+    {
+        uint32_t number = u32();
+        if (number > _spilled.nodes.size()) {
+            _ok = false;
+            return nullptr;
+        }
+        return number ? _spilled.nodes[number - 1] : nullptr;
+    }
+
+    /// A node that must be there.
+    Node *someNode()
+    {
+        Node *result = node();
+        if (!result) {
+            _ok = false;
+        }
+        return result;
+    }
+
+    Util::ptr_shared string()
+    {
+        if (!u8()) {
+            return Util::ptr_shared();
+        }
+        uint32_t len = u32();
+        if (!_ok || static_cast<size_t>(_end - _pos) < len) {
+            _ok = false;
+            return Util::ptr_shared();
+        }
+        auto value = Util::share_string(_pos, len);
+        _pos += len;
+        return value;
+    }
+
+    GQuark quark()
+    {
+        auto value = string();
+        return value ? g_quark_from_string(value) : 0;
+    }
+
+private:
+    SpilledLog const &_spilled;
+    char const *_pos;
+    char const *_end;
+    bool _ok = true;
+};
+
+} // namespace
+
+EventSpill::~EventSpill()
+{
+    if (_file) {
+        fclose(_file);
+    }
+    if (!_path.empty()) {
+        g_unlink(_path.c_str());
+    }
+}
+
+bool EventSpill::open()
+{
+    if (_file || _failed) {
+        return _file != nullptr;
+    }
+    gchar *path = nullptr;
+    int fd = g_file_open_tmp("inkscape-undo-XXXXXX", &path, nullptr);
+    if (fd == -1) {
+        g_warning("Could not create a temporary file for the undo history.");
+        _failed = true;
+        return false;
+    }
+    _file = fdopen(fd, "w+b");
+    _failed = !_file;
+    _path = path;
+    g_free(path);
+#ifndef _WIN32
+    // Nobody else needs to see it, and this way it goes away even after a crash.
+    g_unlink(_path.c_str());
+    _path.clear();
+#endif
+    return _file != nullptr;
+}
+
+std::unique_ptr<SpilledLog> EventSpill::spill(Event *log)
+{
+    if (!log || !open()) {
+        return nullptr;
+    }
+
+    std::vector<Event *> events;
+    for (Event *action = log; action; action = action->next) {
+        events.push_back(action);
+    }
+
+    auto spilled = std::make_unique<SpilledLog>();
+    Writer out(*spilled);
+    for (auto it = events.rbegin(); it != events.rend(); ++it) {
+        Event *action = *it;
+        if (auto add = dynamic_cast<EventAdd *>(action)) {
+            out.u8('a');
+            out.node(add->repr);
+            out.node(add->child);
+            out.node(add->ref);
+        } else if (auto del = dynamic_cast<EventDel *>(action)) {
+            out.u8('d');
+            out.node(del->repr);
+            out.node(del->child);
+            out.node(del->ref);
+        } else if (auto chg_attr = dynamic_cast<EventChgAttr *>(action)) {
+            out.u8('c');
+            out.node(chg_attr->repr);
+            out.quark(chg_attr->key);
+            out.string(chg_attr->oldval);
+            out.string(chg_attr->newval);
+        } else if (auto chg_content = dynamic_cast<EventChgContent *>(action)) {
+            out.u8('t');
+            out.node(chg_content->repr);
+            out.string(chg_content->oldval);
+            out.string(chg_content->newval);
+        } else if (auto chg_order = dynamic_cast<EventChgOrder *>(action)) {
+            out.u8('o');
+            out.node(chg_order->repr);
+            out.node(chg_order->child);
+            out.node(chg_order->oldref);
+            out.node(chg_order->newref);
+        } else if (auto chg_name = dynamic_cast<EventChgElementName *>(action)) {
+            out.u8('n');
+            out.node(chg_name->repr);
+            out.quark(chg_name->old_name);
+            out.quark(chg_name->new_name);
+        } else {
+            g_warning("Unknown kind of event, keeping the log in memory.");
+            return nullptr;
+        }
+    }
+
+    std::string const &data = out.data();
+    spilled->offset = fseek(_file, 0, SEEK_END) == 0 ? ftell(_file) : -1;
+    spilled->length = data.size();
+    if (spilled->offset < 0 || fwrite(data.data(), 1, data.size(), _file) != data.size()) {
+        g_warning("Could not write the undo history to a temporary file.");
+        _failed = true;
+        return nullptr;
+    }
+
+    sp_repr_free_log(log);
+    return spilled;
+}
+
+Event *EventSpill::restore(SpilledLog const &spilled)
+{
+    std::string data(spilled.length, '\0');
+    if (!_file || fseek(_file, spilled.offset, SEEK_SET) != 0 ||
+        fread(&data[0], 1, data.size(), _file) != data.size()) {
+        g_warning("Could not read the undo history back from the temporary file.");
+        return nullptr;
+    }
+
+    Event *log = nullptr;
+    Reader in(spilled, data);
+    while (in.ok() && !in.atEnd()) {
+        char kind = in.u8();
+        Node *repr = in.someNode();
+        switch (kind) {
+            case 'a': {
+                Node *child = in.someNode();
+                Node *ref = in.node();
+                if (in.ok()) {
+                    log = new EventAdd(repr, child, ref, log);
+                }
+                break;
+            }
+            case 'd': {
+                Node *child = in.someNode();
+                Node *ref = in.node();
+                if (in.ok()) {
+                    log = new EventDel(repr, child, ref, log);
+                }
+                break;
+            }
+            case 'c': {
+                GQuark key = in.quark();
+                auto oldval = in.string();
+                auto newval = in.string();
+                if (in.ok()) {
+                    log = new EventChgAttr(repr, key, oldval, newval, log);
+                }
+                break;
+            }
+            case 't': {
+                auto oldval = in.string();
+                auto newval = in.string();
+                if (in.ok()) {
+                    log = new EventChgContent(repr, oldval, newval, log);
+                }
+                break;
+            }
+            case 'o': {
+                Node *child = in.someNode();
+                Node *oldref = in.node();
+                Node *newref = in.node();
+                if (in.ok()) {
+                    log = new EventChgOrder(repr, child, oldref, newref, log);
+                }
+                break;
+            }
+            case 'n': {
+                GQuark old_name = in.quark();
+                GQuark new_name = in.quark();
+                if (in.ok()) {
+                    log = new EventChgElementName(repr, old_name, new_name, log);
+                }
+                break;
+            }
+            default:
+                in.fail();
+                break;
+        }
+    }
+
+    if (!in.ok()) {
+        g_warning("The undo history read back from the temporary file is damaged.");
+        sp_repr_free_log(log);
+        return nullptr;
+    }
+    return log;
+}
+
+} // namespace XML
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Temporary file holding event logs that are not needed in memory
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_XML_EVENT_SPILL_H
+#define SEEN_INKSCAPE_XML_EVENT_SPILL_H
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "inkgc/gc-alloc.h"
+
+namespace Inkscape {
+namespace XML {
+
+class Event;
+class Node;
+
+/**
+ * An event log written out by EventSpill.
+ */
+struct SpilledLog
+{
+    long offset;
+    size_t length;
+    /// The nodes the log refers to, which must stay the same objects.
+    std::vector<Node *, GC::Alloc<Node *, GC::MANUAL>> nodes;
+};
+
+/**
+ * Moves event logs to a temporary file and back, for undo history that is unlikely to be
+ * needed soon. The events and the attribute values and contents they hold go to the file;
+ * the nodes they refer to stay in memory. The file is removed when the EventSpill is
+ * destroyed.
+ */
+class EventSpill
+{
+public:
+    EventSpill() = default;
+    ~EventSpill();
+
+    EventSpill(EventSpill const &) = delete;
+    EventSpill &operator=(EventSpill const &) = delete;
+
+    /**
+     * Writes a non-empty log to the file and frees it.
+     * @return Where the log went, or nullptr if it could not be written. The log is left
+     *         alone in that case.
+     */
+    std::unique_ptr<SpilledLog> spill(Event *log);
+
+    /**
+     * Reads a spilled log back.
+     * @return The log, or nullptr if it could not be read.
+     */
+    Event *restore(SpilledLog const &spilled);
+
+private:
+    bool open();
+
+    FILE *_file = nullptr;
+    std::string _path;
+    bool _failed = false; ///< Stop trying after the first error.
+};
+
+} // namespace XML
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_XML_EVENT_SPILL_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
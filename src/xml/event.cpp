@@ -16,6 +16,9 @@
 
 #include <glib.h> // g_assert()
 #include <cstdio>
+#include <cstring>
+#include <map>
+#include <utility>
 
 #include "event.h"
 #include "event-fns.h"
@@ -294,6 +297,138 @@ sp_repr_free_log (Inkscape::XML::Event *log)
 
 namespace {
 
+// Rough cost of a node and of an attribute record, on top of their strings.
+size_t const NODE_MEMORY = 128;
+size_t const ATTRIBUTE_MEMORY = 32;
+
+size_t string_memory(char const *string)
+{
+    return string ? strlen(string) + 1 : 0;
+}
+
+size_t subtree_memory(Inkscape::XML::Node const *node)
+{
+    size_t total = NODE_MEMORY + string_memory(node->content());
+    for (auto &attr : node->attributeList()) {
+        total += ATTRIBUTE_MEMORY + string_memory(attr.value);
+    }
+    for (auto child = node->firstChild(); child; child = child->next()) {
+        total += subtree_memory(child);
+    }
+    return total;
+}
+
+bool same_string(char const *a, char const *b)
+{
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+} // namespace
+
+/**
+ * Estimates the memory kept alive by an event log: the events, the attribute values and
+ * contents they hold, and the subtrees that they alone keep from being collected.
+ */
+size_t
+sp_repr_log_memory (Inkscape::XML::Event const *log)
+{
+    size_t total = 0;
+    for (auto action = log; action; action = action->next) {
+        if (auto chg_attr = dynamic_cast<Inkscape::XML::EventChgAttr const *>(action)) {
+            total += sizeof(*chg_attr) + string_memory(chg_attr->oldval) + string_memory(chg_attr->newval);
+        } else if (auto chg_content = dynamic_cast<Inkscape::XML::EventChgContent const *>(action)) {
+            total += sizeof(*chg_content) + string_memory(chg_content->oldval) + string_memory(chg_content->newval);
+        } else if (auto del = dynamic_cast<Inkscape::XML::EventDel const *>(action)) {
+            total += sizeof(*del);
+            if (!del->child->parent()) {
+                total += subtree_memory(del->child);
+            }
+        } else {
+            total += sizeof(Inkscape::XML::EventAdd);
+        }
+    }
+    return total;
+}
+
+/**
+ * Combines all the changes to the same attribute, content or element name in a log, not just
+ * consecutive ones as Event::optimizeOne() does, and drops the changes that end where they
+ * started. Changes of this kind do not depend on anything else in the log, so they can be
+ * moved to the place of the latest one.
+ *
+ * @return The compacted log, which may have changed
+ */
+Inkscape::XML::Event *
+sp_repr_compact_log (Inkscape::XML::Event *log)
+{
+    using namespace Inkscape::XML;
+
+    // Latest change seen so far to each attribute, content or name.
+    std::map<std::pair<Node *, GQuark>, EventChgAttr *> attrs;
+    std::map<Node *, EventChgContent *> contents;
+    std::map<Node *, EventChgElementName *> names;
+
+    Event **prev_ptr = &log;
+    while (Event *action = *prev_ptr) {
+        bool merged = false;
+        if (auto chg_attr = dynamic_cast<EventChgAttr *>(action)) {
+            auto &latest = attrs[{chg_attr->repr, chg_attr->key}];
+            if (latest) {
+                latest->oldval = chg_attr->oldval;
+                merged = true;
+            } else {
+                latest = chg_attr;
+            }
+        } else if (auto chg_content = dynamic_cast<EventChgContent *>(action)) {
+            auto &latest = contents[chg_content->repr];
+            if (latest) {
+                latest->oldval = chg_content->oldval;
+                merged = true;
+            } else {
+                latest = chg_content;
+            }
+        } else if (auto chg_name = dynamic_cast<EventChgElementName *>(action)) {
+            auto &latest = names[chg_name->repr];
+            if (latest) {
+                latest->old_name = chg_name->old_name;
+                merged = true;
+            } else {
+                latest = chg_name;
+            }
+        }
+
+        if (merged) {
+            *prev_ptr = action->next;
+            delete action;
+        } else {
+            prev_ptr = &action->next;
+        }
+    }
+
+    prev_ptr = &log;
+    while (Event *action = *prev_ptr) {
+        bool noop = false;
+        if (auto chg_attr = dynamic_cast<EventChgAttr *>(action)) {
+            noop = same_string(chg_attr->oldval, chg_attr->newval);
+        } else if (auto chg_content = dynamic_cast<EventChgContent *>(action)) {
+            noop = same_string(chg_content->oldval, chg_content->newval);
+        } else if (auto chg_name = dynamic_cast<EventChgElementName *>(action)) {
+            noop = chg_name->old_name == chg_name->new_name;
+        }
+
+        if (noop) {
+            *prev_ptr = action->next;
+            delete action;
+        } else {
+            prev_ptr = &action->next;
+        }
+    }
+
+    return log;
+}
+
+namespace {
+
 template <typename T> struct ActionRelations;
 
 template <>
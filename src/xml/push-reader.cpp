@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Builds an XML document from text that is handed over in pieces
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "xml/push-reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Inkscape {
+namespace XML {
+
+namespace {
+
+char const *chars(xmlChar const *text)
+{
+    return reinterpret_cast<char const *>(text);
+}
+
+} // namespace
+
+PushReader::PushReader(char const *default_ns)
+    : _builder(default_ns)
+{
+    xmlSAXHandler sax;
+    memset(&sax, 0, sizeof(sax));
+    xmlSAXVersion(&sax, 2);
+    sax.startElementNs = startElement;
+    sax.endElementNs = endElement;
+    sax.characters = characters;
+    sax.ignorableWhitespace = characters;
+    sax.cdataBlock = cdataBlock;
+    sax.comment = comment;
+    sax.processingInstruction = processingInstruction;
+
+    _ctxt = xmlCreatePushParserCtxt(&sax, this, nullptr, 0, nullptr);
+    // The text is made by Inkscape, so entities are expanded as they are for sp_repr_read_mem().
+    xmlCtxtUseOptions(_ctxt, XML_PARSE_HUGE | XML_PARSE_RECOVER | XML_PARSE_NONET | XML_PARSE_NOENT);
+}
+
+PushReader::~PushReader()
+{
+    if (_ctxt) {
+        if (_ctxt->myDoc) {
+            xmlFreeDoc(_ctxt->myDoc);
+        }
+        xmlFreeParserCtxt(_ctxt);
+    }
+}
+
+void PushReader::write(char const *text, size_t length)
+{
+    // libxml2 takes the length as an int.
+    while (length > 0) {
+        int chunk = std::min<size_t>(length, 1 << 30);
+        xmlParseChunk(_ctxt, text, chunk, 0);
+        text += chunk;
+        length -= chunk;
+    }
+}
+
+Document *PushReader::finish()
+{
+    xmlParseChunk(_ctxt, nullptr, 0, 1);
+    return _builder.finish();
+}
+
+void PushReader::startElement(void *data, xmlChar const *localname, xmlChar const *prefix,
+                              xmlChar const *uri, int /*nb_namespaces*/, xmlChar const ** /*namespaces*/,
+                              int nb_attributes, int /*nb_defaulted*/, xmlChar const **attributes)
+{
+    auto &builder = static_cast<PushReader *>(data)->_builder;
+    builder.startElement(ReprBuilder::qualifiedName(chars(uri), chars(prefix), chars(localname)).c_str());
+    for (int i = 0; i < nb_attributes; ++i) {
+        // localname, prefix, URI, start and end of the value
+        xmlChar const **attribute = attributes + 5 * i;
+        std::string name = ReprBuilder::qualifiedName(chars(attribute[2]), chars(attribute[1]),
+                                                      chars(attribute[0]));
+        std::string value(chars(attribute[3]), chars(attribute[4]));
+        builder.setAttribute(name.c_str(), value.c_str());
+    }
+}
+
+void PushReader::endElement(void *data, xmlChar const * /*localname*/, xmlChar const * /*prefix*/,
+                            xmlChar const * /*uri*/)
+{
+    static_cast<PushReader *>(data)->_builder.endElement();
+}
+
+void PushReader::characters(void *data, xmlChar const *text, int length)
+{
+    static_cast<PushReader *>(data)->_builder.addText(chars(text), length, false);
+}
+
+void PushReader::cdataBlock(void *data, xmlChar const *text, int length)
+{
+    static_cast<PushReader *>(data)->_builder.addText(chars(text), length, true);
+}
+
+void PushReader::comment(void *data, xmlChar const *text)
+{
+    static_cast<PushReader *>(data)->_builder.addComment(chars(text));
+}
+
+void PushReader::processingInstruction(void *data, xmlChar const *target, xmlChar const *text)
+{
+    static_cast<PushReader *>(data)->_builder.addPI(chars(target), chars(text));
+}
+
+} // namespace XML
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
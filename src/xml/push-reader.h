@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Builds an XML document from text that is handed over in pieces
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_XML_PUSH_READER_H
+#define SEEN_INKSCAPE_XML_PUSH_READER_H
+
+#include <cstddef>
+#include <string>
+
+#include <libxml/parser.h>
+
+#include "xml/repr-builder.h"
+
+namespace Inkscape {
+namespace XML {
+
+class Document;
+
+/**
+ * Reads a document from XML text that is produced piece by piece, for example by an importer
+ * converting one record at a time. Nodes are created as soon as their text has been written,
+ * so neither the whole text nor a libxml2 tree of it is ever held.
+ *
+ * The pieces may split the text anywhere. The nodes are built by a ReprBuilder, so the document
+ * is read like sp_repr_read_mem() reads it with the same default namespace.
+ */
+class PushReader
+{
+public:
+    explicit PushReader(char const *default_ns);
+    ~PushReader();
+    PushReader(PushReader const &) = delete;
+    PushReader &operator=(PushReader const &) = delete;
+
+    /// Parses the next piece of the text.
+    void write(char const *text, size_t length);
+    void write(std::string const &text) { write(text.data(), text.size()); }
+
+    /**
+     * Parses the end of the text and hands over the document.
+     * @return The document, or nullptr if it has no root element.
+     */
+    Document *finish();
+
+private:
+    static void startElement(void *data, xmlChar const *localname, xmlChar const *prefix,
+                             xmlChar const *uri, int nb_namespaces, xmlChar const **namespaces,
+                             int nb_attributes, int nb_defaulted, xmlChar const **attributes);
+    static void endElement(void *data, xmlChar const *localname, xmlChar const *prefix,
+                           xmlChar const *uri);
+    static void characters(void *data, xmlChar const *text, int length);
+    static void cdataBlock(void *data, xmlChar const *text, int length);
+    static void comment(void *data, xmlChar const *text);
+    static void processingInstruction(void *data, xmlChar const *target, xmlChar const *text);
+
+    xmlParserCtxtPtr _ctxt = nullptr;
+    ReprBuilder _builder;
+};
+
+} // namespace XML
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_XML_PUSH_READER_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -54,6 +54,24 @@ static bool href_needs_rebasing(char const *href)
     return !scheme || g_str_equal(scheme.get(), "file");
 }
 
+bool Inkscape::XML::href_attrs_need_rebasing(gchar const *const old_abs_base,
+                                             gchar const *const new_abs_base,
+                                             const AttributeVector &attributes)
+{
+    if (old_abs_base == new_abs_base) {
+        return false;
+    }
+
+    static GQuark const href_key = g_quark_from_static_string("xlink:href");
+
+    for (auto const &attr : attributes) {
+        if (attr.key == href_key) {
+            return href_needs_rebasing(attr.value.pointer());
+        }
+    }
+    return false;
+}
+
 AttributeVector
 Inkscape::XML::rebase_href_attrs(gchar const *const old_abs_base,
                                  gchar const *const new_abs_base,
@@ -38,6 +38,15 @@ AttributeVector rebase_href_attrs(
     char const *new_abs_base,
     const AttributeVector & attributes);
 
+/**
+ * Returns false if rebase_href_attrs() would return \a attributes unchanged.
+ * Unlike rebase_href_attrs() this never allocates from the garbage collected heap.
+ */
+bool href_attrs_need_rebasing(
+    char const *old_abs_base,
+    char const *new_abs_base,
+    const AttributeVector & attributes);
+
 
 // /**
 //  * .
@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Creates the nodes of a document in the order a parser reports them
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "xml/repr-builder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glib.h>
+
+#include "attribute-rel-util.h"
+#include "extension/extension.h"
+#include "preferences.h"
+#include "xml/node.h"
+#include "xml/repr.h"
+#include "xml/simple-document.h"
+
+namespace Inkscape {
+namespace XML {
+
+namespace {
+
+bool has_prefix(GQuark code)
+{
+    return strchr(g_quark_to_string(code), ':') != nullptr;
+}
+
+void promote_to_namespace(Node *repr, char const *prefix)
+{
+    if (repr->type() == NodeType::ELEMENT_NODE) {
+        GQuark code = repr->code();
+        if (!has_prefix(code)) {
+            gchar *svg_name = g_strconcat(prefix, ":", g_quark_to_string(code), nullptr);
+            repr->setCodeUnsafe(g_quark_from_string(svg_name));
+            g_free(svg_name);
+        }
+        for (Node *child = repr->firstChild(); child; child = child->next()) {
+            promote_to_namespace(child, prefix);
+        }
+    }
+}
+
+} // namespace
+
+ReprBuilder::ReprBuilder(char const *default_ns)
+    : _default_ns(default_ns ? default_ns : "")
+    , _has_default_ns(default_ns != nullptr)
+    , _doc(new SimpleDocument())
+{
+}
+
+ReprBuilder::~ReprBuilder()
+{
+    if (_doc) {
+        GC::release(_doc);
+    }
+}
+
+std::string ReprBuilder::qualifiedName(char const *uri, char const *prefix, char const *localname)
+{
+    std::string name;
+    if (uri) {
+        name = sp_xml_ns_uri_prefix(uri, prefix);
+        name += ':';
+    }
+    name += localname;
+    return name;
+}
+
+void ReprBuilder::startElement(char const *name)
+{
+    _flushText();
+    if (_skipping() || (_open.empty() && _root)) {
+        _skip_depth++;
+        return;
+    }
+
+    Node *repr = _doc->createElement(name);
+    _append(repr);
+    if (!_root) {
+        _root = repr;
+    }
+    _open.push_back(repr);
+    _preserve.push_back(!_preserve.empty() && _preserve.back());
+    GC::release(repr);
+}
+
+void ReprBuilder::setAttribute(char const *name, char const *value)
+{
+    if (_skipping() || _open.empty()) {
+        return;
+    }
+    if (!strcmp(name, "xml:space")) {
+        if (!strcmp(value, "preserve")) {
+            _preserve.back() = true;
+        } else if (!strcmp(value, "default")) {
+            _preserve.back() = false;
+        }
+    }
+    _open.back()->setAttribute(name, value);
+}
+
+void ReprBuilder::endElement()
+{
+    _flushText();
+    if (_skipping()) {
+        _skip_depth--;
+    } else if (!_open.empty()) {
+        _open.pop_back();
+        _preserve.pop_back();
+    }
+}
+
+/**
+ * Parsers may report a text in several parts, so it is collected until the next node.
+ */
+void ReprBuilder::addText(char const *text, size_t length, bool is_cdata)
+{
+    if (is_cdata != _text_is_cdata) {
+        _flushText();
+        _text_is_cdata = is_cdata;
+    }
+    _text.append(text, length);
+}
+
+void ReprBuilder::addComment(char const *text)
+{
+    _flushText();
+    if (!_skipping()) {
+        Node *repr = _doc->createComment(text ? text : "");
+        _append(repr);
+        GC::release(repr);
+    }
+}
+
+void ReprBuilder::addPI(char const *target, char const *text)
+{
+    _flushText();
+    if (!_skipping()) {
+        Node *repr = _doc->createPI(target, text ? text : "");
+        _append(repr);
+        GC::release(repr);
+    }
+}
+
+Document *ReprBuilder::finish()
+{
+    _flushText();
+
+    Document *doc = _doc;
+    _doc = nullptr;
+    if (!_root) {
+        GC::release(doc);
+        return nullptr;
+    }
+
+    /* promote elements of some XML documents that don't use namespaces
+     * into their default namespace */
+    if (_has_default_ns && !strchr(_root->name(), ':')) {
+        if (_default_ns == SP_SVG_NS_URI) {
+            promote_to_namespace(_root, "svg");
+        }
+        if (_default_ns == INKSCAPE_EXTENSION_URI) {
+            promote_to_namespace(_root, INKSCAPE_EXTENSION_NS_NC);
+        }
+    }
+
+    // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
+    // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
+    // icons.svg). How can one tell if a file is internal?
+    if (!strcmp(_root->name(), "svg:svg") &&
+        Inkscape::Preferences::get()->getBool("/options/svgoutput/check_on_reading")) {
+        sp_attribute_clean_tree(_root);
+    }
+    return doc;
+}
+
+void ReprBuilder::_append(Node *node)
+{
+    if (_open.empty()) {
+        _doc->appendChild(node);
+    } else {
+        _open.back()->appendChild(node);
+    }
+}
+
+void ReprBuilder::_flushText()
+{
+    if (_text.empty()) {
+        return;
+    }
+    // Note: this only handles XML's rules for white space. SVG's specific rules are handled
+    // in sp-string.cpp.
+    bool preserve = !_preserve.empty() && _preserve.back();
+    bool blank = std::all_of(_text.begin(), _text.end(), [](char c) { return g_ascii_isspace(c); });
+    if (!_open.empty() && !_skipping() && (preserve || !blank)) {
+        // The original node type is kept so that CDATA sections are preserved on output.
+        Node *repr = _doc->createTextNode(_text.c_str(), _text_is_cdata);
+        _open.back()->appendChild(repr);
+        GC::release(repr);
+    }
+    _text.clear();
+}
+
+} // namespace XML
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
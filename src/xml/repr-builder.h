@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Creates the nodes of a document in the order a parser reports them
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_XML_REPR_BUILDER_H
+#define SEEN_INKSCAPE_XML_REPR_BUILDER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Inkscape {
+namespace XML {
+
+class Document;
+class Node;
+
+/**
+ * Builds a document from the elements, text, comments and processing instructions a parser
+ * reports, in document order. The tree reader, the streaming reader and PushReader all build
+ * through it, so that they agree on names, white space and what is dropped:
+ *
+ * - Text outside the root element is dropped, and so is text that is only white space, unless
+ *   xml:space says otherwise. Adjacent pieces of text are joined.
+ * - Elements after the root element are dropped.
+ * - Elements of documents without namespaces are promoted into the default namespace, and SVG
+ *   documents are cleaned if the preferences ask for it.
+ */
+class ReprBuilder
+{
+public:
+    explicit ReprBuilder(char const *default_ns);
+    ~ReprBuilder();
+    ReprBuilder(ReprBuilder const &) = delete;
+    ReprBuilder &operator=(ReprBuilder const &) = delete;
+
+    /**
+     * The name Inkscape uses for a name in the namespace uri, which may be nullptr: the local
+     * name with the prefix Inkscape knows the namespace by.
+     */
+    static std::string qualifiedName(char const *uri, char const *prefix, char const *localname);
+
+    /// Opens an element, which the following attributes, nodes and text go into.
+    void startElement(char const *name);
+    /// Sets an attribute of the element that was opened last.
+    void setAttribute(char const *name, char const *value);
+    void endElement();
+
+    void addText(char const *text, size_t length, bool is_cdata);
+    void addComment(char const *text);
+    void addPI(char const *target, char const *text);
+
+    /**
+     * Finishes the document and hands it over.
+     * @return The document, or nullptr if it has no root element.
+     */
+    Document *finish();
+
+private:
+    void _append(Node *node);
+    void _flushText();
+    bool _skipping() const { return _skip_depth > 0; }
+
+    std::string _default_ns;
+    bool _has_default_ns;
+    Document *_doc;
+    Node *_root = nullptr;
+    std::vector<Node *> _open;     // Elements whose end tag has not been read yet
+    std::vector<bool> _preserve;   // Whether white space is kept in each of the open elements
+    unsigned _skip_depth = 0;      // Depth in elements after the root element
+    std::string _text;             // Text read since the last node
+    bool _text_is_cdata = false;
+};
+
+} // namespace XML
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_XML_REPR_BUILDER_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,502 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Cache of parsed XML documents, for re-opening large files quickly
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "xml/repr-cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <glibmm/miscutils.h>
+
+#include <2geom/bezier-curve.h>
+
+#include "inkscape-version.h"
+#include "object/preparsed-attributes.h"
+#include "preferences.h"
+#include "xml/node.h"
+#include "xml/simple-document.h"
+#include "xml/text-node.h"
+
+/*
+ * A cache file is MAGIC, the key, the number of children of the document node and those
+ * children. A node is its NodeType as one byte, followed by
+ *   element: name, number of attributes, (key value)*, parsed flags byte, [path], [transform],
+ *            number of children, child*
+ *   text: CDATA flag byte, content
+ *   comment: content
+ *   PI: target, content
+ * The parsed flags tell whether the "d" attribute (PARSED_PATH) and the "transform" attribute
+ * (PARSED_TRANSFORM) follow parsed, as PreparsedAttributes has them. A path is the number of
+ * subpaths, and for each a closed flag byte, the initial point, the number of curves and for
+ * each curve its order as one byte and its control points after the first. A transform is six
+ * doubles. Numbers are 32 bit little endian, doubles 64 bit little endian. Strings are a number
+ * of bytes, the bytes and a NUL, so that they can be used right from the mapped file.
+ */
+
+namespace Inkscape {
+namespace XML {
+
+namespace {
+
+char const MAGIC[] = "INKXMLC2";
+size_t const MAGIC_LEN = sizeof(MAGIC) - 1;
+
+enum ParsedFlags : char {
+    PARSED_PATH = 1,
+    PARSED_TRANSFORM = 2
+};
+
+std::string cache_directory()
+{
+    std::string dir = Inkscape::Preferences::get()->getString("/options/svgload/cache_dir");
+    if (!dir.empty()) {
+        return dir;
+    }
+    return Glib::build_filename(Glib::get_user_cache_dir(), "inkscape", "documents");
+}
+
+std::string cache_path(std::string const &key)
+{
+    return Glib::build_filename(cache_directory(), key + ".xmlcache");
+}
+
+void put_u32(std::string &out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+void put_double(std::string &out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+    }
+}
+
+void put_string(std::string &out, char const *value)
+{
+    size_t len = value ? strlen(value) : 0;
+    put_u32(out, len);
+    out.append(value ? value : "", len);
+    out.push_back('\0');
+}
+
+void put_point(std::string &out, Geom::Point const &point)
+{
+    put_double(out, point[Geom::X]);
+    put_double(out, point[Geom::Y]);
+}
+
+/// Whether put_path() can store all the curves of pathv. Elliptical arcs cannot be rebuilt
+/// exactly from what they keep, so such paths are left to be parsed when they are read.
+bool can_put_path(Geom::PathVector const &pathv)
+{
+    for (auto const &path : pathv) {
+        for (size_t i = 0; i < path.size_open(); ++i) {
+            auto bezier = dynamic_cast<Geom::BezierCurve const *>(&path[i]);
+            if (!bezier || bezier->order() < 1 || bezier->order() > 3) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void put_path(std::string &out, Geom::PathVector const &pathv)
+{
+    put_u32(out, pathv.size());
+    for (auto const &path : pathv) {
+        out.push_back(path.closed() ? 1 : 0);
+        put_point(out, path.initialPoint());
+        put_u32(out, path.size_open());
+        for (size_t i = 0; i < path.size_open(); ++i) {
+            auto &bezier = static_cast<Geom::BezierCurve const &>(path[i]);
+            out.push_back(static_cast<char>(bezier.order()));
+            for (unsigned j = 1; j <= bezier.order(); ++j) {
+                put_point(out, bezier.controlPoint(j));
+            }
+        }
+    }
+}
+
+void put_subtree(std::string &out, Node const *node, PreparsedAttributes const *preparsed)
+{
+    out.push_back(static_cast<char>(node->type()));
+    switch (node->type()) {
+        case NodeType::ELEMENT_NODE: {
+            put_string(out, node->name());
+            put_u32(out, node->attributeList().size());
+            for (auto &attr : node->attributeList()) {
+                put_string(out, g_quark_to_string(attr.key));
+                put_string(out, attr.value);
+            }
+            auto pathv = preparsed ? preparsed->findPath(node) : nullptr;
+            if (pathv && !can_put_path(*pathv)) {
+                pathv = nullptr;
+            }
+            auto transform = preparsed ? preparsed->findTransform(node) : nullptr;
+            out.push_back((pathv ? PARSED_PATH : 0) | (transform ? PARSED_TRANSFORM : 0));
+            if (pathv) {
+                put_path(out, *pathv);
+            }
+            if (transform) {
+                for (int i = 0; i < 6; ++i) {
+                    put_double(out, (*transform)[i]);
+                }
+            }
+            put_u32(out, node->childCount());
+            for (auto child = node->firstChild(); child; child = child->next()) {
+                put_subtree(out, child, preparsed);
+            }
+            break;
+        }
+        case NodeType::TEXT_NODE: {
+            auto text = dynamic_cast<TextNode const *>(node);
+            out.push_back(text && text->is_CData() ? 1 : 0);
+            put_string(out, node->content());
+            break;
+        }
+        case NodeType::COMMENT_NODE:
+            put_string(out, node->content());
+            break;
+        case NodeType::PI_NODE:
+            put_string(out, node->name());
+            put_string(out, node->content());
+            break;
+        case NodeType::DOCUMENT_NODE:
+            g_assert_not_reached();
+            break;
+    }
+}
+
+class Reader
+{
+public:
+    Reader(char const *data, size_t len)
+        : _pos(data)
+        , _end(data + len)
+    {}
+
+    bool ok() const { return _ok; }
+    bool atEnd() const { return _pos == _end; }
+    void fail() { _ok = false; }
+
+    char u8()
+    {
+        if (!_ok || _pos == _end) {
+            _ok = false;
+            return 0;
+        }
+        return *_pos++;
+    }
+
+    uint32_t u32()
+    {
+        if (!_ok || _end - _pos < 4) {
+            _ok = false;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(*_pos++)) << (8 * i);
+        }
+        return value;
+    }
+
+    double f64()
+    {
+        if (!_ok || _end - _pos < 8) {
+            _ok = false;
+            return 0;
+        }
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) {
+            bits |= static_cast<uint64_t>(static_cast<unsigned char>(*_pos++)) << (8 * i);
+        }
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    Geom::Point point()
+    {
+        double x = f64();
+        return Geom::Point(x, f64());
+    }
+
+    /// Points into the data, which ends the string with a NUL.
+    char const *string()
+    {
+        uint32_t len = u32();
+        if (!_ok || static_cast<size_t>(_end - _pos) <= len || _pos[len] != '\0') {
+            _ok = false;
+            return "";
+        }
+        char const *value = _pos;
+        _pos += len + 1;
+        return value;
+    }
+
+private:
+    char const *_pos;
+    char const *_end;
+    bool _ok = true;
+};
+
+Geom::PathVector read_path(Reader &in)
+{
+    Geom::PathVector pathv;
+    uint32_t paths = in.u32();
+    for (uint32_t i = 0; in.ok() && i < paths; ++i) {
+        bool closed = in.u8();
+        Geom::Path path(in.point());
+        uint32_t curves = in.u32();
+        for (uint32_t j = 0; in.ok() && j < curves; ++j) {
+            switch (in.u8()) {
+                case 1:
+                    path.appendNew<Geom::LineSegment>(in.point());
+                    break;
+                case 2: {
+                    Geom::Point p1 = in.point();
+                    path.appendNew<Geom::QuadraticBezier>(p1, in.point());
+                    break;
+                }
+                case 3: {
+                    Geom::Point p1 = in.point();
+                    Geom::Point p2 = in.point();
+                    path.appendNew<Geom::CubicBezier>(p1, p2, in.point());
+                    break;
+                }
+                default:
+                    in.fail();
+                    break;
+            }
+        }
+        path.close(closed);
+        pathv.push_back(std::move(path));
+    }
+    return pathv;
+}
+
+Node *read_subtree(Reader &in, Document *doc, PreparsedAttributes &preparsed)
+{
+    Node *node = nullptr;
+    auto type = static_cast<NodeType>(in.u8());
+    switch (type) {
+        case NodeType::ELEMENT_NODE: {
+            char const *name = in.string();
+            if (!in.ok() || !*name) {
+                return nullptr;
+            }
+            node = doc->createElement(name);
+            uint32_t attributes = in.u32();
+            for (uint32_t i = 0; in.ok() && i < attributes; ++i) {
+                char const *key = in.string();
+                char const *value = in.string();
+                if (in.ok()) {
+                    node->setAttribute(key, value);
+                }
+            }
+            char parsed = in.u8();
+            if (parsed & PARSED_PATH) {
+                Geom::PathVector pathv = read_path(in);
+                if (in.ok()) {
+                    preparsed.addPath(node, std::move(pathv));
+                }
+            }
+            if (parsed & PARSED_TRANSFORM) {
+                Geom::Affine transform;
+                for (int i = 0; i < 6; ++i) {
+                    transform[i] = in.f64();
+                }
+                if (in.ok()) {
+                    preparsed.addTransform(node, transform);
+                }
+            }
+            uint32_t children = in.u32();
+            for (uint32_t i = 0; in.ok() && i < children; ++i) {
+                if (Node *child = read_subtree(in, doc, preparsed)) {
+                    node->appendChild(child);
+                    GC::release(child);
+                }
+            }
+            break;
+        }
+        case NodeType::TEXT_NODE: {
+            bool is_CData = in.u8();
+            char const *content = in.string();
+            node = in.ok() ? doc->createTextNode(content, is_CData) : nullptr;
+            break;
+        }
+        case NodeType::COMMENT_NODE: {
+            char const *content = in.string();
+            node = in.ok() ? doc->createComment(content) : nullptr;
+            break;
+        }
+        case NodeType::PI_NODE: {
+            char const *target = in.string();
+            char const *content = in.string();
+            node = in.ok() ? doc->createPI(target, content) : nullptr;
+            break;
+        }
+        default:
+            in.fail();
+            break;
+    }
+    return node;
+}
+
+/// Removes the least recently used entries until at most max_entries are left.
+void prune_cache(std::string const &dir, size_t max_entries)
+{
+    GDir *gdir = g_dir_open(dir.c_str(), 0, nullptr);
+    if (!gdir) {
+        return;
+    }
+    std::vector<std::pair<time_t, std::string>> entries;
+    while (char const *name = g_dir_read_name(gdir)) {
+        std::string path = Glib::build_filename(dir, name);
+        GStatBuf st;
+        if (g_str_has_suffix(name, ".xmlcache") && g_stat(path.c_str(), &st) == 0) {
+            entries.emplace_back(st.st_mtime, path);
+        }
+    }
+    g_dir_close(gdir);
+
+    if (entries.size() <= max_entries) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), std::greater<std::pair<time_t, std::string>>());
+    for (size_t i = max_entries; i < entries.size(); ++i) {
+        g_unlink(entries[i].second.c_str());
+    }
+}
+
+} // namespace
+
+std::string cached_document_key(char const *data, size_t length, char const *default_ns)
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    if (!prefs->getBool("/options/svgload/cache", false) ||
+        length < static_cast<size_t>(prefs->getInt("/options/svgload/cache_minsize", 1024)) * 1024) {
+        return std::string();
+    }
+
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    auto add = [checksum](char const *string) {
+        // Include the NUL, so that the parts cannot run into each other.
+        g_checksum_update(checksum, reinterpret_cast<guchar const *>(string), strlen(string) + 1);
+    };
+    add(Inkscape::version_string);
+    add(default_ns ? default_ns : "");
+    add(prefs->getBool("/options/svgoutput/check_on_reading") ? "clean" : "");
+    g_checksum_update(checksum, reinterpret_cast<guchar const *>(data), length);
+    std::string key = g_checksum_get_string(checksum);
+    g_checksum_free(checksum);
+    return key;
+}
+
+Document *read_cached_document(std::string const &key, PreparsedAttributes *preparsed)
+{
+    std::string path = cache_path(key);
+    GMappedFile *mapped = g_mapped_file_new(path.c_str(), FALSE, nullptr);
+    if (!mapped) {
+        return nullptr;
+    }
+
+    Document *doc = nullptr;
+    PreparsedAttributes parsed;
+    char const *data = g_mapped_file_get_contents(mapped);
+    size_t length = g_mapped_file_get_length(mapped);
+    if (data && length > MAGIC_LEN && memcmp(data, MAGIC, MAGIC_LEN) == 0) {
+        Reader in(data + MAGIC_LEN, length - MAGIC_LEN);
+        if (key == in.string()) {
+            doc = new SimpleDocument();
+            uint32_t children = in.u32();
+            for (uint32_t i = 0; in.ok() && i < children; ++i) {
+                if (Node *child = read_subtree(in, doc, parsed)) {
+                    doc->appendChild(child);
+                    GC::release(child);
+                }
+            }
+            if (!in.ok() || !in.atEnd() || !doc->root()) {
+                g_warning("Ignoring damaged document cache entry %s", path.c_str());
+                GC::release(doc);
+                doc = nullptr;
+            }
+        }
+    }
+    g_mapped_file_unref(mapped);
+
+    if (doc) {
+        // Mark the entry as recently used.
+        g_utime(path.c_str(), nullptr);
+        if (preparsed) {
+            // Only now that the nodes are known to stay.
+            *preparsed = std::move(parsed);
+        }
+    }
+    return doc;
+}
+
+void write_cached_document(std::string const &key, Document const *doc, PreparsedAttributes const *preparsed)
+{
+    std::string dir = cache_directory();
+    if (g_mkdir_with_parents(dir.c_str(), 0700) != 0) {
+        return;
+    }
+
+    std::string out(MAGIC, MAGIC_LEN);
+    put_string(out, key.c_str());
+    put_u32(out, doc->childCount());
+    for (auto child = doc->firstChild(); child; child = child->next()) {
+        put_subtree(out, child, preparsed);
+    }
+
+    // Write to a temporary file first, so that readers never see a partial entry.
+    std::string path = cache_path(key);
+    std::string tmp = path + ".tmp";
+    FILE *file = g_fopen(tmp.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+    bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+    written = fclose(file) == 0 && written;
+    if (!written || g_rename(tmp.c_str(), path.c_str()) != 0) {
+        g_unlink(tmp.c_str());
+        return;
+    }
+
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    prune_cache(dir, prefs->getIntLimited("/options/svgload/cache_max", 10, 1, 1000));
+}
+
+} // namespace XML
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Cache of parsed XML documents, for re-opening large files quickly
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_XML_REPR_CACHE_H
+#define SEEN_INKSCAPE_XML_REPR_CACHE_H
+
+#include <cstddef>
+#include <string>
+
+namespace Inkscape {
+
+class PreparsedAttributes;
+
+namespace XML {
+
+class Document;
+
+/**
+ * Returns the key under which the document read from the given file contents is cached, or
+ * an empty string if documents of this size are not cached. The key covers the contents,
+ * the Inkscape version and the settings that change how a file is read.
+ *
+ * Caching is controlled by the "/options/svgload/cache" preferences. The cache lives in
+ * "/options/svgload/cache_dir", or in inkscape/documents in the user cache directory if that
+ * is empty.
+ */
+std::string cached_document_key(char const *data, size_t length, char const *default_ns);
+
+/**
+ * Reads a document from the cache.
+ * @param preparsed  if given, receives the path data and transforms stored with the document
+ * @return The document, or nullptr if there is no valid entry for the key.
+ */
+Document *read_cached_document(std::string const &key, PreparsedAttributes *preparsed = nullptr);
+
+/**
+ * Stores a freshly read document in the cache, making room by removing the least recently
+ * used entries. The path data and transforms in \a preparsed are stored along with it.
+ */
+void write_cached_document(std::string const &key, Document const *doc,
+                           PreparsedAttributes const *preparsed = nullptr);
+
+} // namespace XML
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_XML_REPR_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
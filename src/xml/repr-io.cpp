@@ -11,16 +11,37 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
+#include <algorithm>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 
 #include <libxml/parser.h>
 #include <libxml/xinclude.h>
+#include <libxml/xmlreader.h>
+#include <zlib.h>
 
 #include "xml/repr.h"
 #include "xml/attribute-record.h"
 #include "xml/rebase-hrefs.h"
+#include "xml/repr-builder.h"
+#include "xml/repr-cache.h"
 #include "xml/simple-document.h"
 #include "xml/text-node.h"
 #include "xml/node.h"
@@ -30,9 +51,9 @@
 #include "io/stream/gzipstream.h"
 #include "io/stream/uristream.h"
 
-#include "extension/extension.h"
 
 #include "attribute-rel-util.h"
+#include "object/preparsed-attributes.h"
 #include "attribute-sort-util.h"
 
 #include "preferences.h"
@@ -43,13 +64,15 @@ using Inkscape::IO::Writer;
 using Inkscape::XML::Document;
 using Inkscape::XML::SimpleDocument;
 using Inkscape::XML::Node;
+using Inkscape::XML::ReprBuilder;
 using Inkscape::XML::AttributeRecord;
 using Inkscape::XML::AttributeVector;
 using Inkscape::XML::rebase_href_attrs;
 
 Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns);
-static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gchar *default_ns, std::map<std::string, std::string> &prefix_map);
-static gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar *default_ns, std::map<std::string, std::string> &prefix_map);
+static Document *sp_repr_do_read_stream (xmlTextReaderPtr reader, const gchar *default_ns);
+static void sp_repr_svg_read_element (ReprBuilder &builder, xmlNodePtr node);
+static void sp_repr_svg_read_node (ReprBuilder &builder, xmlNodePtr node);
 static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
                                               bool add_whitespace, gchar const *default_ns,
                                               int inlineattrs, int indent,
@@ -62,22 +85,179 @@ static void sp_repr_write_stream_element(Node *repr, Writer &out,
                                          const AttributeVector & attributes,
                                          int inlineattrs, int indent,
                                          gchar const *old_href_abs_base,
-                                         gchar const *new_href_abs_base);
+                                         gchar const *new_href_abs_base,
+                                         bool parallel_children = false);
+
+static void sp_repr_write_stream_children(Node *repr, Writer &out,
+                                          gint indent_level, bool add_whitespace,
+                                          Glib::QueryQuark elide_prefix,
+                                          int inlineattrs, int indent,
+                                          gchar const *old_href_abs_base,
+                                          gchar const *new_href_abs_base);
+
+
+namespace {
+
+/**
+ * Inflates a gzip compressed buffer on a separate thread, so that decompression of large
+ * SVGZ files overlaps with parsing. Output is handed over in blocks of BLOCK_SIZE bytes, with
+ * at most MAX_QUEUED blocks waiting to be read.
+ */
+class InflateThread
+{
+public:
+    InflateThread(unsigned char const *data, size_t len)
+        : _data(data)
+        , _len(len)
+        , _thread(&InflateThread::run, this)
+    {}
+
+    ~InflateThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cancelled = true;
+        }
+        _cond.notify_all();
+        _thread.join();
+    }
+
+    InflateThread(InflateThread const &) = delete;
+    InflateThread &operator=(InflateThread const &) = delete;
+
+    /**
+     * Copies up to len inflated bytes into buffer, waiting for the inflating thread if
+     * necessary. Returns the number of bytes copied, 0 at the end of the data.
+     */
+    int read(char *buffer, int len)
+    {
+        int got = 0;
+        while (got < len) {
+            if (_current_pos == _current.size()) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cond.wait(lock, [this] { return !_blocks.empty() || _finished; });
+                if (_blocks.empty()) {
+                    break;
+                }
+                _current = std::move(_blocks.front());
+                _blocks.pop_front();
+                _current_pos = 0;
+                lock.unlock();
+                _cond.notify_all();
+                continue;
+            }
+            size_t some = std::min<size_t>(len - got, _current.size() - _current_pos);
+            memcpy(buffer + got, _current.data() + _current_pos, some);
+            _current_pos += some;
+            got += some;
+        }
+        return got;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+    static constexpr size_t MAX_QUEUED = 4;
+
+    void run()
+    {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        // 16 + MAX_WBITS: expect and check the gzip header and trailer.
+        bool done = inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK;
+        size_t remaining = _len;
+
+        while (!done) {
+            std::vector<char> block(BLOCK_SIZE);
+            zs.next_out = reinterpret_cast<Bytef *>(block.data());
+            zs.avail_out = BLOCK_SIZE;
+
+            while (zs.avail_out > 0) {
+                if (zs.avail_in == 0) {
+                    if (remaining == 0) {
+                        g_warning("Unexpected end of gzip data");
+                        done = true;
+                        break;
+                    }
+                    uInt chunk = std::min<size_t>(remaining, std::numeric_limits<uInt>::max());
+                    zs.next_in = const_cast<Bytef *>(_data + (_len - remaining));
+                    zs.avail_in = chunk;
+                    remaining -= chunk;
+                }
+                int zerr = inflate(&zs, Z_NO_FLUSH);
+                if (zerr == Z_STREAM_END) {
+                    // gzip files may consist of several concatenated members. Data after a
+                    // member that does not start like another one is ignored, like gzip does.
+                    size_t pos = _len - remaining - zs.avail_in;
+                    if (_len - pos < 2 || _data[pos] != 0x1f || _data[pos + 1] != 0x8b) {
+                        done = true;
+                        break;
+                    }
+                    inflateReset(&zs);
+                } else if (zerr != Z_OK) {
+                    g_warning("Error %d while decompressing gzip data", zerr);
+                    done = true;
+                    break;
+                }
+            }
+
+            block.resize(BLOCK_SIZE - zs.avail_out);
 
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this] { return _blocks.size() < MAX_QUEUED || _cancelled; });
+            if (_cancelled) {
+                break;
+            }
+            _blocks.push_back(std::move(block));
+            lock.unlock();
+            _cond.notify_all();
+        }
 
+        inflateEnd(&zs);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _finished = true;
+        }
+        _cond.notify_all();
+    }
+
+    unsigned char const *_data;
+    size_t _len;
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::deque<std::vector<char>> _blocks;
+    bool _finished = false;
+    bool _cancelled = false;
+
+    // Only touched by the reading thread.
+    std::vector<char> _current;
+    size_t _current_pos = 0;
+
+    std::thread _thread;
+};
+
+} // namespace
+
+/**
+ * Input for the XML parser. Regular files are memory mapped and, unless they are compressed,
+ * parsed straight from the mapping. Compressed files are inflated by an InflateThread.
+ */
 class XmlSource
 {
 public:
     XmlSource()
         : filename(nullptr),
           encoding(nullptr),
-          fp(nullptr),
           firstFewLen(0),
           LoadEntities(false),
           cachedData(),
           cachedPos(0),
-          instr(nullptr),
-          gzin(nullptr)
+          mapped(nullptr),
+          data(nullptr),
+          dataLen(0),
+          dataPos(0),
+          dataStart(0)
     {
         for (unsigned char & k : firstFew)
         {
@@ -87,6 +267,7 @@ public:
     virtual ~XmlSource()
     {
         close();
+        unloadData();
         if ( encoding ) {
             g_free(encoding);
             encoding = nullptr;
@@ -96,6 +277,8 @@ public:
     int setFile( char const * filename, bool load_entities );
 
     xmlDocPtr readXml();
+    xmlTextReaderPtr readXmlStream();
+    std::string cacheKey(char const *default_ns) const;
 
     static int readCb( void * context, char * buffer, int len );
     static int closeCb( void * context );
@@ -104,74 +287,145 @@ public:
     int read( char * buffer, int len );
     int close();
 private:
+    int parseOptions() const;
+    bool loadData();
+    void unloadData();
+
+    /// Whether libxml2 can be given the file contents directly instead of reading through readCb().
+    /// Its in-memory readers take the length as an int, so larger files are read through readCb().
+    bool isZeroCopy() const
+    {
+        return data && !inflater && !LoadEntities &&
+               dataLen - dataStart <= static_cast<size_t>(std::numeric_limits<int>::max());
+    }
+
     const char* filename;
     char* encoding;
-    FILE* fp;
     unsigned char firstFew[4];
     int firstFewLen;
     bool LoadEntities; // Checks for SYSTEM Entities (requires cached data)
     std::string cachedData;
     unsigned int cachedPos;
-    Inkscape::IO::FileInputStream* instr;
-    Inkscape::IO::GzipInputStream* gzin;
+    GMappedFile *mapped;
+    std::string owned; // file contents if mapping is not possible, e.g. for stdin
+    const char *data;
+    size_t dataLen;
+    size_t dataPos;   // next byte to hand out by read()
+    size_t dataStart; // size of the byte order mark, if any
+    std::unique_ptr<InflateThread> inflater;
 };
 
+/**
+ * Makes the contents of the file available in data/dataLen, preferably by mapping it.
+ */
+bool XmlSource::loadData()
+{
+    if (strcmp(filename, "-") != 0) {
+        gchar *native = g_filename_from_utf8(filename, -1, nullptr, nullptr, nullptr);
+        if (native) {
+            mapped = g_mapped_file_new(native, FALSE, nullptr);
+            g_free(native);
+        }
+        if (mapped) {
+            data = g_mapped_file_get_contents(mapped);
+            dataLen = g_mapped_file_get_length(mapped);
+            if (!data) {
+                data = ""; // empty file
+            }
+            return true;
+        }
+    }
+
+    FILE *fp = Inkscape::IO::fopen_utf8name(filename, "r");
+    if (!fp) {
+        return false;
+    }
+    char buffer[BUFSIZ];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        owned.append(buffer, got);
+    }
+    bool failed = ferror(fp);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    if (failed) {
+        owned.clear();
+        return false;
+    }
+    data = owned.data();
+    dataLen = owned.size();
+    return true;
+}
+
+void XmlSource::unloadData()
+{
+    if ( mapped ) {
+        g_mapped_file_unref(mapped);
+        mapped = nullptr;
+    }
+    owned.clear();
+    owned.shrink_to_fit();
+    data = nullptr;
+    dataLen = 0;
+}
+
+/**
+ * Prepares reading filename. Calling this again for the same file reuses the loaded contents,
+ * which matters when reading from stdin.
+ */
 int XmlSource::setFile(char const *filename, bool load_entities=false)
 {
     int retVal = -1;
 
+    close();
+    if ( encoding ) {
+        g_free(encoding);
+        encoding = nullptr;
+    }
+    if ( !data || !this->filename || strcmp(this->filename, filename) != 0 ) {
+        unloadData();
+    }
     this->filename = filename;
+    this->LoadEntities = false;
 
-    fp = Inkscape::IO::fopen_utf8name(filename, "r");
-    if ( fp ) {
+    if ( data || loadData() ) {
         // First peek in the file to see what it is
         memset( firstFew, 0, sizeof(firstFew) );
 
-        size_t some = fread( firstFew, 1, 4, fp );
-        if ( fp ) {
-            // first check for compression
-            if ( (some >= 2) && (firstFew[0] == 0x1f) && (firstFew[1] == 0x8b) ) {
-                //g_message(" the file being read is gzip'd. extract it");
-                fclose(fp);
-                fp = nullptr;
-                fp = Inkscape::IO::fopen_utf8name(filename, "r");
-                instr = new Inkscape::IO::FileInputStream(fp);
-                gzin = new Inkscape::IO::GzipInputStream(*instr);
-
-                memset( firstFew, 0, sizeof(firstFew) );
-                some = 0;
-                int single = 0;
-                while ( some < 4 && single >= 0 )
-                {
-                    single = gzin->get();
-                    if ( single >= 0 ) {
-                        firstFew[some++] = 0x0ff & single;
-                    } else {
-                        break;
-                    }
-                }
-            }
+        size_t some = std::min<size_t>(dataLen, 4);
+        memcpy( firstFew, data, some );
+        dataPos = some;
 
-            int encSkip = 0;
-            if ( (some >= 2) &&(firstFew[0] == 0xfe) && (firstFew[1] == 0xff) ) {
-                encoding = g_strdup("UTF-16BE");
-                encSkip = 2;
-            } else if ( (some >= 2) && (firstFew[0] == 0xff) && (firstFew[1] == 0xfe) ) {
-                encoding = g_strdup("UTF-16LE");
-                encSkip = 2;
-            } else if ( (some >= 3) && (firstFew[0] == 0xef) && (firstFew[1] == 0xbb) && (firstFew[2] == 0xbf) ) {
-                encoding = g_strdup("UTF-8");
-                encSkip = 3;
-            }
+        // first check for compression
+        if ( (some >= 2) && (firstFew[0] == 0x1f) && (firstFew[1] == 0x8b) ) {
+            //g_message(" the file being read is gzip'd. extract it");
+            inflater = std::make_unique<InflateThread>(reinterpret_cast<unsigned char const *>(data), dataLen);
 
-            if ( encSkip ) {
-                memmove( firstFew, firstFew + encSkip, (some - encSkip) );
-                some -= encSkip;
-            }
+            memset( firstFew, 0, sizeof(firstFew) );
+            some = inflater->read(reinterpret_cast<char *>(firstFew), 4);
+        }
+
+        int encSkip = 0;
+        if ( (some >= 2) &&(firstFew[0] == 0xfe) && (firstFew[1] == 0xff) ) {
+            encoding = g_strdup("UTF-16BE");
+            encSkip = 2;
+        } else if ( (some >= 2) && (firstFew[0] == 0xff) && (firstFew[1] == 0xfe) ) {
+            encoding = g_strdup("UTF-16LE");
+            encSkip = 2;
+        } else if ( (some >= 3) && (firstFew[0] == 0xef) && (firstFew[1] == 0xbb) && (firstFew[2] == 0xbf) ) {
+            encoding = g_strdup("UTF-8");
+            encSkip = 3;
+        }
 
-            firstFewLen = some;
-            retVal = 0; // no error
+        if ( encSkip ) {
+            memmove( firstFew, firstFew + encSkip, (some - encSkip) );
+            some -= encSkip;
         }
+
+        dataStart = encSkip;
+        firstFewLen = some;
+        retVal = 0; // no error
     }
     if(load_entities) {
         this->cachedData = std::string("");
@@ -182,8 +436,7 @@ int XmlSource::setFile(char const *filename, bool load_entities=false)
         while(true) {
             int len = this->read(buffer, 4096);
             if(len <= 0) break;
-            buffer[len] = 0;
-            this->cachedData += buffer;
+            this->cachedData.append(buffer, len);
         }
         delete[] buffer;
 
@@ -210,7 +463,7 @@ int XmlSource::setFile(char const *filename, bool load_entities=false)
     return retVal;
 }
 
-xmlDocPtr XmlSource::readXml()
+int XmlSource::parseOptions() const
 {
     int parse_options = XML_PARSE_HUGE | XML_PARSE_RECOVER;
 
@@ -221,8 +474,19 @@ xmlDocPtr XmlSource::readXml()
     // Allow NOENT only if we're filtering out SYSTEM and PUBLIC entities
     if (LoadEntities)     parse_options |= XML_PARSE_NOENT;
 
-    auto doc = xmlReadIO( readCb, closeCb, this,
-                      filename, getEncoding(), parse_options);
+    return parse_options;
+}
+
+xmlDocPtr XmlSource::readXml()
+{
+    xmlDocPtr doc;
+    if (isZeroCopy()) {
+        doc = xmlReadMemory(data + dataStart, dataLen - dataStart,
+                            filename, getEncoding(), parseOptions());
+    } else {
+        doc = xmlReadIO( readCb, closeCb, this,
+                         filename, getEncoding(), parseOptions());
+    }
 
     if (doc && doc->properties && xmlXIncludeProcessFlags(doc, XML_PARSE_NOXINCNODE) < 0) {
         g_warning("XInclude processing failed for %s", filename);
@@ -231,6 +495,37 @@ xmlDocPtr XmlSource::readXml()
     return doc;
 }
 
+/**
+ * Returns the key for the document cache, or an empty string if the document read from this
+ * source must not be cached. Documents that pull in other files through XInclude are not
+ * cached, since the key covers only this file. Neither are compressed files, which would have
+ * to be inflated once more just to look for XInclude.
+ */
+std::string XmlSource::cacheKey(char const *default_ns) const
+{
+    static char const xinclude[] = "http://www.w3.org/2001/XInclude";
+    if (!data || inflater || strcmp(filename, "-") == 0 ||
+        std::search(data, data + dataLen, xinclude, xinclude + sizeof(xinclude) - 1) != data + dataLen) {
+        return std::string();
+    }
+    return Inkscape::XML::cached_document_key(data, dataLen, default_ns);
+}
+
+/**
+ * Opens a pull parser on the source, for sp_repr_do_read_stream(). Unlike readXml(), no
+ * XInclude processing is done; the caller falls back to readXml() for such documents.
+ */
+xmlTextReaderPtr XmlSource::readXmlStream()
+{
+    if (isZeroCopy()) {
+        // The reader parses from the mapping as it goes, so it must not outlive this source.
+        return xmlReaderForMemory(data + dataStart, dataLen - dataStart,
+                                  filename, getEncoding(), parseOptions());
+    }
+    return xmlReaderForIO( readCb, closeCb, this,
+                           filename, getEncoding(), parseOptions());
+}
+
 int XmlSource::readCb( void * context, char * buffer, int len )
 {
     int retVal = -1;
@@ -272,49 +567,30 @@ int XmlSource::read( char *buffer, int len )
         }
         firstFewLen -= some;
         got = some;
-    } else if ( gzin ) {
-        int single = 0;
-        while ( (static_cast<int>(got) < len) && (single >= 0) )
-        {
-            single = gzin->get();
-            if ( single >= 0 ) {
-                buffer[got++] = 0x0ff & single;
-            } else {
-                break;
-            }
-        }
+    } else if ( inflater ) {
+        got = inflater->read( buffer, len );
+    } else if ( data ) {
+        got = std::min<size_t>( len, dataLen - dataPos );
+        memcpy( buffer, data + dataPos, got );
+        dataPos += got;
     } else {
-        got = fread( buffer, 1, len, fp );
+        return -1;
     }
 
-    if ( feof(fp) ) {
-        retVal = got;
-    } else if ( ferror(fp) ) {
-        retVal = -1;
-    } else {
-        retVal = got;
-    }
+    retVal = got;
 
     return retVal;
 }
 
+/**
+ * Ends reading. The file contents stay loaded until the source is destroyed or set to
+ * another file, so that a parser created by readXmlStream() can still use them.
+ */
 int XmlSource::close()
 {
-    if ( gzin ) {
-        gzin->close();
-        delete gzin;
-        gzin = nullptr;
-    }
-    if ( instr ) {
-        instr->close();
-        fp = nullptr;
-        delete instr;
-        instr = nullptr;
-    }
-    if ( fp ) {
-        fclose(fp);
-        fp = nullptr;
-    }
+    inflater.reset();
+    dataPos = 0;
+    firstFewLen = 0;
     return 0;
 }
 
@@ -322,7 +598,7 @@ int XmlSource::close()
  * Reads XML from a file, and returns the Document.
  * The default namespace can also be specified, if desired.
  */
-Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
+Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns, Inkscape::PreparsedAttributes *preparsed)
 {
     xmlDocPtr doc = nullptr;
     Document * rdoc = nullptr;
@@ -349,24 +625,63 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
     Inkscape::IO::dump_fopen_call(filename, "N");
 
     XmlSource src;
+    bool ready = src.setFile(filename) == 0;
+
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    std::string cache_key;
+    if (ready && prefs->getBool("/options/svgload/cache", false)) {
+        cache_key = src.cacheKey(default_ns);
+        if (!cache_key.empty() && (rdoc = Inkscape::XML::read_cached_document(cache_key, preparsed))) {
+            g_free(localFilename);
+            return rdoc;
+        }
+    }
+
+    // Build the tree while parsing rather than from a complete libxml2 tree, which roughly
+    // halves peak memory on large drawings. Anything the streaming reader cannot handle
+    // identically is read again below the old way.
+    bool streamed = false;
+    if (ready && prefs->getBool("/options/svgload/streaming", true)) {
+        xmlTextReaderPtr reader = src.readXmlStream();
+        if (reader) {
+            rdoc = sp_repr_do_read_stream(reader, default_ns);
+            xmlFreeTextReader(reader);
+        }
+        streamed = true;
+    }
 
-    if (src.setFile(filename) == 0) {
+    // Start over only if the streaming reader has taken from the source.
+    if (!rdoc && ready && (!streamed || src.setFile(filename) == 0)) {
         doc = src.readXml();
         rdoc = sp_repr_do_read(doc, default_ns);
-        // For some reason, failed ns loading results in this
-        // We try a system check version of load with NOENT for adobe
-        if (rdoc && strcmp(rdoc->root()->name(), "ns:svg") == 0) {
+    }
+
+    // For some reason, failed ns loading results in this
+    // We try a system check version of load with NOENT for adobe
+    if (rdoc && strcmp(rdoc->root()->name(), "ns:svg") == 0) {
+        if (doc) {
             xmlFreeDoc(doc);
-            src.setFile(filename, true);
-            doc = src.readXml();
-            rdoc = sp_repr_do_read(doc, default_ns);
         }
+        src.setFile(filename, true);
+        doc = src.readXml();
+        rdoc = sp_repr_do_read(doc, default_ns);
     }
 
     if (doc) {
         xmlFreeDoc(doc);
     }
 
+    if (rdoc && !cache_key.empty()) {
+        // Store the path data and transforms as well, parsing them here rather than when the
+        // objects are built.
+        Inkscape::PreparsedAttributes parsed;
+        if (!preparsed) {
+            preparsed = &parsed;
+        }
+        preparsed->parse(rdoc->root());
+        Inkscape::XML::write_cached_document(cache_key, rdoc, preparsed);
+    }
+
     if (localFilename) {
         g_free(localFilename);
     }
@@ -380,7 +695,7 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
 Document *sp_repr_read_mem (const gchar * buffer, gint length, const gchar *default_ns)
 {
     xmlDocPtr doc;
-    Document * rdoc;
+    Document * rdoc = nullptr;
 
     xmlSubstituteEntitiesDefault(1);
 
@@ -391,6 +706,16 @@ Document *sp_repr_read_mem (const gchar * buffer, gint length, const gchar *defa
                                        // proper solution would be to check the preference "/options/externalresources/xml/allow_net_access"
                                        // as done in XmlSource::readXml which gets called by the analogous sp_repr_read_file()
                                        // but sp_repr_read_mem() seems to be called in locations where Inkscape::Preferences::get() fails badly
+
+    xmlTextReaderPtr reader = xmlReaderForMemory(buffer, length, nullptr, nullptr, parser_options);
+    if (reader) {
+        rdoc = sp_repr_do_read_stream(reader, default_ns);
+        xmlFreeTextReader(reader);
+        if (rdoc) {
+            return rdoc;
+        }
+    }
+
     doc = xmlReadMemory (const_cast<gchar *>(buffer), length, nullptr, nullptr, parser_options);
 
     rdoc = sp_repr_do_read (doc, default_ns);
@@ -443,24 +768,6 @@ Glib::QueryQuark qname_prefix(Glib::QueryQuark qname) {
 
 }
 
-namespace {
-
-void promote_to_namespace(Node *repr, const gchar *prefix) {
-    if ( repr->type() == Inkscape::XML::NodeType::ELEMENT_NODE ) {
-        GQuark code = repr->code();
-        if (!qname_prefix(code).id()) {
-            gchar *svg_name = g_strconcat(prefix, ":", g_quark_to_string(code), NULL);
-            repr->setCodeUnsafe(g_quark_from_string(svg_name));
-            g_free(svg_name);
-        }
-        for ( Node *child = repr->firstChild() ; child ; child = child->next() ) {
-            promote_to_namespace(child, prefix);
-        }
-    }
-}
-
-}
-
 /**
  * Reads in a XML file to create a Document
  */
@@ -469,157 +776,235 @@ Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns)
     if (doc == nullptr) {
         return nullptr;
     }
-    xmlNodePtr node=xmlDocGetRootElement (doc);
-    if (node == nullptr) {
+    if (xmlDocGetRootElement(doc) == nullptr) {
         return nullptr;
     }
 
-    std::map<std::string, std::string> prefix_map;
-
-    Document *rdoc = new Inkscape::XML::SimpleDocument();
-
-    Node *root=nullptr;
-    for ( node = doc->children ; node != nullptr ; node = node->next ) {
-        if (node->type == XML_ELEMENT_NODE) {
-            Node *repr=sp_repr_svg_read_node(rdoc, node, default_ns, prefix_map);
-            rdoc->appendChild(repr);
-            Inkscape::GC::release(repr);
+    ReprBuilder builder(default_ns);
+    for (xmlNodePtr node = doc->children; node != nullptr; node = node->next) {
+        sp_repr_svg_read_node(builder, node);
+    }
+    return builder.finish();
+}
 
-            if (!root) {
-                root = repr;
-            } else {
-                root = nullptr;
+/**
+ * Builds a Document from a pull parser, creating each node as soon as libxml2 reports it.
+ * Unlike sp_repr_do_read() no complete libxml2 tree is ever held: the reader frees every
+ * subtree once it has been passed, so only the currently open elements exist twice.
+ *
+ * Returns nullptr on parse errors, and for documents containing unsubstituted entity
+ * references or XInclude elements, which the tree based reader treats specially; callers
+ * are expected to retry with sp_repr_do_read() then.
+ */
+static Document *sp_repr_do_read_stream (xmlTextReaderPtr reader, const gchar *default_ns)
+{
+    ReprBuilder builder(default_ns);
+    bool supported = true;
+
+    int status = 0;
+    while (supported && (status = xmlTextReaderRead(reader)) == 1) {
+        // Only valid until the next read, everything needed is copied out right away.
+        xmlNodePtr node = xmlTextReaderCurrentNode(reader);
+
+        switch (xmlTextReaderNodeType(reader)) {
+            case XML_READER_TYPE_ELEMENT:
+                if (node->ns && (xmlStrEqual(node->ns->href, XINCLUDE_NS) ||
+                                 xmlStrEqual(node->ns->href, XINCLUDE_OLD_NS))) {
+                    supported = false;
+                } else {
+                    sp_repr_svg_read_element(builder, node);
+                    if (xmlTextReaderIsEmptyElement(reader)) {
+                        builder.endElement();
+                    }
+                }
+                break;
+            case XML_READER_TYPE_END_ELEMENT:
+                builder.endElement();
+                break;
+            case XML_READER_TYPE_TEXT:
+            case XML_READER_TYPE_CDATA:
+            case XML_READER_TYPE_WHITESPACE:
+            case XML_READER_TYPE_SIGNIFICANT_WHITESPACE:
+            case XML_READER_TYPE_COMMENT:
+            case XML_READER_TYPE_PROCESSING_INSTRUCTION:
+                sp_repr_svg_read_node(builder, node);
+                break;
+            case XML_READER_TYPE_ENTITY_REFERENCE:
+                supported = false;
+                break;
+            default:
                 break;
-            }
-        } else if ( node->type == XML_COMMENT_NODE || node->type == XML_PI_NODE ) {
-            Node *repr=sp_repr_svg_read_node(rdoc, node, default_ns, prefix_map);
-            rdoc->appendChild(repr);
-            Inkscape::GC::release(repr);
         }
     }
 
-    if (root != nullptr) {
-        /* promote elements of some XML documents that don't use namespaces
-         * into their default namespace */
-        if ( default_ns && !strchr(root->name(), ':') ) {
-            if ( !strcmp(default_ns, SP_SVG_NS_URI) ) {
-                promote_to_namespace(root, "svg");
-            }
-            if ( !strcmp(default_ns, INKSCAPE_EXTENSION_URI) ) {
-                promote_to_namespace(root, INKSCAPE_EXTENSION_NS_NC);
-            }
-        }
-
-
-        // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
-        // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
-        // icons.svg). How can one tell if a file is internal?
-        if ( !strcmp(root->name(), "svg:svg" ) ) {
-            Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-            bool clean = prefs->getBool("/options/svgoutput/check_on_reading");
-            if( clean ) {
-                sp_attribute_clean_tree( root );
-            }
-        }
+    Document *rdoc = builder.finish();
+    if (rdoc && (!supported || status != 0)) {
+        Inkscape::GC::release(rdoc);
+        return nullptr;
     }
-
     return rdoc;
 }
 
-gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar */*default_ns*/, std::map<std::string, std::string> &prefix_map)
+/**
+ * Opens the element for node with its attributes, without reading its children.
+ */
+static void sp_repr_svg_read_element (ReprBuilder &builder, xmlNodePtr node)
 {
-    const xmlChar *prefix;
-    if (ns){
-        if (ns->href ) {
-            prefix = reinterpret_cast<const xmlChar*>( sp_xml_ns_uri_prefix(reinterpret_cast<const gchar*>(ns->href),
-                                                                            reinterpret_cast<const char*>(ns->prefix)) );
-            prefix_map[reinterpret_cast<const char*>(prefix)] = reinterpret_cast<const char*>(ns->href);
-        }
-        else {
-            prefix = nullptr;
-        }
-    }
-    else {
-        prefix = nullptr;
-    }
+    auto qualified_name = [](xmlNsPtr ns, xmlChar const *name) {
+        bool known = ns && ns->href;
+        return ReprBuilder::qualifiedName(known ? reinterpret_cast<char const *>(ns->href) : nullptr,
+                                          known ? reinterpret_cast<char const *>(ns->prefix) : nullptr,
+                                          reinterpret_cast<char const *>(name));
+    };
+
+    builder.startElement(qualified_name(node->ns, node->name).c_str());
+    /* TODO remember node->ns->prefix if node->ns != NULL */
 
-    if (prefix) {
-        return g_snprintf (p, len, "%s:%s", reinterpret_cast<const gchar*>(prefix), name);
-    } else {
-        return g_snprintf (p, len, "%s", name);
+    for (xmlAttrPtr prop = node->properties; prop != nullptr; prop = prop->next) {
+        if (prop->children) {
+            builder.setAttribute(qualified_name(prop->ns, prop->name).c_str(),
+                                 reinterpret_cast<gchar*>(prop->children->content));
+            /* TODO remember prop->ns->prefix if prop->ns != NULL */
+        }
     }
 }
 
-static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gchar *default_ns, std::map<std::string, std::string> &prefix_map)
+/**
+ * Reads node and, for elements, everything in it.
+ */
+static void sp_repr_svg_read_node (ReprBuilder &builder, xmlNodePtr node)
 {
-    xmlAttrPtr prop;
-    xmlNodePtr child;
-    gchar c[256];
+    switch (node->type) {
+        case XML_TEXT_NODE:
+        case XML_CDATA_SECTION_NODE:
+            if (node->content) {
+                builder.addText(reinterpret_cast<gchar *>(node->content),
+                                strlen(reinterpret_cast<gchar *>(node->content)),
+                                node->type == XML_CDATA_SECTION_NODE);
+            }
+            break;
+        case XML_COMMENT_NODE:
+            builder.addComment(reinterpret_cast<gchar *>(node->content));
+            break;
+        case XML_PI_NODE:
+            builder.addPI(reinterpret_cast<const gchar *>(node->name),
+                          reinterpret_cast<const gchar *>(node->content));
+            break;
+        case XML_ELEMENT_NODE:
+            sp_repr_svg_read_element(builder, node);
+            for (xmlNodePtr child = node->xmlChildrenNode; child != nullptr; child = child->next) {
+                sp_repr_svg_read_node(builder, child);
+            }
+            builder.endElement();
+            break;
+        default:
+            break;
+    }
+}
 
-    if (node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE) {
+namespace {
 
-        if (node->content == nullptr || *(node->content) == '\0') {
-            return nullptr; // empty text node
-        }
+/**
+ * Writer that collects its output in memory.  With a destination writer,
+ * the output is passed on in large blocks; without one it is kept until
+ * taken with buffer().
+ */
+class BufferWriter : public Inkscape::IO::BasicWriter
+{
+public:
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
 
-        // Since libxml2 2.9.0, only element nodes are checked, thus check parent.
-        // Note: this only handles XML's rules for white space. SVG's specific rules
-        // are handled in sp-string.cpp.
-        bool preserve = (xmlNodeGetSpacePreserve (node->parent) == 1);
+    BufferWriter() = default;
+    explicit BufferWriter(Writer &destinationWriter)
+        : BasicWriter(destinationWriter)
+    {}
 
-        xmlChar *p;
-        for (p = node->content; *p && g_ascii_isspace (*p) && !preserve; p++)
-            ; // skip all whitespace
+    void close() override
+    {
+        writeBuffer();
+        BasicWriter::close();
+    }
 
-        if (!(*p)) { // this is an all-whitespace node, and preserve == default
-            return nullptr; // we do not preserve all-whitespace nodes unless we are asked to
-        }
+    void flush() override
+    {
+        writeBuffer();
+        BasicWriter::flush();
+    }
 
-        // We keep track of original node type so that CDATA sections are preserved on output.
-        return xml_doc->createTextNode(reinterpret_cast<gchar *>(node->content),
-                                       node->type == XML_CDATA_SECTION_NODE );
+    void put(char ch) override
+    {
+        _buffer.push_back(ch);
+        writeFullBuffer();
     }
 
-    if (node->type == XML_COMMENT_NODE) {
-        return xml_doc->createComment(reinterpret_cast<gchar *>(node->content));
+    Writer &writeStdString(const std::string &str) override
+    {
+        if (destination && str.size() >= BLOCK_SIZE) {
+            writeBuffer();
+            destination->writeStdString(str);
+        } else {
+            _buffer.append(str);
+            writeFullBuffer();
+        }
+        return *this;
     }
 
-    if (node->type == XML_PI_NODE) {
-        return xml_doc->createPI(reinterpret_cast<const gchar *>(node->name),
-                                 reinterpret_cast<const gchar *>(node->content));
+    Writer &writeString(const char *str) override
+    {
+        _buffer.append(str ? str : "null");
+        writeFullBuffer();
+        return *this;
     }
 
-    if (node->type == XML_ENTITY_DECL) {
-        return nullptr;
+    /// Passes everything collected so far on to the destination writer.
+    void writeBuffer()
+    {
+        if (destination && !_buffer.empty()) {
+            destination->writeStdString(_buffer);
+            _buffer.clear();
+        }
     }
 
-    sp_repr_qualified_name (c, 256, node->ns, node->name, default_ns, prefix_map);
-    Node *repr = xml_doc->createElement(c);
-    /* TODO remember node->ns->prefix if node->ns != NULL */
+    std::string &buffer() { return _buffer; }
 
-    for (prop = node->properties; prop != nullptr; prop = prop->next) {
-        if (prop->children) {
-            sp_repr_qualified_name (c, 256, prop->ns, prop->name, default_ns, prefix_map);
-            repr->setAttribute(c, reinterpret_cast<gchar*>(prop->children->content));
-            /* TODO remember prop->ns->prefix if prop->ns != NULL */
+private:
+    void writeFullBuffer()
+    {
+        if (destination && _buffer.size() >= BLOCK_SIZE) {
+            writeBuffer();
         }
     }
 
-    if (node->content) {
-        repr->setContent(reinterpret_cast<gchar*>(node->content));
-    }
+    std::string _buffer;
+};
+
+int serialization_threads()
+{
+#ifdef HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    return prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    return 1;
+#endif
+}
 
-    for (child = node->xmlChildrenNode; child != nullptr; child = child->next) {
-        Node *crepr = sp_repr_svg_read_node (xml_doc, child, default_ns, prefix_map);
-        if (crepr) {
-            repr->appendChild(crepr);
-            Inkscape::GC::release(crepr);
+bool subtree_needs_rebasing(Node *repr, gchar const *old_href_abs_base, gchar const *new_href_abs_base)
+{
+    if (repr->type() != Inkscape::XML::NodeType::ELEMENT_NODE) {
+        return false;
+    }
+    if (Inkscape::XML::href_attrs_need_rebasing(old_href_abs_base, new_href_abs_base, repr->attributeList())) {
+        return true;
+    }
+    for (Node *child = repr->firstChild(); child; child = child->next()) {
+        if (subtree_needs_rebasing(child, old_href_abs_base, new_href_abs_base)) {
+            return true;
         }
     }
-
-    return repr;
+    return false;
 }
 
+}
 
 static void sp_repr_save_writer(Document *doc, Inkscape::IO::Writer *out,
                     gchar const *default_ns,
@@ -630,12 +1015,15 @@ static void sp_repr_save_writer(Document *doc, Inkscape::IO::Writer *out,
     bool inlineattrs = prefs->getBool("/options/svgoutput/inlineattrs");
     int indent = prefs->getInt("/options/svgoutput/indent", 2);
 
+    // Pass the output on in large blocks rather than character by character.
+    BufferWriter buffered(*out);
+
     /* fixme: do this The Right Way */
-    out->writeString( "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n" );
+    buffered.writeString( "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n" );
 
     const gchar *str = static_cast<Node *>(doc)->attribute("doctype");
     if (str) {
-        out->writeString( str );
+        buffered.writeString( str );
     }
 
     for (Node *repr = sp_repr_document_first_child(doc);
@@ -643,16 +1031,18 @@ static void sp_repr_save_writer(Document *doc, Inkscape::IO::Writer *out,
     {
         Inkscape::XML::NodeType const node_type = repr->type();
         if ( node_type == Inkscape::XML::NodeType::ELEMENT_NODE ) {
-            sp_repr_write_stream_root_element(repr, *out, TRUE, default_ns, inlineattrs, indent,
+            sp_repr_write_stream_root_element(repr, buffered, TRUE, default_ns, inlineattrs, indent,
                                               old_href_abs_base, new_href_abs_base);
         } else {
-            sp_repr_write_stream(repr, *out, 0, TRUE, GQuark(0), inlineattrs, indent,
+            sp_repr_write_stream(repr, buffered, 0, TRUE, GQuark(0), inlineattrs, indent,
                                  old_href_abs_base, new_href_abs_base);
             if ( node_type == Inkscape::XML::NodeType::COMMENT_NODE ) {
-                out->writeChar('\n');
+                buffered.writeChar('\n');
             }
         }
     }
+
+    buffered.writeBuffer();
 }
 
 
@@ -674,8 +1064,11 @@ void sp_repr_save_stream(Document *doc, FILE *fp, gchar const *default_ns, bool
                     gchar const *const old_href_abs_base,
                     gchar const *const new_href_abs_base)
 {
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    int level = prefs->getIntLimited("/options/svgoutput/compression_level", Z_DEFAULT_COMPRESSION, 0, 9);
+
     Inkscape::IO::FileOutputStream bout(fp);
-    Inkscape::IO::GzipOutputStream *gout = compress ? new Inkscape::IO::GzipOutputStream(bout) : nullptr;
+    Inkscape::IO::GzipOutputStream *gout = compress ? new Inkscape::IO::GzipOutputStream(bout, level, serialization_threads()) : nullptr;
     Inkscape::IO::OutputStreamWriter *out  = compress ? new Inkscape::IO::OutputStreamWriter( *gout ) : new Inkscape::IO::OutputStreamWriter( bout );
 
     sp_repr_save_writer(doc, out, default_ns, old_href_abs_base, new_href_abs_base);
@@ -910,8 +1303,10 @@ static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
         }
     }
 
+    // populate_ns_map() has filled the qname_prefix() cache for the whole tree,
+    // so the children can be written from several threads.
     return sp_repr_write_stream_element(repr, out, 0, add_whitespace, elide_prefix, attributes,
-                                        inlineattrs, indent, old_href_base, new_href_base);
+                                        inlineattrs, indent, old_href_base, new_href_base, true);
 }
 
 void sp_repr_write_stream( Node *repr, Writer &out, gint indent_level,
@@ -965,7 +1360,8 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
                                    const AttributeVector & attributes, 
                                    int inlineattrs, int indent,
                                    gchar const *old_href_base,
-                                   gchar const *new_href_base )
+                                   gchar const *new_href_base,
+                                   bool parallel_children )
 {
     Node *child = nullptr;
     bool loose = false;
@@ -1001,7 +1397,16 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
         add_whitespace = false;
     } else {
         // Suppress formatting whitespace for xml:space="preserve"
-        gchar const *xml_space_attr = repr->attribute("xml:space");
+        // (looked up without Node::attribute(), which may build an index on the node
+        // and must not run on the threads used by sp_repr_write_stream_children())
+        static GQuark const xml_space_key = g_quark_from_static_string("xml:space");
+        gchar const *xml_space_attr = nullptr;
+        for (const auto &iter : attributes) {
+            if (iter.key == xml_space_key) {
+                xml_space_attr = iter.value.pointer();
+                break;
+            }
+        }
         if (g_strcmp0(xml_space_attr, "preserve") == 0) {
             add_whitespace = false;
         } else if (g_strcmp0(xml_space_attr, "default") == 0) {
@@ -1009,8 +1414,14 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
         }
     }
 
-    const auto rbd = rebase_href_attrs(old_href_base, new_href_base, attributes);
-    for (const auto &iter : rbd) {
+    // Only copy the attributes when there is an href to rebase.
+    AttributeVector rebased;
+    AttributeVector const *attrs = &attributes;
+    if (Inkscape::XML::href_attrs_need_rebasing(old_href_base, new_href_base, attributes)) {
+        rebased = rebase_href_attrs(old_href_base, new_href_base, attributes);
+        attrs = &rebased;
+    }
+    for (const auto &iter : *attrs) {
         if (!inlineattrs) {
             out.writeChar('\n');
             if (indent) {
@@ -1039,10 +1450,16 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
         if (loose && add_whitespace) {
             out.writeChar('\n');
         }
-        for (child = repr->firstChild(); child != nullptr; child = child->next()) {
-            sp_repr_write_stream(child, out, ( loose ? indent_level + 1 : 0 ),
-                                 add_whitespace, elide_prefix, inlineattrs, indent,
-                                 old_href_base, new_href_base);
+        if (parallel_children) {
+            sp_repr_write_stream_children(repr, out, ( loose ? indent_level + 1 : 0 ),
+                                          add_whitespace, elide_prefix, inlineattrs, indent,
+                                          old_href_base, new_href_base);
+        } else {
+            for (child = repr->firstChild(); child != nullptr; child = child->next()) {
+                sp_repr_write_stream(child, out, ( loose ? indent_level + 1 : 0 ),
+                                     add_whitespace, elide_prefix, inlineattrs, indent,
+                                     old_href_base, new_href_base);
+            }
         }
 
         if (loose && add_whitespace && indent) {
@@ -1062,6 +1479,60 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
     }
 }
 
+/**
+ * Writes the children of repr.  Element subtrees (typically the layers) are
+ * formatted into separate buffers in parallel and then written in document order.
+ */
+static void sp_repr_write_stream_children(Node *repr, Writer &out,
+                                          gint indent_level, bool add_whitespace,
+                                          Glib::QueryQuark elide_prefix,
+                                          int inlineattrs, int indent,
+                                          gchar const *old_href_base,
+                                          gchar const *new_href_base)
+{
+    std::vector<Node *> children;
+    for (Node *child = repr->firstChild(); child; child = child->next()) {
+        children.push_back(child);
+    }
+
+    int const count = children.size();
+    int numOfThreads = serialization_threads();
+
+    // Rebasing hrefs allocates from the garbage collected heap, which other
+    // threads must not do, so such subtrees are written on this thread.
+    std::vector<char> parallel(count, 0);
+    if (count > 1 && numOfThreads > 1) {
+        for (int i = 0; i < count; ++i) {
+            parallel[i] = children[i]->type() == Inkscape::XML::NodeType::ELEMENT_NODE &&
+                          !subtree_needs_rebasing(children[i], old_href_base, new_href_base);
+        }
+    }
+
+    std::vector<std::string> buffers(count);
+
+    #ifdef HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(numOfThreads)
+    #endif
+    for (int i = 0; i < count; ++i) {
+        if (parallel[i]) {
+            BufferWriter writer;
+            sp_repr_write_stream(children[i], writer, indent_level, add_whitespace, elide_prefix,
+                                 inlineattrs, indent, old_href_base, new_href_base);
+            buffers[i].swap(writer.buffer());
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (parallel[i]) {
+            out.writeStdString(buffers[i]);
+            std::string().swap(buffers[i]);
+        } else {
+            sp_repr_write_stream(children[i], out, indent_level, add_whitespace, elide_prefix,
+                                 inlineattrs, indent, old_href_base, new_href_base);
+        }
+    }
+}
+
 
 /*
   Local Variables:
@@ -35,6 +35,7 @@ class SPCSSAttr;
 class SVGLength;
 
 namespace Inkscape {
+class PreparsedAttributes;
 namespace IO {
 class Writer;
 } // namespace IO
@@ -52,7 +53,12 @@ Inkscape::XML::Document *sp_repr_document_new(char const *rootname);
 
 /* IO */
 
-Inkscape::XML::Document *sp_repr_read_file(char const *filename, char const *default_ns);
+/**
+ * @param preparsed  if given, receives the path data and transforms that come with the
+ *                   document from the document cache, see repr-cache.h
+ */
+Inkscape::XML::Document *sp_repr_read_file(char const *filename, char const *default_ns,
+                                           Inkscape::PreparsedAttributes *preparsed = nullptr);
 Inkscape::XML::Document *sp_repr_read_mem(char const *buffer, int length, char const *default_ns);
 void sp_repr_write_stream(Inkscape::XML::Node *repr, Inkscape::IO::Writer &out,
                           int indent_level,  bool add_whitespace, Glib::QueryQuark elide_prefix,
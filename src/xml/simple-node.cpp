@@ -19,6 +19,8 @@
 // clang-format on
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstring>
 #include <string>
 
@@ -163,6 +165,64 @@ public:
     }
 };
 
+/**
+ * Returns the quark of an attribute name. Names are nearly always string literals or come
+ * from the sp_attribute_name() table, so recent lookups are remembered by pointer, which
+ * avoids GLib's locked quark table; the string is still compared in case a buffer got
+ * reused for another name. With create == false, unknown names give 0.
+ */
+GQuark attribute_key(gchar const *name, bool create)
+{
+    struct CacheEntry {
+        gchar const *name;
+        GQuark key;
+    };
+    static thread_local std::array<CacheEntry, 256> cache{};
+
+    auto &entry = cache[(reinterpret_cast<std::uintptr_t>(name) >> 3) % cache.size()];
+    if (entry.name == name && !std::strcmp(g_quark_to_string(entry.key), name)) {
+        return entry.key;
+    }
+
+    GQuark const key = create ? g_quark_from_string(name) : g_quark_try_string(name);
+    if (key) {
+        entry = { name, key };
+    }
+    return key;
+}
+
+/**
+ * The attribute checks done by SimpleNode::setAttributeImpl(), kept up to date by watching
+ * the preferences rather than reading them for every attribute set.
+ */
+class AttributeCleaningPolicy : public Preferences::Observer {
+public:
+    AttributeCleaningPolicy()
+    : Observer("/options/svgoutput")
+    {
+        _update();
+        Preferences::get()->addObserver(*this);
+    }
+
+    void notify(Preferences::Entry const &) override { _update(); }
+
+    bool enabled = false; ///< "check_on_editing"
+    unsigned flags = 0;   ///< sp_attribute_clean_get_prefs(), if enabled
+
+private:
+    void _update() {
+        enabled = Preferences::get()->getBool("/options/svgoutput/check_on_editing");
+        flags = enabled ? sp_attribute_clean_get_prefs() : 0;
+    }
+};
+
+AttributeCleaningPolicy const &attribute_cleaning_policy()
+{
+    // Never destroyed: the preferences may be unloaded before static destructors run.
+    static auto policy = new AttributeCleaningPolicy();
+    return *policy;
+}
+
 }
 
 using Util::ptr_shared;
@@ -213,6 +273,7 @@ SimpleNode::SimpleNode(SimpleNode const &node, Document *document)
     }
 
     _attributes = node._attributes;
+    _updateAttributeIndex();
 
     _observers.add(_subtree_observers);
 }
@@ -228,16 +289,50 @@ gchar const *SimpleNode::content() const {
 gchar const *SimpleNode::attribute(gchar const *name) const {
     g_return_val_if_fail(name != nullptr, NULL);
 
-    GQuark const key = g_quark_from_string(name);
+    // A name that was never interned can't be set on any node.
+    GQuark const key = attribute_key(name, false);
+    if (!key) {
+        return nullptr;
+    }
 
-    for (const auto & iter : _attributes)
-    {
-        if ( iter.key == key ) {
-            return iter.value;
+    int const index = _findAttribute(key);
+    return index < 0 ? nullptr : static_cast<gchar const *>(_attributes[index].value);
+}
+
+/**
+ * Returns the position of the attribute in _attributes, or -1. Short lists are searched
+ * directly; longer ones have an index. Nothing is changed, so that several threads can
+ * look up attributes of the same node at once.
+ */
+int SimpleNode::_findAttribute(GQuark key) const {
+    if (!_attribute_index) {
+        for (std::size_t i = 0; i < _attributes.size(); ++i) {
+            if (_attributes[i].key == key) {
+                return i;
+            }
         }
+        return -1;
     }
 
-    return nullptr;
+    auto found = _attribute_index->find(key);
+    return found == _attribute_index->end() ? -1 : static_cast<int>(found->second);
+}
+
+/**
+ * Builds or drops the index of _attributes after it changed other than by appending,
+ * depending on the number of attributes.
+ */
+void SimpleNode::_updateAttributeIndex() {
+    if (_attributes.size() <= ATTRIBUTE_INDEX_THRESHOLD) {
+        _attribute_index = nullptr;
+        return;
+    }
+
+    // Allocated from the collector like the node itself, as nodes are never destructed.
+    _attribute_index = new (GC::SCANNED, GC::AUTO) AttributeIndex();
+    for (std::size_t i = 0; i < _attributes.size(); ++i) {
+        _attribute_index->emplace(_attributes[i].key, i);
+    }
 }
 
 unsigned SimpleNode::position() const {
@@ -319,19 +414,20 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
     g_assert(std::none_of(name, name + strlen(name), [](char c) { return g_ascii_isspace(c); }));
 
     // Check usefulness of attributes on elements in the svg namespace, optionally don't add them to tree.
-    Glib::ustring element = g_quark_to_string(_name);
-    //g_message("setAttribute:  %s: %s: %s", element.c_str(), name, value);
+    gchar const *element_name = g_quark_to_string(_name);
+    //g_message("setAttribute:  %s: %s: %s", element_name, name, value);
     gchar* cleaned_value = g_strdup( value );
 
     // Only check elements in SVG name space and don't block setting attribute to NULL.
-    if( element.substr(0,4) == "svg:" && value != nullptr) {
+    if( !strncmp(element_name, "svg:", 4) && value != nullptr) {
 
-        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-        if( prefs->getBool("/options/svgoutput/check_on_editing") ) {
+        auto const &policy = attribute_cleaning_policy();
+        if( policy.enabled ) {
 
+            Glib::ustring element = element_name;
             gchar const *id_char = attribute("id");
             Glib::ustring id = (id_char == nullptr ? "" : id_char );
-            unsigned int flags = sp_attribute_clean_get_prefs();
+            unsigned int flags = policy.flags;
             bool attr_warn   = flags & SP_ATTRCLEAN_ATTR_WARN;
             bool attr_remove = flags & SP_ATTRCLEAN_ATTR_REMOVE;
 
@@ -358,15 +454,10 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
         }
     }
 
-    GQuark const key = g_quark_from_string(name);
+    GQuark const key = attribute_key(name, true);
 
-    AttributeRecord *ref = nullptr;
-    for ( auto & existing : _attributes ) {
-        if ( existing.key == key ) {
-            ref = &existing;
-            break;
-        }
-    }
+    int const index = _findAttribute(key);
+    AttributeRecord *ref = index < 0 ? nullptr : &_attributes[index];
     Debug::EventTracker<> tracker;
 
     ptr_shared old_value=( ref ? ref->value : ptr_shared() );
@@ -377,13 +468,19 @@ SimpleNode::setAttributeImpl(gchar const *name, gchar const *value)
         tracker.set<DebugSetAttribute>(*this, key, new_value);
         if (!ref) {
 	    _attributes.emplace_back(key, new_value);
+            if (_attribute_index) {
+                _attribute_index->emplace(key, _attributes.size() - 1);
+            } else if (_attributes.size() > ATTRIBUTE_INDEX_THRESHOLD) {
+                _updateAttributeIndex();
+            }
         } else {
             ref->value = new_value;
         }
     } else { //clearing attribute
         tracker.set<DebugClearAttribute>(*this, key);
         if (ref) {
-	    _attributes.erase(std::find(_attributes.begin(),_attributes.end(),(*ref)));
+	    _attributes.erase(_attributes.begin() + index);
+            _updateAttributeIndex(); // positions changed
         }
     }
 
@@ -16,7 +16,9 @@
 #define SEEN_INKSCAPE_XML_SIMPLE_NODE_H
 
 #include <cassert>
+#include <functional>
 #include <iostream>
+#include <unordered_map>
 #include <vector>
 
 #include "xml/node.h"
@@ -133,6 +135,14 @@ private:
 
     void _setParent(SimpleNode *parent);
     unsigned _childPosition(SimpleNode const &child) const;
+    int _findAttribute(GQuark key) const;
+    void _updateAttributeIndex();
+
+    /// Attribute count above which lookups go through _attribute_index
+    static constexpr std::size_t ATTRIBUTE_INDEX_THRESHOLD = 8;
+    typedef std::unordered_map<GQuark, std::size_t, std::hash<GQuark>, std::equal_to<GQuark>,
+                               Inkscape::GC::Alloc<std::pair<GQuark const, std::size_t>, Inkscape::GC::AUTO>>
+        AttributeIndex;
 
     SimpleNode *_parent;
     SimpleNode *_next;
@@ -143,6 +153,7 @@ private:
     int _name;
 
     AttributeVector _attributes;
+    AttributeIndex *_attribute_index = nullptr; ///< key to position in _attributes, kept up to date when set
 
     Inkscape::Util::ptr_shared _content;
 
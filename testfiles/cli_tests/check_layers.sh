@@ -0,0 +1,29 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+# Checks that an SVG file has exactly the layers with the given labels, and no duplicate IDs.
+
+testfile=$1
+shift
+
+test -f "${testfile}" || { echo "check_layers.sh: testfile '${testfile}' not found."; exit 1; }
+test $# -gt 0         || { echo "check_layers.sh: no layer labels specified."; exit 1; }
+
+for label in "$@"; do
+    if ! grep -q -F "inkscape:label=\"${label}\"" "${testfile}"; then
+        echo "check_layers.sh: no layer '${label}' in testfile '${testfile}'."
+        exit 1
+    fi
+done
+
+layers=$(grep -o -F 'inkscape:groupmode="layer"' "${testfile}" | wc -l)
+if [ "${layers}" -ne $# ]; then
+    echo "check_layers.sh: testfile '${testfile}' has ${layers} layers, expected $#."
+    exit 1
+fi
+
+duplicates=$(grep -o -E '(^|[[:space:]])id="[^"]*"' "${testfile}" | sed 's/^[[:space:]]*//' | sort | uniq -d)
+if [ -n "${duplicates}" ]; then
+    echo "check_layers.sh: duplicate IDs in testfile '${testfile}':" ${duplicates}
+    exit 1
+fi
@@ -0,0 +1,13 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+file1=$1
+file2=$2
+
+test -f "${file1}" || { echo "compare_images.sh: First file '${file1}' not found."; exit 1; }
+test -f "${file2}" || { echo "compare_images.sh: Second file '${file2}' not found."; exit 1; }
+
+if ! compare -metric AE "${file1}" "${file2}" null:; then
+    echo && echo "compare_images.sh: Images '${file1}' and '${file2}' differ."
+    exit 1
+fi
@@ -0,0 +1,16 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+testfile=$1
+regex=$2
+count=$3
+
+test -f "${testfile}" || { echo "count_regex.sh: testfile '${testfile}' not found."; exit 1; }
+test -n "${regex}"    || { echo "count_regex.sh: no regex to match specified."; exit 1; }
+test -n "${count}"    || { echo "count_regex.sh: no count specified."; exit 1; }
+
+matches=$(grep -a -c -E "${regex}" "${testfile}")
+if [ "${matches}" != "${count}" ]; then
+    echo "count_regex.sh: regex '${regex}' matches ${matches} lines in testfile '${testfile}', expected ${count}."
+    exit 1
+fi
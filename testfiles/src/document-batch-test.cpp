@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Test batched edits of the XML tree
+ */
+/*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "document-undo.h"
+
+#include <vector>
+
+#include <doc-per-case-test.h>
+#include <gtest/gtest.h>
+
+#include "event.h"
+#include "undo-stack-observer.h"
+#include "verbs.h"
+#include "object/sp-rect.h"
+#include "xml/repr.h"
+
+using namespace Inkscape;
+
+static char const *const docString = R"""(
+<svg xmlns='http://www.w3.org/2000/svg'>
+<path id="p1" d="M 0,0 L 1,1" />
+<g id="g1"><rect id="r1" x="1" /></g>
+</svg>
+)""";
+
+/// Records the descriptions of the committed undo steps.
+class CommitRecorder : public UndoStackObserver
+{
+public:
+    std::vector<Glib::ustring> descriptions;
+
+    void notifyUndoEvent(Event *) override {}
+    void notifyRedoEvent(Event *) override {}
+    void notifyUndoCommitEvent(Event *log) override { descriptions.push_back(log->description); }
+    void notifyClearUndoEvent() override {}
+    void notifyClearRedoEvent() override {}
+};
+
+class DocumentBatchTest : public DocPerCaseTest
+{
+public:
+    CommitRecorder commits;
+    std::unique_ptr<SPDocument> doc;
+
+    DocumentBatchTest()
+    {
+        doc.reset(SPDocument::createNewDocFromMem(docString, strlen(docString), false));
+        doc->addUndoObserver(commits);
+    }
+
+    XML::Node *repr(char const *id) { return doc->getObjectById(id)->getRepr(); }
+};
+
+TEST_F(DocumentBatchTest, ScopedBatchIsOneUndoStep)
+{
+    std::string const original = sp_repr_save_buf(doc->getReprDoc());
+    auto rect = dynamic_cast<SPRect *>(doc->getObjectById("r1"));
+    ASSERT_NE(rect, nullptr);
+
+    {
+        DocumentUndo::ScopedBatch batch(doc.get(), SP_VERB_NONE, "Batch");
+        for (int i = 2; i <= 10; ++i) {
+            repr("r1")->setAttribute("x", std::to_string(i));
+            repr("p1")->setAttribute("d", "M 0,0 L " + std::to_string(i) + ",1");
+            DocumentUndo::done(doc.get(), SP_VERB_NONE, "");
+        }
+        EXPECT_TRUE(doc->isBatching());
+        // Attributes are read when the batch ends.
+        EXPECT_EQ(rect->x.value, 1);
+    }
+    EXPECT_FALSE(doc->isBatching());
+    EXPECT_EQ(rect->x.value, 10);
+    EXPECT_EQ(commits.descriptions, std::vector<Glib::ustring>{"Batch"});
+
+    ASSERT_TRUE(DocumentUndo::undo(doc.get()));
+    EXPECT_EQ(sp_repr_save_buf(doc->getReprDoc()), original);
+    EXPECT_EQ(rect->x.value, 1);
+}
+
+TEST_F(DocumentBatchTest, FirstDescriptionIsKept)
+{
+    {
+        DocumentUndo::ScopedBatch outer(doc.get());
+        {
+            DocumentUndo::ScopedBatch inner(doc.get(), SP_VERB_NONE, "Inner");
+            repr("r1")->setAttribute("x", "2");
+        }
+        repr("r1")->setAttribute("x", "3");
+        DocumentUndo::done(doc.get(), SP_VERB_NONE, "Done");
+    }
+    EXPECT_EQ(commits.descriptions, std::vector<Glib::ustring>{"Inner"});
+
+    // A description passed to done() inside a batch without one is kept, too.
+    {
+        DocumentUndo::ScopedBatch batch(doc.get());
+        repr("r1")->setAttribute("x", "4");
+        DocumentUndo::done(doc.get(), SP_VERB_NONE, "Done");
+    }
+    EXPECT_EQ(commits.descriptions, (std::vector<Glib::ustring>{"Inner", "Done"}));
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Test replaying the auto-save journal of a document
+ */
+/*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "document-journal.h"
+
+#include <doc-per-case-test.h>
+#include <gtest/gtest.h>
+#include <fstream>
+#include <iterator>
+
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+
+#include "document-undo.h"
+#include "verbs.h"
+#include "object/sp-object.h"
+#include "xml/repr.h"
+
+using namespace Inkscape;
+
+static char const *const docString = R"""(
+<svg xmlns='http://www.w3.org/2000/svg'>
+<g id="g1"><rect id="r1" x="1" /><rect id="r2" x="2" /><rect id="r3" x="3" /></g>
+<g id="g2"><text id="t1">Some text</text></g>
+<!-- a comment -->
+</svg>
+)""";
+
+class DocumentJournalTest : public DocPerCaseTest
+{
+public:
+    std::unique_ptr<SPDocument> doc;
+    std::string filename;
+
+    DocumentJournalTest()
+    {
+        doc.reset(SPDocument::createNewDocFromMem(docString, strlen(docString), false));
+        filename = Glib::build_filename(Glib::get_tmp_dir(), "inkscape-document-journal-test.journal");
+    }
+
+    XML::Node *repr(char const *id) { return doc->getObjectById(id)->getRepr(); }
+
+    /// Checks that the journal rebuilds the document as it is now.
+    void expect_replay_matches(DocumentJournal &journal)
+    {
+        journal.sync();
+        XML::Document *replayed = DocumentJournal::replay(filename);
+        ASSERT_NE(replayed, nullptr);
+        EXPECT_EQ(sp_repr_save_buf(replayed), sp_repr_save_buf(doc->getReprDoc()));
+        GC::release(replayed);
+    }
+};
+
+TEST_F(DocumentJournalTest, Snapshot)
+{
+    DocumentJournal journal(doc.get(), filename);
+    expect_replay_matches(journal);
+    EXPECT_GT(journal.snapshotSize(), 0u);
+    EXPECT_EQ(journal.journalSize(), 0u);
+}
+
+TEST_F(DocumentJournalTest, Changes)
+{
+    DocumentJournal journal(doc.get(), filename);
+
+    repr("r1")->setAttribute("x", "10");
+    repr("r2")->removeAttribute("x");
+    repr("g1")->changeOrder(repr("r3"), nullptr);
+    repr("t1")->firstChild()->setContent("Other text");
+    XML::Node *rect = doc->getReprDoc()->createElement("svg:rect");
+    rect->setAttribute("id", "r4");
+    repr("g2")->appendChild(rect);
+    rect->setAttribute("y", "4");
+    GC::release(rect);
+    journal.commit();
+    expect_replay_matches(journal);
+
+    // Move a node into a new group, then drop its old parent.
+    XML::Node *group = doc->getReprDoc()->createElement("svg:g");
+    doc->getReprRoot()->appendChild(group);
+    XML::Node *moved = repr("r2");
+    moved->parent()->removeChild(moved);
+    group->appendChild(moved);
+    GC::release(group);
+    repr("g1")->parent()->removeChild(repr("g1"));
+    journal.commit();
+    expect_replay_matches(journal);
+
+    EXPECT_GT(journal.journalSize(), 0u);
+    EXPECT_LT(journal.journalSize(), journal.snapshotSize());
+}
+
+TEST_F(DocumentJournalTest, UndoRedo)
+{
+    DocumentJournal journal(doc.get(), filename);
+
+    repr("r1")->setAttribute("x", "10");
+    repr("g2")->parent()->removeChild(repr("g2"));
+    DocumentUndo::done(doc.get(), SP_VERB_NONE, "");
+    expect_replay_matches(journal);
+
+    DocumentUndo::undo(doc.get());
+    expect_replay_matches(journal);
+
+    DocumentUndo::redo(doc.get());
+    expect_replay_matches(journal);
+}
+
+TEST_F(DocumentJournalTest, TruncatedTransaction)
+{
+    std::string before;
+    {
+        DocumentJournal journal(doc.get(), filename);
+        before = sp_repr_save_buf(doc->getReprDoc());
+        repr("r1")->setAttribute("x", "10");
+        journal.commit();
+        journal.sync();
+
+        // Cut the last transaction short, as a crash while writing it would.
+        std::ifstream in(filename, std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream(filename + ".cut", std::ios::binary) << contents.substr(0, contents.size() - 2);
+    }
+    EXPECT_FALSE(Glib::file_test(filename, Glib::FILE_TEST_EXISTS));
+
+    XML::Document *replayed = DocumentJournal::replay(filename + ".cut");
+    ASSERT_NE(replayed, nullptr);
+    EXPECT_EQ(sp_repr_save_buf(replayed), before);
+    GC::release(replayed);
+    unlink((filename + ".cut").c_str());
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Test the memory limit of the undo history
+ */
+/*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "document-undo.h"
+
+#include <doc-per-case-test.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "preferences.h"
+#include "verbs.h"
+#include "object/sp-object.h"
+#include "object/sp-rect.h"
+#include "xml/event.h"
+#include "xml/repr.h"
+
+using namespace Inkscape;
+
+static char const *const docString = R"""(
+<svg xmlns='http://www.w3.org/2000/svg'>
+<path id="p1" d="M 0,0 L 1,1" />
+<g id="g1"><rect id="r1" x="1" /></g>
+</svg>
+)""";
+
+class DocumentUndoTest : public DocPerCaseTest
+{
+public:
+    std::unique_ptr<SPDocument> doc;
+
+    DocumentUndoTest()
+    {
+        doc.reset(SPDocument::createNewDocFromMem(docString, strlen(docString), false));
+        Preferences::get()->setInt("/options/undo/memorylimit", 1);
+    }
+
+    ~DocumentUndoTest() override { Preferences::get()->setInt("/options/undo/memorylimit", 256); }
+
+    XML::Node *repr(char const *id) { return doc->getObjectById(id)->getRepr(); }
+};
+
+TEST_F(DocumentUndoTest, CompactLog)
+{
+    XML::Node *rect = repr("r1");
+    XML::Event *log = nullptr;
+    log = new XML::EventChgAttr(rect, g_quark_from_string("x"), Util::share_string("1"),
+                                Util::share_string("2"), log);
+    log = new XML::EventChgAttr(rect, g_quark_from_string("y"), Util::ptr_shared(),
+                                Util::share_string("5"), log);
+    log = new XML::EventChgAttr(rect, g_quark_from_string("x"), Util::share_string("2"),
+                                Util::share_string("3"), log);
+    log = new XML::EventChgAttr(rect, g_quark_from_string("y"), Util::share_string("5"),
+                                Util::ptr_shared(), log);
+
+    log = sp_repr_compact_log(log);
+
+    // The changes to y cancel out, those to x become one.
+    ASSERT_NE(log, nullptr);
+    EXPECT_EQ(log->next, nullptr);
+    auto chg_attr = dynamic_cast<XML::EventChgAttr *>(log);
+    ASSERT_NE(chg_attr, nullptr);
+    EXPECT_STREQ(chg_attr->oldval, "1");
+    EXPECT_STREQ(chg_attr->newval, "3");
+    sp_repr_free_log(log);
+}
+
+TEST_F(DocumentUndoTest, UndoPastMemoryLimit)
+{
+    std::string const original = sp_repr_save_buf(doc->getReprDoc());
+
+    // About 4 MiB of history, well over the limit of 1 MiB.
+    std::vector<std::string> path_data = {repr("p1")->attribute("d")};
+    for (int i = 0; i < 40; ++i) {
+        std::string d = "M 0," + std::to_string(i);
+        while (d.size() < 100000) {
+            d += " L " + std::to_string(d.size()) + "," + std::to_string(i);
+        }
+        repr("p1")->setAttribute("d", d);
+        path_data.push_back(d);
+        if (i % 10 == 0) {
+            XML::Node *rect = doc->getReprDoc()->createElement("svg:rect");
+            repr("g1")->appendChild(rect);
+            GC::release(rect);
+        }
+        DocumentUndo::done(doc.get(), SP_VERB_NONE, "");
+    }
+    std::string const edited = sp_repr_save_buf(doc->getReprDoc());
+
+    // The older steps were compacted or moved out to stay under the limit.
+    EXPECT_LT(DocumentUndo::getUndoMemory(doc.get()), size_t(1) << 20);
+
+    // Each step, including those read back in, restores the attribute it changed.
+    for (size_t i = path_data.size() - 1; i > 0; --i) {
+        ASSERT_TRUE(DocumentUndo::undo(doc.get()));
+        EXPECT_EQ(repr("p1")->attribute("d"), path_data[i - 1]);
+    }
+    EXPECT_FALSE(DocumentUndo::undo(doc.get()));
+    EXPECT_EQ(sp_repr_save_buf(doc->getReprDoc()), original);
+
+    for (size_t i = 1; i < path_data.size(); ++i) {
+        ASSERT_TRUE(DocumentUndo::redo(doc.get()));
+        EXPECT_EQ(repr("p1")->attribute("d"), path_data[i]);
+    }
+    EXPECT_FALSE(DocumentUndo::redo(doc.get()));
+    EXPECT_EQ(sp_repr_save_buf(doc->getReprDoc()), edited);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Test rendering items into bitmaps
+ */
+/*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "helper/pixbuf-ops.h"
+
+#include <doc-per-case-test.h>
+#include <gtest/gtest.h>
+
+#include "document.h"
+#include "preferences.h"
+#include "display/cairo-utils.h"
+#include "object/sp-item.h"
+
+static char const *const docString = R"""(
+<svg xmlns='http://www.w3.org/2000/svg' width='200' height='100'>
+<defs>
+  <filter id='blur'><feGaussianBlur stdDeviation='2'/></filter>
+</defs>
+<rect id='r1' width='100' height='100' fill='#ff0000' opacity='0.5' filter='url(#blur)'/>
+<rect id='r2' x='100' width='100' height='100' fill='#0000ff'/>
+</svg>
+)""";
+
+class PixbufOpsTest : public DocPerCaseTest
+{
+public:
+    std::unique_ptr<SPDocument> doc;
+
+    PixbufOpsTest() { doc.reset(SPDocument::createNewDocFromMem(docString, strlen(docString), false)); }
+
+    std::vector<SPItemBitmapJob> render(int threads)
+    {
+        std::vector<SPItemBitmapJob> jobs;
+        for (auto id : {"r1", "r2"}) {
+            auto item = dynamic_cast<SPItem *>(doc->getObjectById(id));
+            jobs.push_back({item, Geom::IntRect(0, 0, 200, 100), nullptr});
+        }
+        auto prefs = Inkscape::Preferences::get();
+        prefs->setInt("/options/threading/numthreads", threads);
+        sp_generate_internal_bitmaps(doc.get(), 96, jobs);
+        prefs->remove("/options/threading/numthreads");
+        return jobs;
+    }
+
+    static guint32 pixel(Inkscape::Pixbuf &pb, int x, int y)
+    {
+        cairo_surface_t *surface = pb.getSurfaceRaw();
+        cairo_surface_flush(surface);
+        auto row = cairo_image_surface_get_data(surface) + y * cairo_image_surface_get_stride(surface);
+        return reinterpret_cast<guint32 const *>(row)[x];
+    }
+};
+
+TEST_F(PixbufOpsTest, ItemsAreRenderedAlone)
+{
+    auto jobs = render(1);
+    ASSERT_TRUE(jobs[0].pixbuf);
+    ASSERT_TRUE(jobs[1].pixbuf);
+    EXPECT_EQ(jobs[0].pixbuf->width(), 200);
+    EXPECT_EQ(jobs[0].pixbuf->height(), 100);
+
+    // The opacity of the item is left to the caller.
+    guint32 red = pixel(*jobs[0].pixbuf, 50, 50);
+    EXPECT_GT(red >> 24, 0xf0);
+    EXPECT_EQ(red & 0xffff, 0);
+    EXPECT_EQ(pixel(*jobs[0].pixbuf, 150, 50), 0x00000000);
+    EXPECT_EQ(pixel(*jobs[1].pixbuf, 50, 50), 0x00000000);
+    EXPECT_EQ(pixel(*jobs[1].pixbuf, 150, 50), 0xff0000ff);
+}
+
+TEST_F(PixbufOpsTest, ThreadsRenderTheSameBitmaps)
+{
+    auto single = render(1);
+    auto threaded = render(4);
+    for (size_t i = 0; i < single.size(); ++i) {
+        ASSERT_TRUE(single[i].pixbuf);
+        ASSERT_TRUE(threaded[i].pixbuf);
+        cairo_surface_t *a = single[i].pixbuf->getSurfaceRaw();
+        cairo_surface_t *b = threaded[i].pixbuf->getSurfaceRaw();
+        size_t size = cairo_image_surface_get_stride(a) * cairo_image_surface_get_height(a);
+        ASSERT_EQ(cairo_image_surface_get_stride(b) * cairo_image_surface_get_height(b), size);
+        EXPECT_EQ(memcmp(cairo_image_surface_get_data(a), cairo_image_surface_get_data(b), size), 0);
+    }
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Test PNG export
+ */
+/*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "helper/png-write.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <doc-per-case-test.h>
+#include <glib/gstdio.h>
+#include <glibmm/miscutils.h>
+#include <gtest/gtest.h>
+#include <png.h>
+
+#include "document.h"
+#include "preferences.h"
+#include "object/sp-item.h"
+
+static char const *const docString = R"""(
+<svg xmlns='http://www.w3.org/2000/svg' width='100' height='500'>
+<defs>
+  <linearGradient id='lg'><stop offset='0' stop-color='red'/><stop offset='1' stop-color='blue'/></linearGradient>
+  <filter id='blur'><feGaussianBlur stdDeviation='4'/></filter>
+</defs>
+<rect width='100' height='500' fill='url(#lg)'/>
+<circle id='c1' cx='50' cy='130' r='40' fill='green' filter='url(#blur)'/>
+<path d='M 0,0 L 100,500 M 100,0 L 0,500' stroke='black' stroke-width='3'/>
+</svg>
+)""";
+
+class PngExportTest : public DocPerCaseTest
+{
+public:
+    std::unique_ptr<SPDocument> doc;
+
+    PngExportTest() { doc.reset(SPDocument::createNewDocFromMem(docString, strlen(docString), false)); }
+
+    std::vector<float> progress;
+
+    static unsigned int recordProgress(float value, void *data)
+    {
+        static_cast<PngExportTest *>(data)->progress.push_back(value);
+        return 1;
+    }
+
+    std::string exportWithThreads(int threads, bool interlace, bool report = false)
+    {
+        auto prefs = Inkscape::Preferences::get();
+        prefs->setInt("/options/threading/numthreads", threads);
+        auto filename = Glib::build_filename(Glib::get_tmp_dir(), "png-export-test.png");
+        auto result = sp_export_png_file(doc.get(), filename.c_str(), Geom::Rect(0, 0, 100, 500), 100, 500, 96, 96,
+                                         0xffffffff, report ? recordProgress : nullptr, report ? this : nullptr,
+                                         true, {}, interlace, PNG_COLOR_TYPE_RGB_ALPHA, 8, 6, 2);
+        prefs->remove("/options/threading/numthreads");
+        EXPECT_EQ(result, EXPORT_OK);
+        return readAndRemove(filename);
+    }
+
+    static std::string readAndRemove(std::string const &filename)
+    {
+        std::ifstream in(filename, std::ios::binary);
+        std::string contents{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        g_unlink(filename.c_str());
+        return contents;
+    }
+};
+
+TEST_F(PngExportTest, ThreadedExportMatchesSerialExport)
+{
+    auto serial = exportWithThreads(1, false);
+    ASSERT_FALSE(serial.empty());
+    EXPECT_EQ(exportWithThreads(4, false), serial);
+    EXPECT_EQ(exportWithThreads(3, true), exportWithThreads(1, true));
+
+    // Reporting progress pauses the threads, which must not change the image.
+    EXPECT_EQ(exportWithThreads(4, false, true), serial);
+    ASSERT_FALSE(progress.empty());
+    // Not for each of the 8 stripes of 64 rows.
+    EXPECT_LT(progress.size(), 8u);
+    EXPECT_TRUE(std::is_sorted(progress.begin(), progress.end()));
+    EXPECT_EQ(progress.front(), 0.0f);
+    EXPECT_LT(progress.back(), 1.0f);
+}
+
+TEST_F(PngExportTest, ExportFilesMatchesSingleExports)
+{
+    std::vector<SPItem *> circle{dynamic_cast<SPItem *>(doc->getObjectById("c1"))};
+    ASSERT_NE(circle[0], nullptr);
+
+    std::vector<SPPngExportJob> jobs(3);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        jobs[i].filename = Glib::build_filename(Glib::get_tmp_dir(), "png-export-test-" + std::to_string(i) + ".png");
+    }
+    // The whole drawing comes between the circle alone, so hidden items must be shown again.
+    jobs[0].area = Geom::Rect(0, 80, 100, 180);
+    jobs[0].width = 100;
+    jobs[0].height = 100;
+    jobs[0].items_only = circle;
+    jobs[1].area = Geom::Rect(0, 0, 100, 500);
+    jobs[1].width = 100;
+    jobs[1].height = 500;
+    jobs[2].area = jobs[0].area;
+    jobs[2].width = 200;
+    jobs[2].height = 200;
+    jobs[2].items_only = circle;
+    for (auto &job : jobs) {
+        job.xdpi = job.ydpi = 96.0 * job.width / job.area.width();
+    }
+
+    auto results = sp_export_png_files(doc.get(), jobs, 0xffffffff, nullptr, nullptr, true);
+    ASSERT_EQ(results.size(), jobs.size());
+    std::vector<std::string> together;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        EXPECT_EQ(results[i], EXPORT_OK);
+        together.push_back(readAndRemove(jobs[i].filename));
+    }
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        auto const &job = jobs[i];
+        auto result = sp_export_png_file(doc.get(), job.filename.c_str(), job.area, job.width, job.height,
+                                         job.xdpi, job.ydpi, 0xffffffff, nullptr, nullptr, true, job.items_only);
+        EXPECT_EQ(result, EXPORT_OK);
+        auto single = readAndRemove(job.filename);
+        ASSERT_FALSE(single.empty());
+        EXPECT_EQ(together[i], single);
+    }
+}
+
+TEST_F(PngExportTest, MemoryLimitedExportMatchesUnlimitedExport)
+{
+    static char const *const wideString = R"""(
+<svg xmlns='http://www.w3.org/2000/svg' width='3000' height='300'>
+<rect width='3000' height='300' fill='yellow'/>
+<g opacity='0.5'><circle cx='2050' cy='150' r='140' fill='green'/></g>
+<path d='M 0,0 L 3000,300 M 3000,0 L 0,300' stroke='black' stroke-width='7'/>
+</svg>
+)""";
+    doc.reset(SPDocument::createNewDocFromMem(wideString, strlen(wideString), false));
+
+    auto prefs = Inkscape::Preferences::get();
+    auto filename = Glib::build_filename(Glib::get_tmp_dir(), "png-export-test.png");
+    auto export_with_limit = [&](int limit) {
+        prefs->setInt("/options/export/memorylimit", limit);
+        auto result = sp_export_png_file(doc.get(), filename.c_str(), Geom::Rect(0, 0, 3000, 300), 3000, 300, 96,
+                                         96, 0xffffffff, nullptr, nullptr, true);
+        EXPECT_EQ(result, EXPORT_OK);
+        return readAndRemove(filename);
+    };
+
+    // At 1 MiB the image is rendered in stripes of 32 rows and tiles of 2048 pixels.
+    prefs->setInt("/options/threading/numthreads", 1);
+    auto unlimited = export_with_limit(0);
+    ASSERT_FALSE(unlimited.empty());
+    EXPECT_EQ(export_with_limit(1), unlimited);
+    prefs->remove("/options/threading/numthreads");
+    prefs->remove("/options/export/memorylimit");
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Test that path data and transforms parsed ahead match those parsed on demand
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2021 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <memory>
+#include <string>
+
+#include <2geom/transforms.h>
+#include <gtest/gtest.h>
+
+#include "preferences.h"
+#include "object/preparsed-attributes.h"
+#include "svg/svg.h"
+#include "xml/node.h"
+#include "xml/repr.h"
+
+using namespace Inkscape;
+
+namespace {
+
+std::shared_ptr<XML::Document> make_document(int count)
+{
+    std::string content = "<svg xmlns=\"http://www.w3.org/2000/svg\"><g transform=\"translate(5,7)\">";
+    for (int i = 0; i < count; ++i) {
+        auto n = std::to_string(i);
+        content += "<path d=\"M " + n + ",0 C 1,2 3,4 " + n + ".5,6 a 3 4 30 1 0 2,2 Z m 1,1 h 3 v 4\"";
+        if (i % 3 == 0) {
+            content += " transform=\"rotate(" + n + ") scale(1.5," + n + ")\"";
+        }
+        content += "/>";
+    }
+    // Malformed values are left to the main thread.
+    content += "<path d=\"M 0,0 L 1\" transform=\"rotate(\"/></g></svg>";
+    return std::shared_ptr<XML::Document>(sp_repr_read_buf(content, SP_SVG_NS_URI));
+}
+
+} // namespace
+
+TEST(PreparsedAttributesTest, MatchesSerialParsing)
+{
+    Preferences::get()->setInt("/options/threading/numthreads", 4);
+    auto doc = make_document(2000);
+    ASSERT_TRUE(doc);
+    XML::Node *group = doc->root()->firstChild();
+
+    PreparsedAttributes preparsed;
+    preparsed.parse(doc->root());
+
+    int paths = 0;
+    int transforms = 0;
+    for (auto node = group->firstChild(); node; node = node->next()) {
+        char const *d = node->attribute("d");
+        Geom::PathVector pathv;
+        if (preparsed.takePath(node, d, pathv)) {
+            EXPECT_EQ(pathv, sp_svg_read_pathv(d)) << d;
+            ++paths;
+        }
+        if (char const *t = node->attribute("transform")) {
+            Geom::Affine parsed;
+            Geom::Affine serial;
+            bool ok = sp_svg_transform_read(t, &serial);
+            EXPECT_EQ(preparsed.takeTransform(node, t, parsed), ok) << t;
+            if (ok) {
+                EXPECT_EQ(parsed, serial) << t;
+                ++transforms;
+            }
+        }
+    }
+    EXPECT_EQ(paths, 2000);
+    EXPECT_EQ(transforms, 667);
+
+    Geom::Affine group_transform;
+    EXPECT_TRUE(preparsed.takeTransform(group, group->attribute("transform"), group_transform));
+    EXPECT_EQ(group_transform, Geom::Affine(Geom::Translate(5, 7)));
+    EXPECT_EQ(preparsed.size(), 0u);
+}
+
+TEST(PreparsedAttributesTest, ChangedValueIsNotHandedOut)
+{
+    auto doc = make_document(1);
+    ASSERT_TRUE(doc);
+    XML::Node *path = doc->root()->firstChild()->firstChild();
+
+    PreparsedAttributes preparsed;
+    preparsed.parse(doc->root());
+    path->setAttribute("d", "M 0,0 L 10,10");
+
+    Geom::PathVector pathv;
+    EXPECT_FALSE(preparsed.takePath(path, path->attribute("d"), pathv));
+    EXPECT_TRUE(pathv.empty());
+}
+
+TEST(PreparsedAttributesTest, ResultFollowsTextNotString)
+{
+    auto doc = make_document(1);
+    ASSERT_TRUE(doc);
+    XML::Node *path = doc->root()->firstChild()->firstChild();
+    std::string const d = path->attribute("d");
+
+    PreparsedAttributes preparsed;
+    preparsed.parse(doc->root());
+    // The attribute gets a new string with the same text, the result still applies.
+    path->setAttribute("d", "M 0,0 L 10,10");
+    path->setAttribute("d", d);
+
+    Geom::PathVector pathv;
+    EXPECT_TRUE(preparsed.takePath(path, path->attribute("d"), pathv));
+    EXPECT_EQ(pathv, sp_svg_read_pathv(d.c_str()));
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -9,10 +9,13 @@
  * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
  */
 
+#include <memory>
+
 #include <gtest/gtest.h>
 #include <src/document.h>
 #include <src/inkscape.h>
 #include <src/live_effects/effect.h>
+#include <src/object/sp-item-group.h>
 #include <src/object/sp-lpe-item.h>
 
 using namespace Inkscape;
@@ -44,3 +47,89 @@ TEST_F(SPGroupTest, applyingPowerClipEffectToGroupWithoutClipIsIgnored)
 
     ASSERT_FALSE(group->hasPathEffect());
 }
+
+TEST_F(SPGroupTest, boundingBoxIsCachedAndInvalidatedByChildChanges)
+{
+    std::string svg("\
+<svg width='100' height='100'>\
+    <g id='group1'>\
+        <rect id='rect1' width='100' height='50' />\
+        <rect id='rect2' y='50' width='100' height='50' />\
+    </g>\
+</svg>");
+
+    auto doc = std::unique_ptr<SPDocument>(SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), true));
+    doc->ensureUpToDate();
+
+    auto group = dynamic_cast<SPGroup *>(doc->getObjectById("group1"));
+    auto rect = dynamic_cast<SPItem *>(doc->getObjectById("rect2"));
+    ASSERT_TRUE(group && rect);
+
+    Geom::OptRect first = group->geometricBounds();
+    SPItem::resetBBoxCacheStats();
+    Geom::OptRect second = group->geometricBounds();
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(SPItem::bboxCacheStats().hits, 1u);
+    EXPECT_EQ(SPItem::bboxCacheStats().misses, 0u);
+
+    rect->setAttribute("y", "150");
+    doc->ensureUpToDate();
+    Geom::OptRect moved = group->geometricBounds();
+    ASSERT_TRUE(moved);
+    EXPECT_DOUBLE_EQ(moved->bottom(), 200);
+    EXPECT_GT(SPItem::bboxCacheStats().misses, 0u);
+}
+
+TEST_F(SPGroupTest, boundingBoxIsNotCachedDuringUpdate)
+{
+    std::string svg("\
+<svg width='100' height='100'>\
+    <g id='group1'>\
+        <rect id='rect1' width='100' height='50' />\
+    </g>\
+</svg>");
+
+    auto doc = std::unique_ptr<SPDocument>(SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), true));
+    doc->ensureUpToDate();
+
+    auto group = dynamic_cast<SPGroup *>(doc->getObjectById("group1"));
+    ASSERT_TRUE(group);
+
+    // As if asked from the update() of a parent, before the group has been updated itself.
+    SPItem::resetBBoxCacheStats();
+    ++doc->update_in_progress;
+    group->geometricBounds();
+    group->geometricBounds();
+    --doc->update_in_progress;
+    EXPECT_EQ(SPItem::bboxCacheStats().hits, 0u);
+
+    group->geometricBounds();
+    group->geometricBounds();
+    EXPECT_EQ(SPItem::bboxCacheStats().hits, 1u);
+}
+
+TEST_F(SPGroupTest, updateOnlyVisitsDirtyBranches)
+{
+    std::string svg = "<svg width='100' height='100'><g id='layer'>";
+    for (int i = 0; i < 500; ++i) {
+        svg += "<rect width='1' height='1' x='" + std::to_string(i) + "' />";
+    }
+    svg += "<g id='group1'><rect id='rect1' width='10' height='10' /></g></g></svg>";
+
+    auto doc = std::unique_ptr<SPDocument>(SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), true));
+    doc->ensureUpToDate();
+
+    auto group = dynamic_cast<SPGroup *>(doc->getObjectById("group1"));
+    auto rect = dynamic_cast<SPItem *>(doc->getObjectById("rect1"));
+    ASSERT_TRUE(group && rect);
+
+    rect->setAttribute("y", "20");
+    doc->ensureUpToDate();
+
+    // The root, the layer, the group and the rect, none of the siblings.
+    EXPECT_LT(doc->update_stats.updated, 10u);
+    EXPECT_LT(doc->update_stats.modified, 10u);
+    Geom::OptRect bbox = group->geometricBounds();
+    ASSERT_TRUE(bbox);
+    EXPECT_DOUBLE_EQ(bbox->top(), 20);
+}
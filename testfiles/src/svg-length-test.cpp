@@ -171,6 +171,15 @@ TEST(SvgLengthTest, testPlaces)
     testd_t const precTests[] = {
         {"760", 761.92918978947023, 2, -8},
         {"761.9", 761.92918978947023, 4, -8},
+        {"30", 34.632867660167953, 1, -8},
+        {"670", 674.7323325086918, 2, -8},
+        {"3000000000", 3e9, 8, -8},
+        {"1e20", 1e20, 8, -8},
+        {"0.0498", 0.049798156300998465, 5, -8},
+        {"-1.23e-4", -0.000123, 8, -8},
+        {"1e-7", 9.6348587372618868e-08, 1, -8},
+        {"0", 9.6348587372618868e-08, 1, -7},
+        {"0", 1.234e-12, 8, -8},
     };
 
     for (size_t i = 0; i < G_N_ELEMENTS(precTests); i++) {
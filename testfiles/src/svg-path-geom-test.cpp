@@ -12,6 +12,7 @@
 #include <2geom/pathvector.h>
 #include <glib.h>
 #include <gtest/gtest.h>
+#include <random>
 #include <vector>
 
 #include "preferences.h"
@@ -435,6 +436,82 @@ TEST_F(SvgPathGeomTest, testReadErrorStopReading)
 }
 */
 
+TEST_F(SvgPathGeomTest, fastReaderMatchesGenericParser)
+{
+    std::vector<std::string> paths = {
+        "",
+        "M 1,2 L 4,2 L 4,8 L 1,8 z",
+        "m 0,0 m 1,1 l 1,1 m 1,1 z m 1,1 l 1,1 z m 2,2",
+        "M 1,1 l 1,1 z l 2,2 z",
+        "M .1.2+0.4.2e0.4e0+8e-1.1.8 z",
+        "M 1e-2,.2e-1 L 0.004e1,0.0002e+2 L0150E-2,1.6e0L1.0e-2,80e-3 z",
+        "M10-20C30-40-50 60 70 80S90 100 110 120s1,2 3,4Q5 6 7 8T9 10t1 1q1-1 2-2",
+        "M 0.1,0.1 l 0.1,0.1 l -0.1,-0.1000000001 z",
+        "M 1,2 4,2 4,8 1,8 z , m 13,15",
+        "M 1,2 4,2 4,8 1,8 z m 13e4e5,15",
+        "M 1,2 4,2 4,8 1,8 z j 357",
+        "M 1,2 A 3,4 0 1 0 5,6 a 1 1 0 01 2 2 z",
+        "M 1.,2. L 3,4",
+    };
+
+    // Randomly formatted path data, with separators and number forms as found in the wild.
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> coord(-1000, 1000);
+    char const *commands = "MLHVCSQTZmlhvcsqtz";
+    int const params[] = {2, 2, 1, 1, 6, 4, 4, 2, 0};
+    for (int i = 0; i < 200; ++i) {
+        std::string path = gen() % 2 ? "M" : "m";
+        path += std::to_string(coord(gen)) + "," + std::to_string(coord(gen));
+        for (int j = 0; j < 50; ++j) {
+            int c = gen() % 18;
+            path += gen() % 2 ? " " : "";
+            path += commands[c];
+            for (int k = 0; k < params[c % 9]; ++k) {
+                double value = coord(gen);
+                char buf[40];
+                switch (gen() % 3) {
+                    case 0:
+                        g_ascii_formatd(buf, sizeof(buf), "%.17g", value);
+                        break;
+                    case 1:
+                        g_ascii_formatd(buf, sizeof(buf), "%.3e", value);
+                        break;
+                    default:
+                        g_ascii_formatd(buf, sizeof(buf), "%.2f", value);
+                        break;
+                }
+                path += k == 0 ? " " : (gen() % 2 ? "," : " ");
+                path += buf;
+            }
+        }
+        paths.push_back(path);
+    }
+
+    for (auto const &path : paths) {
+        Geom::PathVector fast = sp_svg_read_pathv(path.c_str());
+        Geom::PathVector generic = sp_svg_read_pathv_generic(path.c_str());
+        ASSERT_TRUE(fast == generic) << path;
+    }
+}
+
+TEST_F(SvgPathGeomTest, fastReaderMatchesGenericParserOnPolylines)
+{
+    // GIS-like data: 1000 polylines of 50 vertices each.
+    std::string path_str;
+    for (int i = 0; i < 1000; ++i) {
+        path_str += "M " + std::to_string(i * 0.731) + "," + std::to_string(i * 1.379) + " l";
+        for (int j = 0; j < 50; ++j) {
+            path_str += " " + std::to_string(j * 0.314159) + "," + std::to_string(-j * 0.271828);
+        }
+        path_str += " z ";
+    }
+
+    Geom::PathVector fast = sp_svg_read_pathv(path_str.c_str());
+    Geom::PathVector generic = sp_svg_read_pathv_generic(path_str.c_str());
+    ASSERT_EQ(fast.size(), 1000u);
+    ASSERT_TRUE(fast == generic);
+}
+
 TEST_F(SvgPathGeomTest, testRoundTrip)
 {
     // This is the easiest way to (also) test writing path data, as a path can be written in more than one way.
@@ -476,6 +553,27 @@ TEST_F(SvgPathGeomTest, testRoundTrip)
     ASSERT_TRUE(bpathEqual(pv, new_pv, 1e-17)) << org_path_str.c_str();
 }
 
+TEST_F(SvgPathGeomTest, writeManySubpaths)
+{
+    // A path heavy document: 1000 subpaths of 10 cubic segments each.
+    Geom::PathVector pv;
+    for (int i = 0; i < 1000; ++i) {
+        Geom::Point p(i * 0.731, -i * 1.379);
+        pv.push_back(Geom::Path(p));
+        for (int j = 0; j < 10; ++j) {
+            Geom::Point q = p + Geom::Point(j * 3.14159, -j * 2.71828);
+            pv.back().appendNew<Geom::CubicBezier>(p + Geom::Point(0.123, 4.56), q - Geom::Point(7.89, 0.012), q);
+            p = q;
+        }
+        pv.back().close();
+    }
+
+    // Written with the default precision of 8 significant digits.
+    std::string path_str = sp_svg_write_path(pv);
+    Geom::PathVector new_pv = sp_svg_read_pathv(path_str.c_str());
+    ASSERT_TRUE(bpathEqual(pv, new_pv, 1e-3));
+}
+
 /*
  * Please do not change my prefs or put them back after :(
  * also, fails.
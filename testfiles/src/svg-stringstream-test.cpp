@@ -18,6 +18,8 @@
 
 #include "gtest/gtest.h"
 #include <glibmm/ustring.h>
+#include <charconv>
+#include <glib.h>
 
 template <typename S, typename T>
 static void assert_tostring_eq(T value, const char *expected)
@@ -125,6 +127,38 @@ TEST(SVGOStringStreamTest, tostring)
     assert_tostring_eq<S, double>(-3.5e9, "-3.5e+09");
 }
 
+TEST(SVGOStringStreamTest, floatfield)
+{
+    Inkscape::SVGOStringStream os;
+    os.precision(4);
+    os.setf(std::ios::fixed);
+    os << 1.234e-12 << ' ' << 0.5 << ' ' << 3.14159 << ' ' << -2e9 << ' ' << 12345.25;
+    ASSERT_EQ(os.str(), "0 0.5 3.1416 -2000000000 12345.25");
+
+    Inkscape::SVGOStringStream sci;
+    sci.precision(3);
+    sci.setf(std::ios::scientific);
+    sci << 1234.56 << ' ' << 0.5;
+    ASSERT_EQ(sci.str(), "1.235e+03 5e-01");
+}
+
+TEST(SVGOStringStreamTest, shortestRoundTrip)
+{
+    Inkscape::SVGOStringStream os;
+    os.precision(17);
+    os << 0.1 << ' ' << 1.0 / 3;
+
+    // Whatever the formatting, the numbers must read back exactly.
+    std::string const str = os.str();
+    char *end = nullptr;
+    ASSERT_EQ(g_ascii_strtod(str.c_str(), &end), 0.1);
+    ASSERT_EQ(g_ascii_strtod(end, nullptr), 1.0 / 3);
+#if __cpp_lib_to_chars >= 201611L
+    // std::to_chars gives the shortest such string.
+    ASSERT_EQ(str, "0.1 0.3333333333333333");
+#endif
+}
+
 template <typename S>
 void test_concat()
 {
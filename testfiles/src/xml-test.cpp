@@ -12,9 +12,83 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
+#include <fstream>
+
+#include <glib/gstdio.h>
+#include <glibmm/miscutils.h>
+#include <zlib.h>
+
 #include "gtest/gtest.h"
+#include "io/stream/gzipstream.h"
+#include "io/stream/uristream.h"
+#include "object/preparsed-attributes.h"
+#include "preferences.h"
+#include "svg/svg.h"
+#include "xml/attribute-record.h"
+#include "xml/push-reader.h"
+#include "xml/repr-cache.h"
 #include "xml/repr.h"
 
+namespace {
+
+std::string write_temp_svg(std::string const &name, std::string const &content)
+{
+    auto filename = Glib::build_filename(Glib::get_tmp_dir(), name);
+    std::ofstream out(filename, std::ios::binary);
+    out << content;
+    return filename;
+}
+
+std::shared_ptr<Inkscape::XML::Document> read_file_with(std::string const &filename, bool streaming)
+{
+    auto prefs = Inkscape::Preferences::get();
+    prefs->setBool("/options/svgload/streaming", streaming);
+    auto doc = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI));
+    prefs->setBool("/options/svgload/streaming", true);
+    return doc;
+}
+
+/**
+ * Points the document cache at a temporary directory, removed with everything in it when
+ * the test is done.
+ */
+class ScopedCacheDir
+{
+public:
+    ScopedCacheDir()
+    {
+        gchar *dir = g_dir_make_tmp("inkscape-xml-test-XXXXXX", nullptr);
+        if (dir) {
+            _dir = dir;
+            g_free(dir);
+        }
+        Inkscape::Preferences::get()->setString("/options/svgload/cache_dir", _dir);
+    }
+
+    ~ScopedCacheDir()
+    {
+        Inkscape::Preferences::get()->setString("/options/svgload/cache_dir", "");
+        if (_dir.empty()) {
+            return;
+        }
+        if (GDir *dir = g_dir_open(_dir.c_str(), 0, nullptr)) {
+            while (gchar const *name = g_dir_read_name(dir)) {
+                g_unlink(Glib::build_filename(_dir, name).c_str());
+            }
+            g_dir_close(dir);
+        }
+        g_rmdir(_dir.c_str());
+    }
+
+    bool valid() const { return !_dir.empty(); }
+
+private:
+    std::string _dir;
+};
+
+} // namespace
+
 TEST(XmlTest, nodeiter)
 {
     auto testdoc = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_buf("<svg><g/></svg>", SP_SVG_NS_URI));
@@ -47,6 +121,351 @@ TEST(XmlTest, nodeiter)
     ASSERT_NE(found, nullptr);
 }
 
+TEST(XmlTest, manyAttributes)
+{
+    auto testdoc = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_buf("<svg/>", SP_SVG_NS_URI));
+    ASSERT_TRUE(testdoc);
+    auto node = testdoc->root();
+
+    // Enough attributes for lookups to go through the node's index.
+    for (int i = 0; i < 20; ++i) {
+        node->setAttribute("attr" + std::to_string(i), std::to_string(i));
+    }
+    node->removeAttribute("attr3");
+    node->setAttribute("attr5", "changed");
+    node->setAttribute("attr20", "20");
+
+    EXPECT_EQ(node->attribute("attr3"), nullptr);
+    EXPECT_STREQ(node->attribute("attr5"), "changed");
+    EXPECT_STREQ(node->attribute("attr19"), "19");
+    EXPECT_STREQ(node->attribute("attr20"), "20");
+    EXPECT_EQ(node->attribute("never-used-attribute-name"), nullptr);
+
+    // Document order is kept.
+    auto const &attributes = node->attributeList();
+    ASSERT_EQ(attributes.size(), 20u);
+    EXPECT_STREQ(g_quark_to_string(attributes[3].key), "attr4");
+    EXPECT_STREQ(g_quark_to_string(attributes.back().key), "attr20");
+}
+
+TEST(XmlTest, streamingReaderMatchesTreeReader)
+{
+    auto filename = write_temp_svg("xml-test-streaming.svg",
+        "<?xml version=\"1.0\"?>\n"
+        "<!-- leading comment -->\n"
+        "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:inkscape=\"http://www.inkscape.org/namespaces/inkscape\"\n"
+        "     xmlns:foo=\"http://example.org/foo\" width=\"10\" empty=\"\">\n"
+        "  <?inkscape-pi data?>\n"
+        "  <g inkscape:label=\"Layer\" foo:bar=\"baz\">\n"
+        "    <path d=\"M 0,0 L 1,1\"/>\n"
+        "    <text xml:space=\"preserve\">  a <tspan> b </tspan>  </text>\n"
+        "    <style><![CDATA[ rect { fill: red } ]]></style>\n"
+        "  </g>\n"
+        "  <!-- inner comment -->\n"
+        "</svg>\n");
+
+    auto streamed = read_file_with(filename, true);
+    auto tree = read_file_with(filename, false);
+    g_unlink(filename.c_str());
+
+    ASSERT_TRUE(streamed);
+    ASSERT_TRUE(tree);
+    EXPECT_EQ(sp_repr_save_buf(streamed.get()), sp_repr_save_buf(tree.get()));
+
+    // Parsing from memory takes the streaming path too.
+    auto doc = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_buf(
+        "<svg xml:space=\"preserve\"><text> <tspan>x</tspan> </text></svg>", SP_SVG_NS_URI));
+    ASSERT_TRUE(doc);
+    auto text = doc->root()->firstChild();
+    ASSERT_STREQ(text->name(), "svg:text");
+    EXPECT_EQ(text->childCount(), 3u);
+}
+
+TEST(XmlTest, pushReaderMatchesTreeReader)
+{
+    std::string content =
+        "<?xml version=\"1.0\"?>\n"
+        "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\">\n"
+        "  <!-- comment -->\n"
+        "  <defs><linearGradient id=\"g\"/></defs>\n"
+        "  <path d=\"M 0,0 L 1,1\" style=\"fill:url(#g)\" title=\"a &amp; b\"/>\n"
+        "  <use xlink:href=\"#g\"/>\n"
+        "  <text xml:space=\"preserve\">  a <tspan> b </tspan>  </text>\n"
+        "</svg>\n";
+
+    // Hand the text over a few bytes at a time, splitting names, entities and attributes.
+    Inkscape::XML::PushReader reader(SP_SVG_NS_URI);
+    for (size_t i = 0; i < content.size(); i += 3) {
+        reader.write(content.data() + i, std::min<size_t>(3, content.size() - i));
+    }
+    auto pushed = std::shared_ptr<Inkscape::XML::Document>(reader.finish());
+    auto tree = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_buf(content, SP_SVG_NS_URI));
+
+    ASSERT_TRUE(pushed);
+    ASSERT_TRUE(tree);
+    EXPECT_EQ(sp_repr_save_buf(pushed.get()), sp_repr_save_buf(tree.get()));
+
+    // Documents without namespaces are promoted into the default namespace by both.
+    std::string bare = "<svg><rect/>text</svg>";
+    Inkscape::XML::PushReader bare_reader(SP_SVG_NS_URI);
+    bare_reader.write(bare);
+    auto bare_pushed = std::shared_ptr<Inkscape::XML::Document>(bare_reader.finish());
+    auto bare_tree = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_buf(bare, SP_SVG_NS_URI));
+    ASSERT_TRUE(bare_pushed);
+    ASSERT_TRUE(bare_tree);
+    EXPECT_STREQ(bare_pushed->root()->name(), "svg:svg");
+    EXPECT_STREQ(bare_pushed->root()->firstChild()->name(), "svg:rect");
+    EXPECT_EQ(sp_repr_save_buf(bare_pushed.get()), sp_repr_save_buf(bare_tree.get()));
+
+    Inkscape::XML::PushReader empty(SP_SVG_NS_URI);
+    empty.write("<!-- no root -->");
+    EXPECT_EQ(empty.finish(), nullptr);
+}
+
+TEST(XmlTest, readCompressedFile)
+{
+    std::string content = "<svg xmlns=\"http://www.w3.org/2000/svg\">";
+    for (int i = 0; i < 50000; ++i) {
+        content += "<rect id=\"r" + std::to_string(i) + "\" width=\"1\" height=\"1\"/>";
+    }
+    content += "</svg>";
+    auto doc = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_buf(content, SP_SVG_NS_URI));
+    ASSERT_TRUE(doc);
+
+    auto filename = Glib::build_filename(Glib::get_tmp_dir(), "xml-test-compressed.svgz");
+    FILE *fp = fopen(filename.c_str(), "wb");
+    ASSERT_TRUE(fp);
+    sp_repr_save_stream(doc.get(), fp, SP_SVG_NS_URI, true);
+    fclose(fp);
+
+    // Larger than one block of the inflating thread once decompressed.
+    auto compressed = read_file_with(filename, true);
+    g_unlink(filename.c_str());
+    ASSERT_TRUE(compressed);
+    EXPECT_EQ(compressed->root()->childCount(), 50000u);
+    EXPECT_EQ(sp_repr_save_buf(compressed.get()), sp_repr_save_buf(doc.get()));
+}
+
+TEST(XmlTest, readConcatenatedGzipMembers)
+{
+    std::string const first = "<svg xmlns=\"http://www.w3.org/2000/svg\"><rect id=\"r1\"/>";
+    std::string const second = "<rect id=\"r2\"/><rect id=\"r3\"/></svg>";
+
+    // Two members, as written by appending to a gzip file, and trailing garbage.
+    auto filename = Glib::build_filename(Glib::get_tmp_dir(), "xml-test-members.svgz");
+    std::string const parts[] = {first, second};
+    for (int i = 0; i < 2; ++i) {
+        gzFile gz = gzopen(filename.c_str(), i == 0 ? "wb" : "ab");
+        ASSERT_TRUE(gz);
+        gzwrite(gz, parts[i].data(), parts[i].size());
+        gzclose(gz);
+    }
+    FILE *fp = fopen(filename.c_str(), "ab");
+    ASSERT_TRUE(fp);
+    fwrite("\0\0\0\0", 1, 4, fp);
+    fclose(fp);
+
+    auto doc = read_file_with(filename, true);
+    g_unlink(filename.c_str());
+    ASSERT_TRUE(doc);
+    EXPECT_EQ(doc->root()->childCount(), 3u);
+}
+
+TEST(XmlTest, cachedDocumentMatchesParsedDocument)
+{
+    ScopedCacheDir cache_dir;
+    ASSERT_TRUE(cache_dir.valid());
+    std::string content = "<?xml version=\"1.0\"?>\n<!-- comment -->\n"
+                          "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"10\">"
+                          "<?pi data?><style><![CDATA[ rect { fill: red } ]]></style>";
+    for (int i = 0; i < 1000; ++i) {
+        content += "<text id=\"t" + std::to_string(i) + "\" x=\"1\"> a <tspan>b</tspan></text>";
+    }
+    content += "</svg>\n";
+    auto filename = write_temp_svg("xml-test-cache.svg", content);
+
+    auto prefs = Inkscape::Preferences::get();
+    EXPECT_TRUE(Inkscape::XML::cached_document_key(content.data(), content.size(), SP_SVG_NS_URI).empty());
+    prefs->setBool("/options/svgload/cache", true);
+    prefs->setInt("/options/svgload/cache_minsize", 0);
+    auto key = Inkscape::XML::cached_document_key(content.data(), content.size(), SP_SVG_NS_URI);
+    EXPECT_FALSE(key.empty());
+    EXPECT_NE(key, Inkscape::XML::cached_document_key(content.data(), content.size(), nullptr));
+
+    auto parsed = read_file_with(filename, true);
+    auto cached = std::shared_ptr<Inkscape::XML::Document>(Inkscape::XML::read_cached_document(key));
+    auto reopened = read_file_with(filename, true);
+    g_unlink(filename.c_str());
+    prefs->setBool("/options/svgload/cache", false);
+    prefs->setInt("/options/svgload/cache_minsize", 1024);
+
+    ASSERT_TRUE(parsed);
+    ASSERT_TRUE(cached);
+    ASSERT_TRUE(reopened);
+    EXPECT_EQ(sp_repr_save_buf(cached.get()), sp_repr_save_buf(parsed.get()));
+    EXPECT_EQ(sp_repr_save_buf(reopened.get()), sp_repr_save_buf(parsed.get()));
+}
+
+TEST(XmlTest, cachedDocumentKeepsParsedPaths)
+{
+    ScopedCacheDir cache_dir;
+    ASSERT_TRUE(cache_dir.valid());
+    std::string content = "<svg xmlns=\"http://www.w3.org/2000/svg\">";
+    for (int i = 0; i < 100; ++i) {
+        auto n = std::to_string(i);
+        content += "<path d=\"M " + n + ",0.1 L 2,3 Q 4,5 6,7 C 1,2 3,4 " + n + ".5,6 Z m 1,1 h 3 v 4\""
+                   " transform=\"rotate(" + n + ") translate(0.3," + n + ")\"/>";
+    }
+    content += "<path id=\"arc\" d=\"M 0,0 a 3 4 30 1 0 2,2\"/></svg>";
+    auto filename = write_temp_svg("xml-test-cache-paths.svg", content);
+
+    auto prefs = Inkscape::Preferences::get();
+    prefs->setBool("/options/svgload/cache", true);
+    prefs->setInt("/options/svgload/cache_minsize", 0);
+    Inkscape::PreparsedAttributes parsed;
+    Inkscape::PreparsedAttributes cached;
+    auto first = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI, &parsed));
+    auto reopened = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI, &cached));
+    g_unlink(filename.c_str());
+    prefs->setBool("/options/svgload/cache", false);
+    prefs->setInt("/options/svgload/cache_minsize", 1024);
+
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(reopened);
+    // Arcs are not stored, and are parsed when the object is built instead.
+    EXPECT_EQ(cached.size(), 200u);
+    for (auto node = reopened->root()->firstChild(); node; node = node->next()) {
+        Geom::PathVector pathv;
+        bool found = cached.takePath(node, node->attribute("d"), pathv);
+        if (node->attribute("id")) {
+            EXPECT_FALSE(found);
+            continue;
+        }
+        EXPECT_TRUE(found);
+        EXPECT_EQ(pathv, sp_svg_read_pathv(node->attribute("d")));
+        Geom::Affine transform;
+        Geom::Affine expected;
+        ASSERT_TRUE(sp_svg_transform_read(node->attribute("transform"), &expected));
+        EXPECT_TRUE(cached.takeTransform(node, node->attribute("transform"), transform));
+        EXPECT_EQ(transform, expected);
+    }
+}
+
+TEST(XmlTest, compressedDocumentIsNotCached)
+{
+    ScopedCacheDir cache_dir;
+    ASSERT_TRUE(cache_dir.valid());
+    std::string content = "<svg xmlns=\"http://www.w3.org/2000/svg\"><rect width=\"1\" height=\"1\"/></svg>";
+    auto doc = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_buf(content, SP_SVG_NS_URI));
+    ASSERT_TRUE(doc);
+    auto filename = Glib::build_filename(Glib::get_tmp_dir(), "xml-test-cache-compressed.svgz");
+    FILE *fp = fopen(filename.c_str(), "wb");
+    ASSERT_TRUE(fp);
+    sp_repr_save_stream(doc.get(), fp, SP_SVG_NS_URI, true);
+    fclose(fp);
+
+    auto prefs = Inkscape::Preferences::get();
+    prefs->setBool("/options/svgload/cache", true);
+    prefs->setInt("/options/svgload/cache_minsize", 0);
+    auto compressed = read_file_with(filename, true);
+    gchar *data = nullptr;
+    gsize length = 0;
+    ASSERT_TRUE(g_file_get_contents(filename.c_str(), &data, &length, nullptr));
+    auto key = Inkscape::XML::cached_document_key(data, length, SP_SVG_NS_URI);
+    g_free(data);
+    g_unlink(filename.c_str());
+    auto cached = std::shared_ptr<Inkscape::XML::Document>(Inkscape::XML::read_cached_document(key));
+    prefs->setBool("/options/svgload/cache", false);
+    prefs->setInt("/options/svgload/cache_minsize", 1024);
+
+    ASSERT_TRUE(compressed);
+    EXPECT_FALSE(cached);
+}
+
+TEST(XmlTest, parallelSaveMatchesSerialSave)
+{
+    std::string content = "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\">"
+                          "<!-- comment --><defs><linearGradient id=\"lg\"/></defs>";
+    for (int i = 0; i < 20; ++i) {
+        content += "<g id=\"layer" + std::to_string(i) + "\">";
+        for (int j = 0; j < 100; ++j) {
+            content += "<rect x=\"" + std::to_string(j) + "\" width=\"1\" height=\"1\" style=\"fill:url(#lg)\"/>";
+        }
+        content += "<text xml:space=\"preserve\"><tspan>a &amp; b</tspan> c</text></g>";
+    }
+    // Relative hrefs are rebased when saving to a file.
+    content += "<g id=\"images\"><image xlink:href=\"image.png\" width=\"1\" height=\"1\"/></g></svg>";
+    auto doc = std::shared_ptr<Inkscape::XML::Document>(sp_repr_read_buf(content, SP_SVG_NS_URI));
+    ASSERT_TRUE(doc);
+
+    auto save_file = [&doc]() {
+        auto filename = Glib::build_filename(Glib::get_tmp_dir(), "xml-test-parallel-save.svg");
+        EXPECT_TRUE(sp_repr_save_file(doc.get(), filename.c_str(), SP_SVG_NS_URI));
+        std::ifstream file(filename);
+        std::string saved((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        g_unlink(filename.c_str());
+        return saved;
+    };
+
+    auto prefs = Inkscape::Preferences::get();
+    int numthreads = prefs->getInt("/options/threading/numthreads", 0);
+
+    prefs->setInt("/options/threading/numthreads", 1);
+    auto serial_buf = sp_repr_save_buf(doc.get());
+    auto serial_file = save_file();
+    prefs->setInt("/options/threading/numthreads", 4);
+    auto parallel_buf = sp_repr_save_buf(doc.get());
+    auto parallel_file = save_file();
+
+    if (numthreads) {
+        prefs->setInt("/options/threading/numthreads", numthreads);
+    } else {
+        prefs->remove("/options/threading/numthreads");
+    }
+
+    EXPECT_EQ(parallel_buf, serial_buf);
+    EXPECT_EQ(parallel_file, serial_file);
+    EXPECT_NE(serial_file.find("image.png"), std::string::npos);
+}
+
+TEST(XmlTest, blockParallelGzipOutput)
+{
+    std::string content;
+    for (int i = 0; content.size() < 3000000; ++i) {
+        content += "<path id=\"p" + std::to_string(i) + "\" d=\"M " + std::to_string(i % 977) + ",0 L 1,1\"/>\n";
+    }
+    auto filename = Glib::build_filename(Glib::get_tmp_dir(), "xml-test-parallel.gz");
+
+    for (int level : {0, 1, 9}) {
+        FILE *fp = fopen(filename.c_str(), "wb");
+        ASSERT_TRUE(fp);
+        {
+            Inkscape::IO::FileOutputStream bout(fp);
+            Inkscape::IO::GzipOutputStream gout(bout, level, 4);
+            // Mix single bytes, blocks and an explicit flush mid-way.
+            size_t half = content.size() / 2;
+            for (size_t i = 0; i < 1000; ++i) {
+                gout.put(content[i]);
+            }
+            gout.write(content.data() + 1000, half - 1000);
+            gout.flush();
+            gout.write(content.data() + half, content.size() - half);
+            gout.close();
+        }
+        fclose(fp);
+
+        gzFile gz = gzopen(filename.c_str(), "rb");
+        ASSERT_TRUE(gz);
+        std::string inflated(content.size() + 1, '\0');
+        int len = gzread(gz, &inflated[0], inflated.size());
+        gzclose(gz);
+        ASSERT_EQ(len, static_cast<int>(content.size())) << "level " << level;
+        inflated.resize(len);
+        EXPECT_EQ(inflated, content) << "level " << level;
+    }
+    g_unlink(filename.c_str());
+}
+
 /*
   Local Variables:
   mode:c++